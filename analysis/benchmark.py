@@ -1,17 +1,75 @@
+'''
+Plots benchmark timings
+
+    python analysis/benchmark.py
+        the hand-entered Python vs C++ comparison (analysis/python_cpp_comparison.json)
+
+    python analysis/benchmark.py results_<commit1>.json results_<commit2>.json ...
+        the output of the benchmark executable (benchmarks/benchmark.cpp), one subplot per benchmark,
+        best time against grid points for every particle/thread count, one colour per file (label) so regressions stand out.
+        Differences of more than 10% against the first file are printed.
+'''
 import json
+import sys
 import matplotlib.pyplot as plt
 
-# Open the JSON file
-with open('./analysis/python_cpp_comparison.json', 'r') as f:
-    # Load the JSON data into a Python dictionary
-    data = json.load(f)
+def plotComparison():
+    # Open the JSON file
+    with open('./analysis/python_cpp_comparison.json', 'r') as f:
+        # Load the JSON data into a Python dictionary
+        data = json.load(f)
+
+    numPts = [i**2 for i in data['numPoints']]
+
+    plt.scatter(numPts[:-1], data['python'][:-1], c='b', marker='s')
+    plt.scatter(numPts, data['c++'], c='r', marker='o', s=14)
+    plt.xscale('log')
+    plt.xlabel('Number of grid points used in simulation')
+    plt.ylabel('Execution time [s]')
+    plt.legend(['Python','C++'])
+    plt.show()
+
+def readResults(path):
+    with open(path, 'r') as f:
+        data = json.load(f)
+    label = data['label'] or path
+    # (benchmark, grid points, particles, threads) -> best time
+    timings = {(r['benchmark'], r['gridPoints'], r['particles'], r['threads']): r['best'] for r in data['results']}
+    return label, timings
+
+def compare(runs, threshold=0.1):
+    baseLabel, base = runs[0]
+    for label, timings in runs[1:]:
+        for key, time in sorted(timings.items()):
+            if key in base and abs(time / base[key] - 1) > threshold:
+                benchmark, gridPoints, particles, threads = key
+                change = 100 * (time / base[key] - 1)
+                print(f'{label} vs {baseLabel}: {benchmark} (grid points {gridPoints}, particles {particles}, threads {threads}) {change:+.1f}%')
 
-numPts = [i**2 for i in data['numPoints']]
+def plotResults(runs):
+    benchmarks = sorted({key[0] for _, timings in runs for key in timings})
+    fig, axes = plt.subplots(1, len(benchmarks), figsize=(4 * len(benchmarks), 4), squeeze=False)
+    markers = ['o', 's', '^', 'v', 'D', 'x']
+    for ax, benchmark in zip(axes[0], benchmarks):
+        for colour, (label, timings) in enumerate(runs):
+            series = sorted({(particles, threads) for (name, _, particles, threads) in timings if name == benchmark})
+            for m, (particles, threads) in enumerate(series):
+                points = sorted((gridPoints, time) for (name, gridPoints, p, t), time in timings.items() if name == benchmark and p == particles and t == threads)
+                ax.plot([p[0] for p in points], [p[1] for p in points], c=f'C{colour}', marker=markers[m % len(markers)],
+                        label=f'{label}: N={particles}, {threads} threads')
+        ax.set_xscale('log')
+        ax.set_yscale('log')
+        ax.set_title(benchmark, fontsize=8)
+        ax.set_xlabel('Number of grid points')
+        ax.set_ylabel('Execution time [s]')
+    axes[0][0].legend(fontsize=6)
+    plt.tight_layout()
+    plt.show()
 
-plt.scatter(numPts[:-1], data['python'][:-1], c='b', marker='s')
-plt.scatter(numPts, data['c++'], c='r', marker='o', s=14)
-plt.xscale('log')
-plt.xlabel('Number of grid points used in simulation')
-plt.ylabel('Execution time [s]')
-plt.legend(['Python','C++'])
-plt.show()
+if __name__ == '__main__':
+    if len(sys.argv) > 1:
+        runs = [readResults(path) for path in sys.argv[1:]]
+        compare(runs)
+        plotResults(runs)
+    else:
+        plotComparison()
@@ -0,0 +1,119 @@
+'''
+Reader for the binary run files (.cemf) written by FrameWriter (see src/Output/Output.hpp for the layout)
+
+Uncompressed frames are memory-mapped, so only the frames (and fields) that are actually used get read from disk.
+The grid and the static fields (e.g. the magnetic field of the wires) are stored once per file.
+Runs with an output stride/box only hold part of the grid (shape nx x ny), gridX/gridY are the written points.
+3D runs have shape nx x ny x nz, a gridZ and a z component in every field and particle array.
+Every record holds the id of each particle, the particles of a run can be reordered between frames ("sort interval").
+'''
+import struct
+import zlib
+import numpy as np
+import pandas as pd
+
+HEADER = struct.Struct('<8sIIIIQdIII12x')  # magic, version, flags, dim, numFields, points along x, bound, numStaticFields, points along y, points along z
+RECORD = struct.Struct('<QdQQQ')  # iteration, time, stored bytes, raw bytes, number of particles
+MAGIC = b'CEMFRAME'
+
+class RunFile:
+    def __init__(self, path):
+        self.path = path
+        with open(path, 'rb') as f:
+            magic, version, flags, self.dim, numFields, nx, self.bound, numStatic, ny, nz = HEADER.unpack(f.read(HEADER.size))
+            if magic != MAGIC:
+                raise ValueError(f'{path} is not a ClassicalEM++ run file')
+            if version != 1:
+                raise ValueError(f'{path} has unsupported version {version}')
+            self.shape = (nx, ny, nz) if self.dim == 3 else (nx, ny)
+            self.components = 1 + self.dim  # magnitude and unit vector per field
+            self.compressed = bool(flags & 1)
+            self.fields = [f.read(8).rstrip(b'\0').decode() for _ in range(numFields)]
+            staticNames = [f.read(8).rstrip(b'\0').decode() for _ in range(numStatic)]
+            offset = HEADER.size + 8 * (numFields + numStatic)
+
+            # grid and static fields
+            G = int(np.prod(self.shape))
+            C, D = self.components, self.dim
+            static = np.fromfile(f, dtype='<f8', count=(D + C * numStatic) * G).reshape(-1, *self.shape)
+            self.gridX, self.gridY = static[0], static[1]
+            self.gridZ = static[2] if D == 3 else None
+            self.static = {name: static[D + C * i: D + C * (i + 1)] for i, name in enumerate(staticNames)}
+            offset += static.nbytes
+
+            # index the records (iteration, time, payload offset, stored size, number of particles)
+            self.records = []
+            while True:
+                f.seek(offset)
+                raw = f.read(RECORD.size)
+                if len(raw) < RECORD.size:
+                    break
+                iteration, time, stored, _, numParticles = RECORD.unpack(raw)
+                self.records.append((iteration, time, offset + RECORD.size, stored, numParticles))
+                offset += RECORD.size + stored
+
+        if self.dim == 3:
+            self.x = self.gridX[:, 0, 0]
+            self.y = self.gridY[0, :, 0]
+            self.z = self.gridZ[0, 0, :]
+        else:
+            self.x = self.gridX[:, 0]
+            self.y = self.gridY[0, :]
+
+    def __len__(self):
+        return len(self.records)
+
+    def iterations(self):
+        return np.array([record[0] for record in self.records])
+
+    def times(self):
+        return np.array([record[1] for record in self.records])
+
+    def _gridSize(self):
+        return int(np.prod(self.shape))
+
+    def _payload(self, k):
+        _, _, offset, stored, numParticles = self.records[k]
+        # the ids are read as doubles here and viewed as integers by particles()
+        count = len(self.fields) * self.components * self._gridSize() + (2 * self.dim + 1) * numParticles
+        if self.compressed:
+            with open(self.path, 'rb') as f:
+                f.seek(offset)
+                return np.frombuffer(zlib.decompress(f.read(stored)), dtype='<f8', count=count), numParticles
+        return np.memmap(self.path, dtype='<f8', mode='r', offset=offset, shape=(count,)), numParticles
+
+    def frame(self, k):
+        '''
+        returns {field name: array of shape (3, nx, ny)} holding magnitude, x and y component
+        indexed as [component, x index, y index], static fields are included in every frame
+        (3D: shape (4, nx, ny, nz) with the z component last)
+        '''
+        data, _ = self._payload(k)
+        G = self._gridSize()
+        fields = data[:len(self.fields) * self.components * G].reshape(len(self.fields), self.components, *self.shape)
+        frame = {name: fields[i] for i, name in enumerate(self.fields)}
+        frame.update(self.static)
+        return frame
+
+    def particles(self, k):
+        '''
+        particle state of frame k as a dataframe with columns x, y, vx, vy (3D: x, y, z, vx, vy, vz)
+        indexed by the particle id
+        '''
+        data, numParticles = self._payload(k)
+        start = len(self.fields) * self.components * self._gridSize()
+        state = data[start:start + 2 * self.dim * numParticles].reshape(2 * self.dim, numParticles)
+        columns = ['x', 'y', 'z', 'vx', 'vy', 'vz'] if self.dim == 3 else ['x', 'y', 'vx', 'vy']
+        ids = pd.Index(np.asarray(data[start + 2 * self.dim * numParticles:]).view('<u8'), name='id')
+        return pd.DataFrame({column: state[i] for i, column in enumerate(columns)}, index=ids)
+
+    def dataframe(self, k, field):
+        '''
+        same columns as vis.readData (x, y, field, u, v) so the plotting functions work unchanged
+        (3D: x, y, z, field, u, v, w)
+        '''
+        values = self.frame(k)[field]
+        if self.dim == 3:
+            return pd.DataFrame({'x': self.gridX.ravel(), 'y': self.gridY.ravel(), 'z': self.gridZ.ravel(), field: values[0].ravel(),
+                                 'u': values[1].ravel(), 'v': values[2].ravel(), 'w': values[3].ravel()})
+        return pd.DataFrame({'x': self.gridX.ravel(), 'y': self.gridY.ravel(), field: values[0].ravel(), 'u': values[1].ravel(), 'v': values[2].ravel()})
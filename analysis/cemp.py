@@ -0,0 +1,61 @@
+'''
+Writer/reader for the particle tables (.cemp) that a config can load with "particles file" (see src/ParticleInput/ParticleInput.hpp)
+
+The columns are plain little-endian doubles, so a table of a million particles is written and read without any parsing:
+
+    import numpy as np, cemp
+    rng = np.random.default_rng(0)
+    n = 1_000_000
+    cemp.write('inputs/plasma.cemp', charge=rng.choice([-1., 1.], n), mass=np.ones(n), x=rng.uniform(-1, 1, n), y=rng.uniform(-1, 1, n))
+'''
+import struct
+import sys
+import json
+import numpy as np
+
+HEADER = struct.Struct('<8sIIQ8x')  # magic, version, dim, number of particles
+MAGIC = b'CEMPARTS'
+
+
+def write(path, charge, mass, x, y, z=None, vx=None, vy=None, vz=None):
+    '''writes a 2D table (or 3D if z is given), missing velocity components are 0'''
+    n = len(charge)
+    zero = np.zeros(n)
+    columns = [charge, mass, x, y] + ([z] if z is not None else []) + [zero if v is None else v for v in (vx, vy, vz)]
+    with open(path, 'wb') as f:
+        f.write(HEADER.pack(MAGIC, 1, 3 if z is not None else 2, n))
+        for column in columns:
+            f.write(np.ascontiguousarray(column, dtype='<f8').tobytes())
+
+
+def read(path):
+    '''the columns of a table as a dict of arrays'''
+    with open(path, 'rb') as f:
+        magic, version, dim, n = HEADER.unpack(f.read(HEADER.size))
+        if magic != MAGIC:
+            raise ValueError(f'{path} is not a particle table')
+        if version != 1:
+            raise ValueError(f'{path} has unsupported version {version}')
+        names = ['charge', 'mass', 'x', 'y'] + (['z'] if dim == 3 else []) + ['vx', 'vy', 'vz']
+        data = np.fromfile(f, dtype='<f8', count=len(names) * n).reshape(len(names), n)
+    return dict(zip(names, data))
+
+
+def from_json(path):
+    '''the "particles" of a config (or a json array of particle entries) as the columns of a table'''
+    with open(path) as f:
+        entries = json.load(f)
+    if isinstance(entries, dict):
+        entries = entries.get('particles', [])
+    columns = {key: np.array([entry.get(key, 1.0 if key == 'mass' else 0.0) for entry in entries], dtype=float)
+               for key in ('charge', 'mass', 'x', 'y', 'z', 'vx', 'vy', 'vz')}
+    if not any('z' in entry for entry in entries):
+        columns['z'] = None
+    return columns
+
+
+if __name__ == '__main__':
+    # python cemp.py <config or particles.json> <table.cemp>
+    if len(sys.argv) != 3:
+        sys.exit('usage: python cemp.py <particles.json> <table.cemp>')
+    write(sys.argv[2], **from_json(sys.argv[1]))
@@ -1,9 +1,11 @@
+import os
 import time
 import json
 import numpy as np
 import matplotlib.pyplot as plt
 import pandas as pd
 import matplotlib.animation as animation
+from cemf import RunFile
 plt.rcParams['text.usetex'] = True
 plt.rcParams['font.size'] = 16
 
@@ -86,14 +88,15 @@ def magneticFieldPlot2(data, numDraw=1, scale=2, maxLength=5):
     plt.ylim([data['y'].min(), data['y'].max()])
     plt.show()
 
-def updatefig(frame, fname, field, clim, vec):
-    data = readData(f'./outputs/{fname}{frame}.txt', field=field)
+def updatefig(frame, iterations, fname, field, clim, vec, run=None):
+    # binary run file if there is one, otherwise the per-frame csv files (named by iteration)
+    data = run.dataframe(frame, field) if run is not None else readData(f'./outputs/{fname}{iterations[frame]}.txt', field=field)
     plt.clf()
     if vec:
         vecPlot(data, vmin=-clim, vmax=clim, numDraw=6, scale=2, cmap='RdBu', show=False)
     else:
         colorPlot(data, vmin=-clim, vmax=clim, show=False)
-    plt.title(f'Frame: {frame}')
+    plt.title(f'Frame: {iterations[frame]}')
 
 if __name__ == '__main__':
     st = time.time()
@@ -103,6 +106,13 @@ if __name__ == '__main__':
 
     inputs = json.load(open('./inputs/dynamics_test.json', 'r'))
 
+    runPath = f'./{inputs.get("output directory", "outputs")}/{inputs["output filename"]}.cemf'
+    run = RunFile(runPath) if os.path.exists(runPath) else None
+
+    # frames are only written every "output interval" steps (and for the last step)
+    interval = inputs.get("output interval", 1)
+    iterations = list(run.iterations()) if run is not None else sorted(set(range(0, inputs["numSteps"], interval)) | {inputs["numSteps"] - 1})
+
     # for iteration in range(inputs["numSteps"]):
     # iteration = 0
     # data = readData(f'./outputs/{fname}{iteration}.txt', field=field)
@@ -117,15 +127,16 @@ if __name__ == '__main__':
     # magneticFieldPlot(data, numDraw=5, scale=4, vmax=.08)
 
     animation_time = 10 # s (10 s ==> 50 fps for 500 frames)
+    numFrames = len(iterations)
 
     fig = plt.figure()
-    anim = animation.FuncAnimation(fig, updatefig, inputs["numSteps"], fargs=(fname, field, 5, False), blit=False)
-    anim.save("/Users/max/ClassicalEM++/animations/torus_12_particles_omp.mp4", fps=inputs["numSteps"]/animation_time, dpi=500)
+    anim = animation.FuncAnimation(fig, updatefig, numFrames, fargs=(iterations, fname, field, 5, False, run), blit=False)
+    anim.save("/Users/max/ClassicalEM++/animations/torus_12_particles_omp.mp4", fps=numFrames/animation_time, dpi=500)
     plt.close()
     
     fig = plt.figure()
-    anim = animation.FuncAnimation(fig, updatefig, inputs["numSteps"], fargs=(fname, field, 5, True), blit=False)
-    anim.save("/Users/max/ClassicalEM++/animations/torus_12_particles_omp_vec.mp4", fps=inputs["numSteps"]/animation_time, dpi=500)
+    anim = animation.FuncAnimation(fig, updatefig, numFrames, fargs=(iterations, fname, field, 5, True, run), blit=False)
+    anim.save("/Users/max/ClassicalEM++/animations/torus_12_particles_omp_vec.mp4", fps=numFrames/animation_time, dpi=500)
     plt.close()
     
     print(f'Elapsed time: {time.time() - st:.2f} seconds!')
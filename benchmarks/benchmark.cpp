@@ -0,0 +1,286 @@
+// Benchmark suite for the main kernels, writes machine-readable JSON for analysis/benchmark.py
+// Usage: benchmark [--grid 51,101,201] [--particles 100,1000] [--wires 8] [--threads 1,<max>] [--repeats 5]
+//                  [--solver direct|tiled|barnes-hut|particle-mesh|multigrid|ewald|pppm] [--label <commit>] [--output benchmarks/results.json]
+// Every benchmark is run for every grid size x particle count x thread count; the best and mean of `repeats` runs are reported.
+// The generated particles are in random order, "(sorted)" repeats a benchmark with the same particles in Hilbert curve order
+// (see SpatialSort.hpp), the difference is the locality gain of a run with a "sort interval".
+// Run it on the same machine for every commit (with the commit as --label) and pass the files to analysis/benchmark.py to spot regressions.
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+#include "../src/DynamicPhysics/DynamicPhysics.hpp"
+
+namespace
+{
+    struct Options
+    {
+        std::vector<std::size_t> grid { 51, 101, 201 };
+        std::vector<std::size_t> particles { 100, 1000 };
+        std::size_t wires { 8 };
+        int maxThreads { omp_get_max_threads() }; // before any omp_set_num_threads
+        std::vector<std::size_t> threads { 1, static_cast<std::size_t>(maxThreads) };
+        std::size_t repeats { 5 };
+        std::string solver { "direct" };
+        std::string label { "" };
+        std::string output { "benchmarks/results.json" };
+    };
+
+    struct Result
+    {
+        std::string benchmark;
+        std::size_t numPoints;
+        std::size_t particles;
+        std::size_t threads;
+        double best;
+        double mean;
+    };
+
+    std::vector<std::size_t> parseList(const std::string& list)
+    {
+        std::vector<std::size_t> values;
+        std::stringstream stream { list };
+        std::string value;
+        while (std::getline(stream, value, ','))
+        {
+            values.push_back(std::stoul(value));
+        }
+        return values;
+    };
+
+    Options parseOptions(int argc, char* argv[])
+    {
+        Options options;
+        for (int i = 1; i + 1 < argc; i += 2)
+        {
+            const std::string key { argv[i] };
+            const std::string value { argv[i + 1] };
+            if (key == "--grid") { options.grid = parseList(value); }
+            else if (key == "--particles") { options.particles = parseList(value); }
+            else if (key == "--wires") { options.wires = std::stoul(value); }
+            else if (key == "--threads") { options.threads = parseList(value); }
+            else if (key == "--repeats") { options.repeats = std::max<std::size_t>(std::stoul(value), 1); }
+            else if (key == "--solver") { options.solver = value; }
+            else if (key == "--label") { options.label = value; }
+            else if (key == "--output") { options.output = value; }
+            else { std::cerr << "Unknown option " << key << "! Ignoring..." << std::endl; }
+        }
+        std::sort(options.threads.begin(), options.threads.end());
+        options.threads.erase(std::unique(options.threads.begin(), options.threads.end()), options.threads.end());
+        return options;
+    };
+
+    // the classes print progress to std::cout, which would end up in the timings
+    class Quiet
+    {
+    private:
+        std::streambuf* m_buffer;
+        std::ostringstream m_sink;
+
+    public:
+        Quiet() : m_buffer { std::cout.rdbuf(m_sink.rdbuf()) } {}
+        ~Quiet() { std::cout.rdbuf(m_buffer); }
+    };
+
+    // best and mean wall time of `repeats` calls
+    std::pair<double, double> measure(const std::size_t& repeats, const std::function<void()>& kernel)
+    {
+        double best { 1e300 };
+        double total { 0. };
+        for (std::size_t r = 0; r < repeats; ++r)
+        {
+            const auto start { std::chrono::steady_clock::now() };
+            kernel();
+            const std::chrono::duration<double> elapsed { std::chrono::steady_clock::now() - start };
+            best = std::min(best, elapsed.count());
+            total += elapsed.count();
+        }
+        return { best, total / static_cast<double>(repeats) };
+    };
+
+    void setSolver(Utilities::Config& config, const std::string& name)
+    {
+        if (name == "barnes-hut") { config.forceSolver = Utilities::ForceSolver::barnesHut; }
+        else if (name == "particle-mesh") { config.forceSolver = Utilities::ForceSolver::particleMesh; }
+        else if (name == "multigrid") { config.forceSolver = Utilities::ForceSolver::multigrid; }
+        else if (name == "ewald") { config.forceSolver = Utilities::ForceSolver::ewald; }
+        else if (name == "pppm") { config.forceSolver = Utilities::ForceSolver::pppm; }
+        else if (name == "tiled") { config.forceSolver = Utilities::ForceSolver::tiled; }
+        else { config.forceSolver = Utilities::ForceSolver::direct; }
+
+        // the Ewald solvers only exist for periodic boundaries
+        config.periodic = (config.forceSolver == Utilities::ForceSolver::ewald || config.forceSolver == Utilities::ForceSolver::pppm);
+    };
+
+    void generate(Utilities::Config& config, const std::size_t& numParticles, const std::size_t& numWires)
+    {
+        // fixed seed so every commit benchmarks the same configuration
+        std::mt19937 generator { 42 };
+        std::uniform_real_distribution<double> position { -0.9 * config.bound, 0.9 * config.bound };
+        std::uniform_real_distribution<double> unit { -1., 1. };
+
+        config.particles.clear();
+        for (std::size_t i = 0; i < numParticles; ++i)
+        {
+            config.particles.push_back(ChargedParticle2D {0.01 * unit(generator), 1., Point2D {position(generator), position(generator)}, Point3D {0., 0., 0.}});
+        }
+
+        config.wires.clear();
+        for (std::size_t i = 0; i < numWires; ++i)
+        {
+            Point3D direction { unit(generator), unit(generator), unit(generator) };
+            direction.normalize();
+            config.wires.push_back(InfiniteWire2D {unit(generator), Point2D {position(generator), position(generator)}, direction});
+        }
+    };
+
+    void writeJson(const Options& options, const std::vector<Result>& results)
+    {
+        std::filesystem::path path { options.output };
+        if (path.has_parent_path()) { std::filesystem::create_directories(path.parent_path()); }
+
+        std::ofstream file(path);
+        if (!file.is_open())
+        {
+            throw std::ios_base::failure("Failed to open file for writing: " + options.output);
+        }
+
+        const std::time_t now { std::time(nullptr) };
+        char timestamp[32];
+        std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+        nlohmann::json _j;
+        _j["label"] = options.label;
+        _j["timestamp"] = timestamp;
+        _j["max threads"] = options.maxThreads;
+        _j["field kernels"] = FieldKernels::isaName(FieldKernels::activeISA());
+        _j["force solver"] = options.solver;
+        _j["wires"] = options.wires;
+        _j["repeats"] = options.repeats;
+        _j["results"] = nlohmann::json::array();
+        for (const Result& result : results)
+        {
+            _j["results"].push_back({
+                {"benchmark", result.benchmark},
+                {"numPoints", result.numPoints},
+                {"gridPoints", (result.numPoints + 1) * (result.numPoints + 1)},
+                {"particles", result.particles},
+                {"threads", result.threads},
+                {"best", result.best},
+                {"mean", result.mean},
+            });
+        }
+
+        file << _j.dump(4) << '\n';
+    };
+};
+
+int main(int argc, char* argv[])
+{
+    const Options options { parseOptions(argc, argv) };
+
+    Utilities::Config config;
+    config.dim = 2;
+    config.bound = 10.;
+    config.numSteps = 1000000;
+    config.dt = 0.001;
+    config.theta = 0.5;
+    config.assignment = Utilities::Assignment::CIC;
+    config.ewaldTolerance = 1e-5;
+    config.ewaldCutoff = 0.;
+    config.pppmMesh = 0;
+    config.outputFilename = "benchmark";
+    config.outputDirectory = (std::filesystem::temp_directory_path() / "cemf_benchmark").string();
+    config.outputFormat = Utilities::OutputFormat::binary;
+    config.compression = false;
+    config.outputQueue = 4;
+    // every step writes the whole grid, so evolve includes the field evaluation and the frame
+    config.outputInterval = 1;
+    config.outputStride = 1;
+    config.outputBox = Utilities::Box { -config.bound, config.bound, -config.bound, config.bound, -config.bound, config.bound };
+    setSolver(config, options.solver);
+    std::filesystem::create_directories(config.outputDirectory);
+
+    std::vector<Result> results;
+    const auto record = [&](const std::string& name, const std::size_t& threads, const std::pair<double, double>& time)
+    {
+        results.push_back(Result {name, config.numPoints, config.particles.size(), threads, time.first, time.second});
+        std::cout << std::left << std::setw(52) << name << std::right
+                  << " numPoints " << std::setw(5) << config.numPoints << "  particles " << std::setw(7) << config.particles.size()
+                  << "  threads " << std::setw(3) << threads
+                  << "  best " << std::scientific << std::setprecision(3) << time.first << " s  mean " << time.second << " s" << std::defaultfloat << std::endl;
+    };
+
+    for (const std::size_t& numPoints : options.grid)
+    {
+        config.numPoints = numPoints;
+
+        for (const std::size_t& numParticles : options.particles)
+        {
+            generate(config, numParticles, options.wires);
+
+            for (const std::size_t& threads : options.threads)
+            {
+                omp_set_num_threads(static_cast<int>(threads));
+
+                record("Geometry::constructWorld", threads, measure(options.repeats, [&]
+                {
+                    Quiet quiet;
+                    Geometry<2> geometry(config.bound, config.numPoints);
+                }));
+
+                std::vector<ChargedParticle2D> particles { config.particles };
+                std::vector<InfiniteWire2D> wires { config.wires };
+
+                // the constructors print the configuration
+                std::optional<StaticPhysics<2>> static_physics;
+                std::optional<DynamicPhysics<2>> dynamic_physics;
+                {
+                    Quiet quiet;
+                    static_physics.emplace(config);
+                    dynamic_physics.emplace(config);
+                }
+
+                record("StaticPhysics::calculateElectricField", threads, measure(options.repeats, [&] { static_physics->calculateElectricField(particles); }));
+                record("StaticPhysics::calculateInfiniteWireMagneticField", threads, measure(options.repeats, [&] { static_physics->calculateInfiniteWireMagneticField(wires); }));
+                record("StaticPhysics::writeFields", threads, measure(options.repeats, [&] { static_physics->writeFields(config.outputFilename); }));
+
+                record("DynamicPhysics::calculateAcceleration", threads, measure(options.repeats, [&] { dynamic_physics->calculateAcceleration(particles); }));
+
+                // every repeat sorts the random order again (the copy is part of the time)
+                SpatialSort spatial_sort { config.bound, config.numPoints, Utilities::SortCurve::hilbert };
+                std::vector<ChargedParticle2D> sorted;
+                std::vector<Point2D> noAcceleration;
+                std::vector<std::uint8_t> noLevels;
+                record("SpatialSort::sort", threads, measure(options.repeats, [&]
+                {
+                    sorted = config.particles;
+                    spatial_sort.sort(sorted, noAcceleration, noLevels);
+                }));
+                record("StaticPhysics::calculateElectricField (sorted)", threads, measure(options.repeats, [&] { static_physics->calculateElectricField(sorted); }));
+                record("DynamicPhysics::calculateAcceleration (sorted)", threads, measure(options.repeats, [&] { dynamic_physics->calculateAcceleration(sorted); }));
+
+                // includes the grid electric field and handing the frame to the writer thread
+                record("DynamicPhysics::evolve", threads, measure(options.repeats, [&] { dynamic_physics->evolve(particles); }));
+            }
+        }
+    }
+
+    writeJson(options, results);
+    std::cout << "Results written to " << options.output << std::endl;
+
+    return 0;
+};
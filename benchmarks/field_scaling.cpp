@@ -0,0 +1,102 @@
+// Thread scaling of the grid field kernels (StaticPhysics::calculateElectricField / calculateInfiniteWireMagneticField)
+// Usage: field_scaling [numPoints=400] [numParticles=2000] [numWires=16] [repeats=5]
+// Prints grid points per second, speedup and parallel efficiency for 1, 2, 4, ... threads up to omp_get_max_threads()
+// (set OMP_PROC_BIND=close OMP_PLACES=cores for stable numbers on the big nodes)
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+#include "../src/StaticPhysics/StaticPhysics.hpp"
+
+namespace
+{
+    // best of `repeats` (the first call also pays for the page faults of the field arrays)
+    template <typename Kernel>
+    double bestTime(const std::size_t& repeats, Kernel kernel)
+    {
+        double best { 1e300 };
+        for (std::size_t r = 0; r < repeats; ++r)
+        {
+            const auto start { std::chrono::steady_clock::now() };
+            kernel();
+            const std::chrono::duration<double> elapsed { std::chrono::steady_clock::now() - start };
+            best = std::min(best, elapsed.count());
+        }
+        return best;
+    };
+};
+
+int main(int argc, char* argv[])
+{
+    const std::size_t numPoints { argc > 1 ? std::stoul(argv[1]) : 400 };
+    const std::size_t numParticles { argc > 2 ? std::stoul(argv[2]) : 2000 };
+    const std::size_t numWires { argc > 3 ? std::stoul(argv[3]) : 16 };
+    const std::size_t repeats { argc > 4 ? std::stoul(argv[4]) : 5 };
+
+    Utilities::Config config;
+    config.dim = 2;
+    config.bound = 10.;
+    config.numPoints = numPoints;
+    config.periodic = false;
+    config.forceSolver = Utilities::ForceSolver::direct;
+
+    // fixed seed so runs on different machines are comparable
+    std::mt19937 generator { 42 };
+    std::uniform_real_distribution<double> position { -config.bound, config.bound };
+    std::uniform_real_distribution<double> charge { -1., 1. };
+
+    std::vector<ChargedParticle2D> particles;
+    for (std::size_t i = 0; i < numParticles; ++i)
+    {
+        particles.push_back(ChargedParticle2D {charge(generator), 1., Point2D {position(generator), position(generator)}, Point3D {0., 0., 0.}});
+    }
+    std::vector<InfiniteWire2D> wires;
+    for (std::size_t i = 0; i < numWires; ++i)
+    {
+        Point3D direction { charge(generator), charge(generator), charge(generator) };
+        direction.normalize();
+        wires.push_back(InfiniteWire2D {charge(generator), Point2D {position(generator), position(generator)}, direction});
+    }
+
+    StaticPhysics<2> static_physics(config);
+    const double numGridPoints { static_cast<double>(static_physics.geometry().gridX().size()) };
+
+    std::cout << "grid points: " << static_cast<std::size_t>(numGridPoints) << ", particles: " << numParticles << ", wires: " << numWires
+              << ", field kernels: " << FieldKernels::isaName(FieldKernels::activeISA()) << std::endl;
+    std::cout << std::setw(8) << "threads"
+              << std::setw(16) << "E points/s" << std::setw(10) << "speedup" << std::setw(12) << "efficiency"
+              << std::setw(16) << "B points/s" << std::setw(10) << "speedup" << std::setw(12) << "efficiency" << std::endl;
+
+    const int maxThreads { omp_get_max_threads() };
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) { threadCounts.push_back(threads); }
+    threadCounts.push_back(maxThreads);
+
+    double baseE { 0. };
+    double baseB { 0. };
+    for (const int threads : threadCounts)
+    {
+        omp_set_num_threads(threads);
+        const double timeE { bestTime(repeats, [&] { static_physics.calculateElectricField(particles); }) };
+        const double timeB { bestTime(repeats, [&] { static_physics.calculateInfiniteWireMagneticField(wires); }) };
+
+        const double rateE { numGridPoints / timeE };
+        const double rateB { numGridPoints / timeB };
+        if (threads == 1) { baseE = rateE; baseB = rateB; }
+
+        std::cout << std::setw(8) << threads << std::scientific << std::setprecision(3)
+                  << std::setw(16) << rateE << std::fixed << std::setprecision(2) << std::setw(10) << rateE / baseE << std::setw(12) << rateE / baseE / threads
+                  << std::scientific << std::setprecision(3)
+                  << std::setw(16) << rateB << std::fixed << std::setprecision(2) << std::setw(10) << rateB / baseB << std::setw(12) << rateB / baseB / threads
+                  << std::endl;
+    }
+
+    return 0;
+};
@@ -1,6 +1,7 @@
 // #include "src/Geometry/Geometry.hpp"
 // #include "src/StaticPhysics/StaticPhysics.hpp"
 #include "src/DynamicPhysics/DynamicPhysics.hpp"
+#include "src/Ensemble/Ensemble.hpp"
 
 
 int main(int argc, char* argv[])
@@ -9,15 +10,32 @@ int main(int argc, char* argv[])
     {   
         std::cerr << "No input file given! " << std::endl;
         std::cerr << "Usage: " << argv[0] << " </path/to/config.json>" << std::endl;
+        return 1;
     };
 
-    // read the json file and set the dim, bound, and numPoints in the Utilities namespace
-    Utilities::readJsonFile(argv[1]);
-    // StaticPhysics static_physics(Utilities::dim, Utilities::bound, Utilities::numPoints);
-    // static_physics.run(Utilities::particles, Utilities::wires);
+    // read the json file, a config with an "ensemble" block runs all of its variants (see Ensemble.hpp)
+    const nlohmann::json _j = Utilities::loadJsonFile(argv[1]);
+    if (_j.contains("ensemble"))
+    {
+        Ensemble ensemble(_j);
+        ensemble.run();
+        return 0;
+    }
+
+    Utilities::Config config { Utilities::parseConfig(_j) };
+    // StaticPhysics<2> static_physics(config);
+    // static_physics.run(config.particles, config.wires);
     
-    DynamicPhysics dynamic_physics(Utilities::dim, Utilities::bound, Utilities::numPoints, Utilities::numSteps, Utilities::dt);
-    dynamic_physics.run(Utilities::particles, Utilities::wires);
+    if (config.dim == 3)
+    {
+        DynamicPhysics<3> dynamic_physics(config);
+        dynamic_physics.run(config.particles3D, config.wires);
+    }
+    else
+    {
+        DynamicPhysics<2> dynamic_physics(config);
+        dynamic_physics.run(config.particles, config.wires);
+    }
 
     return 0;
 }
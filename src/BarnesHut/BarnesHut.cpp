@@ -0,0 +1,294 @@
+#include "BarnesHut.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+BarnesHut::BarnesHut(const double& bound, const bool& periodic, const double& theta)
+    : m_bound {bound}
+    , m_periodic {periodic}
+    , m_theta {theta}
+    , m_nodes {}
+    , m_indices {}
+    , m_scratch {}
+{}
+
+bool BarnesHut::splitNode(std::vector<Node>& nodes, std::size_t idx, std::size_t depth, const std::vector<ChargedParticle2D>& particles)
+{
+    // copy what we need, `nodes` may reallocate once the children are appended
+    const Node parent { nodes[idx] };
+    if (parent.end - parent.begin <= s_leafSize || depth >= s_maxDepth) { return false; }
+
+    // counting sort of the node's index range into the four quadrants (0: -x-y, 1: +x-y, 2: -x+y, 3: +x+y)
+    auto quadrant = [&](std::size_t i)
+    {
+        const Point2D& position { particles[i].position };
+        return static_cast<std::size_t>(position.x() >= parent.centerX) + 2 * static_cast<std::size_t>(position.y() >= parent.centerY);
+    };
+
+    std::size_t counts[4] {0, 0, 0, 0};
+    for (std::size_t k = parent.begin; k < parent.end; ++k) { ++counts[quadrant(m_indices[k])]; }
+
+    std::size_t offsets[4] { parent.begin, parent.begin + counts[0], parent.begin + counts[0] + counts[1], parent.begin + counts[0] + counts[1] + counts[2] };
+    const std::size_t starts[4] { offsets[0], offsets[1], offsets[2], offsets[3] };
+    for (std::size_t k = parent.begin; k < parent.end; ++k)
+    {
+        const std::size_t i { m_indices[k] };
+        m_scratch[offsets[quadrant(i)]++] = i;
+    }
+    std::copy(m_scratch.begin() + static_cast<std::ptrdiff_t>(parent.begin), m_scratch.begin() + static_cast<std::ptrdiff_t>(parent.end), m_indices.begin() + static_cast<std::ptrdiff_t>(parent.begin));
+
+    const double quarter { 0.5 * parent.halfWidth };
+    nodes[idx].firstChild = static_cast<std::int64_t>(nodes.size());
+    for (std::size_t q = 0; q < 4; ++q)
+    {
+        nodes.emplace_back(Node
+        {
+            .centerX = parent.centerX + ((q & 1) ? quarter : -quarter),
+            .centerY = parent.centerY + ((q & 2) ? quarter : -quarter),
+            .halfWidth = quarter,
+            .begin = starts[q],
+            .end = starts[q] + counts[q]
+        });
+    }
+
+    return true;
+};
+
+void BarnesHut::buildSubtree(std::vector<Node>& nodes, std::size_t idx, std::size_t depth, const std::vector<ChargedParticle2D>& particles)
+{
+    if (splitNode(nodes, idx, depth, particles))
+    {
+        const std::size_t firstChild { static_cast<std::size_t>(nodes[idx].firstChild) };
+        for (std::size_t q = 0; q < 4; ++q)
+        {
+            buildSubtree(nodes, firstChild + q, depth + 1, particles);
+        }
+    }
+
+    computeMoments(nodes, idx, particles);
+};
+
+void BarnesHut::computeMoments(std::vector<Node>& nodes, std::size_t idx, const std::vector<ChargedParticle2D>& particles) const
+{
+    Node& node { nodes[idx] };
+    node.charge = 0.;
+    node.absCharge = 0.;
+    node.comX = 0.;
+    node.comY = 0.;
+    node.dipoleX = 0.;
+    node.dipoleY = 0.;
+
+    if (node.firstChild < 0)
+    {
+        for (std::size_t k = node.begin; k < node.end; ++k)
+        {
+            const ChargedParticle2D& particle { particles[m_indices[k]] };
+            node.charge += particle.charge;
+            node.absCharge += std::abs(particle.charge);
+            node.comX += std::abs(particle.charge) * particle.position.x();
+            node.comY += std::abs(particle.charge) * particle.position.y();
+        }
+    }
+    else
+    {
+        for (std::size_t q = 0; q < 4; ++q)
+        {
+            const Node& child { nodes[static_cast<std::size_t>(node.firstChild) + q] };
+            node.charge += child.charge;
+            node.absCharge += child.absCharge;
+            node.comX += child.absCharge * child.comX;
+            node.comY += child.absCharge * child.comY;
+        }
+    }
+
+    if (node.absCharge == 0.)
+    {
+        // uncharged (or empty) cell, it never contributes to the field
+        node.comX = node.centerX;
+        node.comY = node.centerY;
+        return;
+    }
+
+    node.comX /= node.absCharge;
+    node.comY /= node.absCharge;
+
+    // dipole moment about the center of charge (the children's dipoles are shifted to the parent's center)
+    if (node.firstChild < 0)
+    {
+        for (std::size_t k = node.begin; k < node.end; ++k)
+        {
+            const ChargedParticle2D& particle { particles[m_indices[k]] };
+            node.dipoleX += particle.charge * (particle.position.x() - node.comX);
+            node.dipoleY += particle.charge * (particle.position.y() - node.comY);
+        }
+    }
+    else
+    {
+        for (std::size_t q = 0; q < 4; ++q)
+        {
+            const Node& child { nodes[static_cast<std::size_t>(node.firstChild) + q] };
+            node.dipoleX += child.dipoleX + child.charge * (child.comX - node.comX);
+            node.dipoleY += child.dipoleY + child.charge * (child.comY - node.comY);
+        }
+    }
+};
+
+void BarnesHut::build(const std::vector<ChargedParticle2D>& particles)
+{
+    const std::size_t numParticles { particles.size() };
+    m_indices.resize(numParticles);
+    m_scratch.resize(numParticles);
+    for (std::size_t i = 0; i < numParticles; ++i) { m_indices[i] = i; }
+
+    m_nodes.clear();
+    m_nodes.emplace_back(Node { .centerX = 0., .centerY = 0., .halfWidth = m_bound, .begin = 0, .end = numParticles });
+
+    // split the top levels serially, which leaves (up to) 4^s_parallelDepth independent subtrees
+    std::vector<std::size_t> frontier { 0 };
+    for (std::size_t depth = 0; depth < s_parallelDepth; ++depth)
+    {
+        std::vector<std::size_t> next;
+        for (const std::size_t idx : frontier)
+        {
+            if (splitNode(m_nodes, idx, depth, particles))
+            {
+                for (std::size_t q = 0; q < 4; ++q) { next.push_back(static_cast<std::size_t>(m_nodes[idx].firstChild) + q); }
+            }
+        }
+        frontier = std::move(next);
+    }
+    const std::size_t numTopNodes { m_nodes.size() };
+
+    // each subtree only touches its own range of m_indices, so they can be built at the same time into separate node lists
+    std::vector<std::vector<Node>> subtrees(frontier.size());
+    #pragma omp parallel for schedule(dynamic)
+    for (std::size_t k = 0; k < frontier.size(); ++k)
+    {
+        subtrees[k].push_back(m_nodes[frontier[k]]);
+        buildSubtree(subtrees[k], 0, s_parallelDepth, particles);
+    }
+
+    // splice the subtrees back in (local node l > 0 ends up at offset + l)
+    std::vector<bool> isFrontier(numTopNodes, false);
+    for (std::size_t k = 0; k < frontier.size(); ++k)
+    {
+        isFrontier[frontier[k]] = true;
+        const std::int64_t offset { static_cast<std::int64_t>(m_nodes.size()) - 1 };
+        for (Node& node : subtrees[k])
+        {
+            if (node.firstChild >= 0) { node.firstChild += offset; }
+        }
+
+        m_nodes[frontier[k]] = subtrees[k].front();
+        m_nodes.insert(m_nodes.end(), subtrees[k].begin() + 1, subtrees[k].end());
+    }
+
+    // children always come after their parent, so walking the top nodes backwards visits the children first
+    for (std::size_t idx = numTopNodes; idx-- > 0;)
+    {
+        if (!isFrontier[idx]) { computeMoments(m_nodes, idx, particles); }
+    }
+};
+
+bool BarnesHut::acceptNode(const Node& node, const Point2D& position) const
+{
+    const Point2D toCenter { Utilities::r_prime(position, Point2D{node.centerX, node.centerY}, m_periodic, m_bound) };
+
+    // never approximate a cell that contains the particle itself
+    if (std::abs(toCenter.x()) <= node.halfWidth && std::abs(toCenter.y()) <= node.halfWidth) { return false; }
+
+    // with periodic boundaries the whole cell has to lie within the minimum image of the particle,
+    // otherwise part of it would be seen from the other side of the domain by the direct sum
+    if (m_periodic && (std::abs(toCenter.x()) + node.halfWidth >= m_bound || std::abs(toCenter.y()) + node.halfWidth >= m_bound)) { return false; }
+
+    const Point2D r { Utilities::r_prime(position, Point2D{node.comX, node.comY}, m_periodic, m_bound) };
+    const double size { 2 * node.halfWidth };
+
+    return size * size < m_theta * m_theta * (r.x()*r.x() + r.y()*r.y());
+};
+
+Point2D BarnesHut::fieldAt(std::size_t target, const std::vector<ChargedParticle2D>& particles, std::size_t& interactions) const
+{
+    const Point2D& position { particles[target].position };
+    double Ex { 0. };
+    double Ey { 0. };
+
+    std::size_t stack[4 * s_maxDepth + 4];
+    std::size_t stackSize { 0 };
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const Node& node { m_nodes[stack[--stackSize]] };
+        if (node.absCharge == 0.) { continue; }
+
+        if (acceptNode(node, position))
+        {
+            // monopole + dipole expansion about the center of charge
+            ++interactions;
+            const Point2D r { Utilities::r_prime(position, Point2D{node.comX, node.comY}, m_periodic, m_bound) };
+            const double r2 { r.x()*r.x() + r.y()*r.y() };
+            const double inv_r { 1. / std::sqrt(r2) };
+            const double inv_r3 { inv_r * inv_r * inv_r };
+            const double p_dot_r { node.dipoleX * r.x() + node.dipoleY * r.y() };
+
+            Ex += node.charge * r.x() * inv_r3 + 3 * p_dot_r * r.x() * inv_r3 / r2 - node.dipoleX * inv_r3;
+            Ey += node.charge * r.y() * inv_r3 + 3 * p_dot_r * r.y() * inv_r3 / r2 - node.dipoleY * inv_r3;
+        }
+        else if (node.firstChild < 0)
+        {
+            for (std::size_t k = node.begin; k < node.end; ++k)
+            {
+                const std::size_t j { m_indices[k] };
+                if (j == target) { continue; }
+                ++interactions;
+
+                const Point2D r { Utilities::r_prime(position, particles[j].position, m_periodic, m_bound) };
+                const double r_mag { r.x()*r.x() + r.y()*r.y() };
+                const double inv_r3 { 1. / (r_mag * std::sqrt(r_mag)) };
+
+                Ex += particles[j].charge * r.x() * inv_r3;
+                Ey += particles[j].charge * r.y() * inv_r3;
+            }
+        }
+        else
+        {
+            for (std::size_t q = 0; q < 4; ++q) { stack[stackSize++] = static_cast<std::size_t>(node.firstChild) + q; }
+        }
+    }
+
+    return Point2D {Ex, Ey};
+};
+
+std::vector<Point2D> BarnesHut::calculateAcceleration(const std::vector<ChargedParticle2D>& particles)
+{
+    std::vector<Point2D> acceleration(particles.size(), Point2D{ 0.0, 0.0 });
+
+    std::size_t interactions { 0 };
+
+    #pragma omp parallel for schedule(dynamic, 64) reduction(+:interactions)
+    for (std::size_t i = 0; i < particles.size(); ++i)
+    {
+        acceleration[i] = (particles[i].charge / particles[i].mass) * fieldAt(i, particles, interactions);
+    }
+
+    m_interactions = interactions;
+    return acceleration;
+};
+
+std::vector<Point2D> BarnesHut::calculateAcceleration(const std::vector<ChargedParticle2D>& particles, const std::vector<std::size_t>& targets)
+{
+    std::vector<Point2D> acceleration(targets.size(), Point2D{ 0.0, 0.0 });
+
+    std::size_t interactions { 0 };
+
+    #pragma omp parallel for schedule(dynamic, 64) reduction(+:interactions)
+    for (std::size_t k = 0; k < targets.size(); ++k)
+    {
+        const std::size_t i { targets[k] };
+        acceleration[k] = (particles[i].charge / particles[i].mass) * fieldAt(i, particles, interactions);
+    }
+
+    m_interactions = interactions;
+    return acceleration;
+};
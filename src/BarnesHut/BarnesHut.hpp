@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "../Points/Points.hpp"
+#include "../Utilities/Utilities.hpp"
+
+// Barnes-Hut quadtree for approximating the pairwise Coulomb accelerations in O(N log N)
+// The charges can have either sign, so each node keeps the net charge, the |q|-weighted "center of charge"
+// and the dipole moment about that center (a neutral cluster would otherwise contribute nothing at all)
+
+class BarnesHut
+{
+private:
+    struct Node
+    {
+        double centerX; // geometric center of the cell
+        double centerY;
+        double halfWidth;
+        double charge { 0. }; // net (signed) charge
+        double absCharge { 0. };
+        double comX { 0. }; // |q|-weighted center of the charges in the cell
+        double comY { 0. };
+        double dipoleX { 0. }; // dipole moment about (comX, comY)
+        double dipoleY { 0. };
+        std::size_t begin; // range into m_indices
+        std::size_t end;
+        std::int64_t firstChild { -1 }; // the four children are stored next to each other, -1 for a leaf
+    };
+
+    double m_bound;
+    bool m_periodic;
+    double m_theta; // opening angle, smaller is more accurate (0 reduces to direct summation)
+
+    static constexpr std::size_t s_leafSize { 8 };
+    static constexpr std::size_t s_maxDepth { 32 }; // stops the recursion for (nearly) coincident particles
+    static constexpr std::size_t s_parallelDepth { 2 }; // subtrees below this depth are built in parallel
+
+    std::vector<Node> m_nodes;
+    std::vector<std::size_t> m_indices; // particle indices, sorted so that every node owns a contiguous range
+    std::vector<std::size_t> m_scratch;
+    std::size_t m_interactions { 0 }; // node and particle interactions of the last walk
+
+    bool splitNode(std::vector<Node>& nodes, std::size_t idx, std::size_t depth, const std::vector<ChargedParticle2D>& particles);
+    void buildSubtree(std::vector<Node>& nodes, std::size_t idx, std::size_t depth, const std::vector<ChargedParticle2D>& particles);
+    void computeMoments(std::vector<Node>& nodes, std::size_t idx, const std::vector<ChargedParticle2D>& particles) const;
+
+    bool acceptNode(const Node& node, const Point2D& position) const;
+    // adds the accepted nodes and particle pairs it evaluates to `interactions`
+    Point2D fieldAt(std::size_t target, const std::vector<ChargedParticle2D>& particles, std::size_t& interactions) const;
+
+public:
+    BarnesHut(const double& bound, const bool& periodic, const double& theta);
+
+    // (re)builds the tree from the current particle positions
+    void build(const std::vector<ChargedParticle2D>& particles);
+
+    // walks the tree for every particle, `build` must have been called with the same particles first
+    std::vector<Point2D> calculateAcceleration(const std::vector<ChargedParticle2D>& particles);
+    // only for the particles in `targets` (block time-stepping), in the same order
+    std::vector<Point2D> calculateAcceleration(const std::vector<ChargedParticle2D>& particles, const std::vector<std::size_t>& targets);
+
+    // Getters
+    std::size_t numNodes() const { return m_nodes.size(); }
+    std::size_t interactions() const { return m_interactions; }
+};
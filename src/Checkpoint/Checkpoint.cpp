@@ -0,0 +1,359 @@
+#include "Checkpoint.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <unistd.h>
+
+namespace
+{
+    constexpr char s_magic[8] { 'C', 'E', 'M', 'C', 'K', 'P', 'T', '\0' };
+
+    std::uint64_t fnv1a(const char* data, const std::size_t& size, std::uint64_t hash = 14695981039346656037ull)
+    {
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    };
+
+    template <typename T>
+    void put(char*& out, const T& value)
+    {
+        std::memcpy(out, &value, sizeof(T));
+        out += sizeof(T);
+    };
+
+    template <typename T>
+    T get(const char*& in)
+    {
+        T value;
+        std::memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return value;
+    };
+
+    // writes all of `size` bytes (write may return early)
+    void writeAll(const int& fd, const char* data, std::size_t size, const std::string& path)
+    {
+        while (size > 0)
+        {
+            const ssize_t written { ::write(fd, data, size) };
+            if (written < 0)
+            {
+                if (errno == EINTR) { continue; }
+                throw std::ios_base::failure("Failed to write checkpoint " + path + ": " + std::strerror(errno));
+            }
+            data += written;
+            size -= static_cast<std::size_t>(written);
+        }
+    };
+};
+
+std::size_t Checkpoint::payloadBytes(const std::size_t& dim, const std::size_t& numParticles, const std::size_t& potentialSize)
+{
+    return (2 + dim + 3 + dim) * numParticles * sizeof(double) + numParticles + numParticles * sizeof(std::uint64_t)
+         + sizeof(std::uint64_t) + potentialSize * sizeof(double) + sizeof(std::uint64_t);
+};
+
+Checkpoint::Checkpoint(const Utilities::Config& config)
+    : m_path {config.checkpointFile}
+    , m_interval {config.checkpointInterval}
+    , m_seconds {config.checkpointSeconds}
+    , m_configHash {configHash(config)}
+    , m_lastWrite {std::chrono::steady_clock::now()}
+{
+};
+
+Checkpoint::~Checkpoint()
+{
+    if (m_worker.joinable()) { m_worker.join(); }
+};
+
+std::uint64_t Checkpoint::configHash(const Utilities::Config& config)
+{
+    // bit exact text of every value (17 significant digits round trip a double)
+    std::ostringstream settings;
+    settings << std::setprecision(17) << config.dim << ' ' << config.bound << ' ' << config.periodic << ' ' << config.numPoints << ' ' << config.dt
+             << ' ' << static_cast<int>(config.forceSolver) << ' ' << config.theta << ' ' << static_cast<int>(config.assignment) << ' ' << static_cast<int>(config.integrator)
+             << ' ' << config.timestepLevels << ' ' << config.timestepAccuracy
+             << ' ' << config.ewaldTolerance << ' ' << config.ewaldCutoff << ' ' << config.pppmMesh;
+    for (const InfiniteWire2D& wire : config.wires)
+    {
+        settings << ' ' << wire.current << ' ' << wire.position.x() << ' ' << wire.position.y()
+                 << ' ' << wire.direction.x() << ' ' << wire.direction.y() << ' ' << wire.direction.z();
+    }
+    settings << ' ' << config.velocityClamp
+             << ' ' << static_cast<int>(config.boundary) << ' ' << config.boundaryPotential << ' ' << config.multigridTolerance << ' ' << config.multigridCycles;
+    for (const Utilities::Conductor& conductor : config.conductors)
+    {
+        settings << ' ' << conductor.potential << ' ' << conductor.box.xMin << ' ' << conductor.box.xMax << ' ' << conductor.box.yMin << ' ' << conductor.box.yMax
+                 << ' ' << conductor.x << ' ' << conductor.y << ' ' << conductor.radius;
+    }
+    settings << ' ' << config.sortInterval << ' ' << static_cast<int>(config.sortCurve)
+             << ' ' << config.absorbing << ' ' << static_cast<int>(config.collisions) << ' ' << config.collisionRadius << ' ' << config.seed;
+    for (const Utilities::Source& source : config.sources)
+    {
+        settings << ' ' << source.rate << ' ' << source.charge << ' ' << source.mass << ' ' << source.temperature
+                 << ' ' << source.drift.x() << ' ' << source.drift.y() << ' ' << source.drift.z()
+                 << ' ' << source.box.xMin << ' ' << source.box.xMax << ' ' << source.box.yMin << ' ' << source.box.yMax << ' ' << source.box.zMin << ' ' << source.box.zMax
+                 << ' ' << source.start << ' ' << source.stop;
+    }
+
+    const std::string text { settings.str() };
+    return fnv1a(text.data(), text.size());
+};
+
+bool Checkpoint::isDue(const std::size_t& iteration) const
+{
+    if (m_interval > 0 && iteration % m_interval == 0) { return true; }
+    if (m_seconds <= 0.) { return false; }
+
+    const std::chrono::duration<double> elapsed { std::chrono::steady_clock::now() - m_lastWrite };
+    return elapsed.count() >= m_seconds;
+};
+
+template <std::size_t N>
+void Checkpoint::write(const std::size_t& iteration, const std::vector<ChargedParticle<N>>& particles, const std::vector<Point<N>>& acceleration,
+                       const std::vector<std::uint8_t>& levels, const std::vector<double>& potential, const std::size_t& ewaldParticles)
+{
+    const auto start { std::chrono::steady_clock::now() };
+    join();
+    const auto joined { std::chrono::steady_clock::now() };
+
+    const std::size_t numParticles { particles.size() };
+    const std::size_t payloadSize { payloadBytes(N, numParticles, potential.size()) };
+    m_buffer.resize(s_headerSize + payloadSize + sizeof(std::uint64_t));
+
+    char* out { m_buffer.data() };
+    std::memcpy(out, s_magic, sizeof(s_magic));
+    out += sizeof(s_magic);
+    put<std::uint32_t>(out, s_version);
+    put<std::uint32_t>(out, static_cast<std::uint32_t>(N));
+    put<std::uint64_t>(out, m_configHash);
+    put<std::uint64_t>(out, static_cast<std::uint64_t>(iteration));
+    put<std::uint64_t>(out, static_cast<std::uint64_t>(numParticles));
+    put<std::uint64_t>(out, static_cast<std::uint64_t>(payloadSize));
+
+    // one array per quantity, like the particles of a frame record
+    for (const ChargedParticle<N>& particle : particles) { put<double>(out, particle.charge); }
+    for (const ChargedParticle<N>& particle : particles) { put<double>(out, particle.mass); }
+    for (std::size_t d = 0; d < N; ++d)
+    {
+        for (const ChargedParticle<N>& particle : particles) { put<double>(out, particle.position[d]); }
+    }
+    for (std::size_t d = 0; d < 3; ++d)
+    {
+        for (const ChargedParticle<N>& particle : particles) { put<double>(out, particle.velocity[d]); }
+    }
+    for (std::size_t d = 0; d < N; ++d)
+    {
+        for (const Point<N>& a : acceleration) { put<double>(out, a[d]); }
+    }
+    for (std::size_t i = 0; i < numParticles; ++i) { put<std::uint8_t>(out, levels.size() == numParticles ? levels[i] : 0); }
+    for (const ChargedParticle<N>& particle : particles) { put<std::uint64_t>(out, particle.id); }
+    put<std::uint64_t>(out, static_cast<std::uint64_t>(potential.size()));
+    if (!potential.empty())
+    {
+        std::memcpy(out, potential.data(), potential.size() * sizeof(double));
+        out += potential.size() * sizeof(double);
+    }
+    put<std::uint64_t>(out, static_cast<std::uint64_t>(ewaldParticles));
+
+    m_lastWrite = std::chrono::steady_clock::now();
+    m_lastIteration = iteration;
+    m_written = true;
+    m_bytes = m_buffer.size();
+
+    const std::chrono::duration<double> stalled { joined - start };
+    const std::chrono::duration<double> copied { m_lastWrite - joined };
+    m_stallTime += stalled.count();
+    m_copyTime += copied.count();
+
+    // the checksum and the disk are the writer thread's business
+    m_worker = std::thread(&Checkpoint::writeFile, this);
+};
+
+void Checkpoint::writeFile()
+{
+    try
+    {
+        const std::size_t checksumOffset { m_buffer.size() - sizeof(std::uint64_t) };
+        const std::uint64_t checksum { fnv1a(m_buffer.data(), checksumOffset) };
+        std::memcpy(m_buffer.data() + checksumOffset, &checksum, sizeof(checksum));
+
+        const std::filesystem::path path { m_path };
+        const std::filesystem::path directory { path.has_parent_path() ? path.parent_path() : std::filesystem::path(".") };
+        std::filesystem::create_directories(directory);
+
+        const std::string tempPath { m_path + ".tmp" };
+        const int fd { ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644) };
+        if (fd < 0)
+        {
+            throw std::ios_base::failure("Failed to open file for writing: " + tempPath);
+        }
+        try
+        {
+            writeAll(fd, m_buffer.data(), m_buffer.size(), tempPath);
+            if (::fsync(fd) != 0)
+            {
+                throw std::ios_base::failure("Failed to sync checkpoint " + tempPath + ": " + std::strerror(errno));
+            }
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+
+        // the rename is atomic, then the directory entry is synced so the new name survives a power loss as well
+        std::filesystem::rename(tempPath, path);
+        const int directoryFd { ::open(directory.c_str(), O_RDONLY) };
+        if (directoryFd >= 0)
+        {
+            ::fsync(directoryFd);
+            ::close(directoryFd);
+        }
+
+        ++m_numWritten;
+        m_bytesWritten += m_buffer.size();
+    }
+    catch (const std::exception& error)
+    {
+        m_error = error.what();
+    }
+};
+
+void Checkpoint::join()
+{
+    if (!m_worker.joinable()) { return; }
+
+    m_worker.join();
+    if (!m_error.empty())
+    {
+        std::cerr << m_error << "! Keeping the previous checkpoint..." << std::endl;
+        m_error.clear();
+    }
+};
+
+void Checkpoint::finish()
+{
+    join();
+};
+
+template <std::size_t N>
+std::size_t Checkpoint::read(const std::string& path, std::vector<ChargedParticle<N>>& particles, std::vector<Point<N>>& acceleration,
+                             std::vector<std::uint8_t>& levels, std::vector<double>& potential, std::size_t& ewaldParticles) const
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        throw std::ios_base::failure("Failed to open checkpoint: " + path);
+    }
+
+    const std::streamsize size { file.tellg() };
+    std::vector<char> buffer(static_cast<std::size_t>(std::max<std::streamsize>(size, 0)));
+    file.seekg(0);
+    file.read(buffer.data(), size);
+    if (!file || buffer.size() < s_headerSize + sizeof(std::uint64_t) || std::memcmp(buffer.data(), s_magic, sizeof(s_magic)) != 0)
+    {
+        throw std::ios_base::failure("Not a checkpoint: " + path);
+    }
+
+    const char* in { buffer.data() + sizeof(s_magic) };
+    const std::uint32_t version { get<std::uint32_t>(in) };
+    const std::uint32_t dim { get<std::uint32_t>(in) };
+    const std::uint64_t hash { get<std::uint64_t>(in) };
+    const std::size_t iteration { static_cast<std::size_t>(get<std::uint64_t>(in)) };
+    const std::size_t numParticles { static_cast<std::size_t>(get<std::uint64_t>(in)) };
+    const std::size_t payloadSize { static_cast<std::size_t>(get<std::uint64_t>(in)) };
+
+    if (version != s_version)
+    {
+        throw std::ios_base::failure("Unsupported checkpoint version " + std::to_string(version) + ": " + path);
+    }
+    // payload bytes before the potential values (the last of them is the number of values)
+    const std::size_t particleBytes { payloadBytes(N, numParticles, 0) - sizeof(std::uint64_t) };
+    std::uint64_t potentialSize { 0 };
+    if (particleBytes <= payloadSize && s_headerSize + particleBytes <= buffer.size())
+    {
+        std::memcpy(&potentialSize, buffer.data() + s_headerSize + particleBytes - sizeof(std::uint64_t), sizeof(potentialSize));
+    }
+    if (potentialSize > payloadSize / sizeof(double) || payloadSize != payloadBytes(N, numParticles, static_cast<std::size_t>(potentialSize))
+        || buffer.size() != s_headerSize + payloadSize + sizeof(std::uint64_t))
+    {
+        throw std::ios_base::failure("Truncated checkpoint: " + path);
+    }
+    std::uint64_t checksum;
+    std::memcpy(&checksum, buffer.data() + s_headerSize + payloadSize, sizeof(checksum));
+    if (checksum != fnv1a(buffer.data(), s_headerSize + payloadSize))
+    {
+        throw std::ios_base::failure("Corrupted checkpoint (checksum mismatch): " + path);
+    }
+    if (dim != N)
+    {
+        throw std::runtime_error("Checkpoint " + path + " is of a " + std::to_string(dim) + "D run, this run is " + std::to_string(N) + "D!");
+    }
+    if (hash != m_configHash)
+    {
+        throw std::runtime_error("Checkpoint " + path + " was written with different settings (dim, bound, numPoints, periodic, dt, integrator, force solver, wires, population, sorting or conductors)!");
+    }
+
+    const double* values { reinterpret_cast<const double*>(in) };
+    const auto array { [&](const std::size_t& k) { return values + k * numParticles; } };
+
+    particles.clear();
+    particles.reserve(numParticles);
+    acceleration.assign(numParticles, Point<N> {});
+    for (std::size_t i = 0; i < numParticles; ++i)
+    {
+        Point<N> position;
+        for (std::size_t d = 0; d < N; ++d) { position[d] = array(2 + d)[i]; }
+        const Point3D velocity { array(2 + N)[i], array(3 + N)[i], array(4 + N)[i] };
+        particles.emplace_back(ChargedParticle<N>{array(0)[i], array(1)[i], position, velocity});
+
+        for (std::size_t d = 0; d < N; ++d) { acceleration[i][d] = array(5 + N + d)[i]; }
+    }
+
+    const unsigned char* levelBytes { reinterpret_cast<const unsigned char*>(array(5 + 2 * N)) };
+    levels.assign(levelBytes, levelBytes + numParticles);
+
+    const char* idBytes { reinterpret_cast<const char*>(levelBytes + numParticles) };
+    for (std::size_t i = 0; i < numParticles; ++i)
+    {
+        std::memcpy(&particles[i].id, idBytes + i * sizeof(std::uint64_t), sizeof(std::uint64_t));
+    }
+
+    potential.assign(static_cast<std::size_t>(potentialSize), 0.);
+    if (potentialSize > 0)
+    {
+        std::memcpy(potential.data(), buffer.data() + s_headerSize + particleBytes, potential.size() * sizeof(double));
+    }
+
+    std::uint64_t tuned;
+    std::memcpy(&tuned, buffer.data() + s_headerSize + particleBytes + potential.size() * sizeof(double), sizeof(tuned));
+    ewaldParticles = static_cast<std::size_t>(tuned);
+
+    return iteration;
+};
+
+void Checkpoint::report(std::ostream& out) const
+{
+    out << "checkpoints: " << m_numWritten << " written to " << m_path << " (" << std::fixed << std::setprecision(2) << static_cast<double>(m_bytes) / 1e6
+        << " MB each), the run spent " << std::setprecision(3) << m_copyTime << " s copying the state and " << m_stallTime << " s waiting for a write"
+        << std::defaultfloat << std::endl;
+};
+
+template void Checkpoint::write<2>(const std::size_t&, const std::vector<ChargedParticle2D>&, const std::vector<Point2D>&, const std::vector<std::uint8_t>&, const std::vector<double>&, const std::size_t&);
+template void Checkpoint::write<3>(const std::size_t&, const std::vector<ChargedParticle3D>&, const std::vector<Point3D>&, const std::vector<std::uint8_t>&, const std::vector<double>&, const std::size_t&);
+template std::size_t Checkpoint::read<2>(const std::string&, std::vector<ChargedParticle2D>&, std::vector<Point2D>&, std::vector<std::uint8_t>&, std::vector<double>&, std::size_t&) const;
+template std::size_t Checkpoint::read<3>(const std::string&, std::vector<ChargedParticle3D>&, std::vector<Point3D>&, std::vector<std::uint8_t>&, std::vector<double>&, std::size_t&) const;
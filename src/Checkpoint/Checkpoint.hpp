@@ -0,0 +1,118 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Points/Points.hpp"
+#include "../Utilities/Utilities.hpp"
+
+/*
+Checkpoint file (`<output directory>/<output filename>.ckpt` unless "checkpoint file" is set), all values little-endian
+
+Holds the whole state of the integrator, so a run restarted from it ("restart": true) continues bit for bit as if it had never stopped.
+The particle-mesh and pppm solvers sum one charge mesh per thread in thread order, so they only continue bit for bit with the same
+number of threads (OMP_NUM_THREADS) as the interrupted run.
+
+header (48 bytes):
+    char[8]     magic "CEMCKPT" (zero terminated)
+    uint32      version
+    uint32      dim
+    uint64      hash of the settings that change the trajectory (see Checkpoint::configHash)
+    uint64      iteration
+    uint64      number of particles N
+    uint64      payload bytes
+
+payload:
+    double      charge[N], mass[N]
+    double      x[N], y[N] (, z[N]) positions
+    double      vx[N], vy[N], vz[N] velocities (always 3 components)
+    double      ax[N], ay[N] (, az[N]) accelerations of the last force solve (the Verlet velocity update needs them)
+    uint8       level[N] time-step level of each particle (block time-stepping, 0 otherwise)
+    uint64      id[N] of each particle (see ChargedParticle)
+    uint64      number of potential values P (0 unless the force solver is "multigrid")
+    double      potential[P] the multigrid solver starts its next solve from (see Multigrid.hpp)
+    uint64      number of particles the ewald or pppm parameters were chosen for (0 for the other force solvers, see Ewald.hpp)
+
+trailer:
+    uint64      FNV-1a hash of the header and payload
+
+The file is written to `<checkpoint file>.tmp`, synced and then renamed over the previous checkpoint, so a crash
+at any point leaves either the old or the new checkpoint behind, never a partial one.
+*/
+
+// Writes the checkpoints of a run on a background thread and reads them back for a restart.
+// The step thread only copies the state into a buffer (a memcpy per particle), the file is written while the run goes on.
+class Checkpoint
+{
+private:
+    std::string m_path;
+    std::size_t m_interval { 0 }; // steps between checkpoints (0: off)
+    double m_seconds { 0. }; // wall time between checkpoints (0: off)
+    std::uint64_t m_configHash { 0 };
+
+    std::chrono::steady_clock::time_point m_lastWrite;
+    std::size_t m_lastIteration { 0 };
+    bool m_written { false };
+
+    std::vector<char> m_buffer; // owned by the writer thread while it runs
+    std::thread m_worker;
+    std::string m_error; // what the last write failed with (only read after joining the writer thread)
+
+    // statistics
+    std::size_t m_numWritten { 0 };
+    std::size_t m_bytes { 0 }; // size of the last checkpoint
+    std::size_t m_bytesWritten { 0 }; // of every checkpoint written (only read after joining the writer thread)
+    double m_copyTime { 0. }; // seconds the step thread spent copying the state
+    double m_stallTime { 0. }; // seconds the step thread waited for the previous write
+
+    // waits for the write in flight and reports its error (the previous checkpoint is still there if it failed)
+    void join();
+    void writeFile();
+    static std::size_t payloadBytes(const std::size_t& dim, const std::size_t& numParticles, const std::size_t& potentialSize);
+
+public:
+    static constexpr std::uint32_t s_version { 1 };
+    static constexpr std::size_t s_headerSize { 48 };
+
+    explicit Checkpoint(const Utilities::Config& config);
+    ~Checkpoint();
+
+    Checkpoint(const Checkpoint&) = delete;
+    Checkpoint& operator=(const Checkpoint&) = delete;
+
+    // FNV-1a hash of everything that changes the trajectory: the domain, dt, the integrator, the force solver and its parameters, the wires
+    // and the population rules (sources, absorbing walls, collisions, velocity clamp).
+    // The number of steps and the output settings are left out, so a restart can run longer or write differently.
+    static std::uint64_t configHash(const Utilities::Config& config);
+
+    bool enabled() const { return m_interval > 0 || m_seconds > 0.; }
+    // every "checkpoint interval" steps or once "checkpoint seconds" have passed since the last checkpoint
+    bool isDue(const std::size_t& iteration) const;
+
+    // copies the state and hands it to the writer thread (waits for the previous write first),
+    // `potential` is the multigrid warm start (empty for the other force solvers), `ewaldParticles` the number of particles
+    // the ewald or pppm parameters were chosen for (0 for the other force solvers)
+    template <std::size_t N>
+    void write(const std::size_t& iteration, const std::vector<ChargedParticle<N>>& particles, const std::vector<Point<N>>& acceleration,
+               const std::vector<std::uint8_t>& levels, const std::vector<double>& potential, const std::size_t& ewaldParticles);
+
+    // waits for the last write
+    void finish();
+
+    // replaces the particles, accelerations, time-step levels, multigrid potential and tuned ewald particle number with the ones of
+    // the checkpoint at `path` and returns its iteration, throws if the file is damaged or was written by a run with different settings
+    template <std::size_t N>
+    std::size_t read(const std::string& path, std::vector<ChargedParticle<N>>& particles, std::vector<Point<N>>& acceleration,
+                     std::vector<std::uint8_t>& levels, std::vector<double>& potential, std::size_t& ewaldParticles) const;
+
+    void report(std::ostream& out) const;
+
+    // Getters
+    const std::string& path() const { return m_path; }
+    std::size_t bytesWritten() const { return m_bytesWritten; }
+    bool hasWritten(const std::size_t& iteration) const { return m_written && m_lastIteration == iteration; }
+};
@@ -0,0 +1,159 @@
+#include "Diagnostics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+Diagnostics::Diagnostics(const Utilities::Config& config)
+    : m_config {config}
+    , m_path {config.outputDirectory + "/" + config.outputFilename + "_diagnostics.csv"}
+{
+};
+
+bool Diagnostics::isDue(const std::size_t& iteration) const
+{
+    return enabled() && (iteration % m_config.diagnosticsInterval == 0 || iteration + 1 >= m_config.numSteps);
+};
+
+void Diagnostics::resume(const std::size_t& iteration)
+{
+    m_resume = true;
+    m_resume_iteration = iteration;
+};
+
+void Diagnostics::open()
+{
+    // rows of the run before the restart (up to and including the checkpoint's iteration)
+    std::vector<std::string> rows;
+    if (m_resume)
+    {
+        std::ifstream previous(m_path);
+        std::string line;
+        std::getline(previous, line); // column names
+        while (std::getline(previous, line))
+        {
+            if (std::stoull(line.substr(0, line.find(','))) > m_resume_iteration) { break; }
+            rows.push_back(line);
+        }
+    }
+
+    std::filesystem::create_directories(std::filesystem::path(m_path).parent_path());
+    m_file.open(m_path, std::ios::out | std::ios::trunc);
+    if (!m_file.is_open())
+    {
+        throw std::ios_base::failure("Failed to open file for writing: " + m_path);
+    }
+
+    const std::string columns { "iteration,time,kinetic,potential,total,px,py,pz,max speed,clamped,E min,E max,E mean,particles,injected,removed\n" };
+    m_file << columns;
+    m_bytesWritten += columns.size();
+    for (const std::string& row : rows)
+    {
+        m_file << row << '\n';
+        m_bytesWritten += row.size() + 1;
+    }
+};
+
+template <std::size_t N>
+void Diagnostics::record(const std::size_t& iteration, const std::vector<ChargedParticle<N>>& particles, const AlignedVector* fieldMagnitude)
+{
+    if (!m_file.is_open()) { open(); }
+
+    const std::size_t numParticles { particles.size() };
+    double kinetic { 0. };
+    double px { 0. };
+    double py { 0. };
+    double pz { 0. };
+    double maxSpeed { 0. };
+
+    #pragma omp parallel for reduction(+:kinetic, px, py, pz) reduction(max:maxSpeed)
+    for (std::size_t i = 0; i < numParticles; ++i)
+    {
+        const ChargedParticle<N>& particle { particles[i] };
+        const double speed2 { particle.velocity.magnitudeSquared() };
+
+        kinetic += 0.5 * particle.mass * speed2;
+        px += particle.mass * particle.velocity.x();
+        py += particle.mass * particle.velocity.y();
+        pz += particle.mass * particle.velocity.z();
+        maxSpeed = std::max(maxSpeed, std::sqrt(speed2));
+    }
+
+    // every pair once, the rows get shorter towards the end so they are handed out dynamically
+    // (only for the solvers whose forces are this pair sum, see Diagnostics.hpp)
+    double potential { 0. };
+    const bool hasPotential { m_config.forceSolver == Utilities::ForceSolver::direct || m_config.forceSolver == Utilities::ForceSolver::tiled };
+
+    if (hasPotential)
+    {
+        #pragma omp parallel for schedule(dynamic, 16) reduction(+:potential)
+        for (std::size_t i = 0; i < numParticles; ++i)
+        {
+            for (std::size_t j = i+1; j < numParticles; ++j)
+            {
+                const Point<N> r_prime { Utilities::r_prime(particles[i].position, particles[j].position, m_config.periodic, m_config.bound) };
+                potential += particles[i].charge * particles[j].charge / r_prime.magnitude();
+            }
+        }
+    }
+
+    double fieldMin { 0. };
+    double fieldMax { 0. };
+    double fieldMean { 0. };
+    if (fieldMagnitude && !fieldMagnitude->empty())
+    {
+        const AlignedVector& magnitude { *fieldMagnitude };
+        const std::size_t numPoints { magnitude.size() };
+        double minimum { std::numeric_limits<double>::infinity() };
+        double maximum { -std::numeric_limits<double>::infinity() };
+        double sum { 0. };
+
+        #pragma omp parallel for reduction(min:minimum) reduction(max:maximum) reduction(+:sum)
+        for (std::size_t idx = 0; idx < numPoints; ++idx)
+        {
+            minimum = std::min(minimum, magnitude[idx]);
+            maximum = std::max(maximum, magnitude[idx]);
+            sum += magnitude[idx];
+        }
+
+        fieldMin = minimum;
+        fieldMax = maximum;
+        fieldMean = sum / static_cast<double>(numPoints);
+    }
+
+    // one write per row, the rows are small enough to not need the frame writer thread
+    std::ostringstream row;
+    row << std::setprecision(12) << iteration << ',' << static_cast<double>(iteration) * m_config.dt << ',' << kinetic << ',';
+    if (hasPotential) { row << potential << ',' << kinetic + potential; }
+    else { row << ','; }
+    row << ',' << px << ',' << py << ',' << pz << ',' << maxSpeed << ',' << m_clamped << ',' << fieldMin << ',' << fieldMax << ',' << fieldMean
+        << ',' << numParticles << ',' << m_injected << ',' << m_removed << '\n';
+    const std::string text { row.str() };
+    m_file << text;
+    m_bytesWritten += text.size();
+
+    m_clamped = 0;
+    m_injected = 0;
+    m_removed = 0;
+};
+
+void Diagnostics::flush()
+{
+    if (m_file.is_open())
+    {
+        m_file.flush();
+    }
+};
+
+void Diagnostics::close()
+{
+    if (m_file.is_open())
+    {
+        m_file.close();
+    }
+};
+
+template void Diagnostics::record<2>(const std::size_t&, const std::vector<ChargedParticle2D>&, const AlignedVector*);
+template void Diagnostics::record<3>(const std::size_t&, const std::vector<ChargedParticle3D>&, const AlignedVector*);
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../Fields/Fields.hpp"
+#include "../Utilities/Utilities.hpp"
+
+/*
+Diagnostics time series (`<output directory>/<output filename>_diagnostics.csv`), one row every "diagnostics interval" steps
+(and the first and last step) instead of post-processing the frames:
+
+    iteration,time,kinetic,potential,total,px,py,pz,max speed,clamped,E min,E max,E mean,particles,injected,removed
+
+kinetic     sum of m v^2 / 2 (all three velocity components)
+potential   sum over pairs of q_i q_j / r (minimum image if periodic), the energy of the "direct" and "tiled" force solvers only:
+            potential and total are left empty for the other solvers, whose force law differs (ewald and pppm: every periodic image,
+            multigrid: line charges) or which would pay an O(N^2) sum on every row for an approximate one (barnes-hut, particle-mesh)
+px, py, pz  total momentum
+max speed   fastest particle
+clamped     velocity components the v_limit clamp cut down since the previous row
+E min/max/mean  the "magnitude" of the electric field as the frames hold it (sum of q / r^2, so it is signed)
+            over the grid (2D: the whole grid, 3D: the output grid, see StaticPhysics<3>)
+particles   number of particles
+injected, removed   particles the sources added and the walls and collisions took out since the previous row (see Population.hpp)
+*/
+
+// In-situ reductions over the particles and the field of a run, written as one compact csv row per diagnostics step.
+// The potential energy of the direct solvers is an O(N^2) pair sum like their forces.
+class Diagnostics
+{
+private:
+    const Utilities::Config& m_config;
+    std::string m_path;
+    std::ofstream m_file;
+    std::size_t m_clamped { 0 };
+    std::size_t m_injected { 0 };
+    std::size_t m_removed { 0 };
+    std::size_t m_bytesWritten { 0 };
+    bool m_resume { false };
+    std::size_t m_resume_iteration { 0 };
+
+    // creates the file (or keeps the rows up to the restart iteration) and writes the column names
+    void open();
+
+public:
+    explicit Diagnostics(const Utilities::Config& config);
+
+    Diagnostics(const Diagnostics&) = delete;
+    Diagnostics& operator=(const Diagnostics&) = delete;
+
+    bool enabled() const { return m_config.diagnosticsInterval > 0; }
+    bool isDue(const std::size_t& iteration) const;
+
+    // velocity components clamped in a step
+    void countClamped(const std::size_t& clamped) { m_clamped += clamped; }
+    // particles injected and removed in a step
+    void countPopulation(const std::size_t& injected, const std::size_t& removed) { m_injected += injected; m_removed += removed; }
+
+    // a restarted run continues the time series, the rows after `iteration` are dropped
+    void resume(const std::size_t& iteration);
+
+    // reduces the particles and the field magnitude (may be null when there is no field) into the next row
+    template <std::size_t N>
+    void record(const std::size_t& iteration, const std::vector<ChargedParticle<N>>& particles, const AlignedVector* fieldMagnitude);
+
+    // hands the rows written so far to the operating system (before a checkpoint)
+    void flush();
+
+    void close();
+
+    // Getters
+    const std::string& path() const { return m_path; }
+    std::size_t bytesWritten() const { return m_bytesWritten; }
+};
@@ -0,0 +1,209 @@
+#include "DirectSum.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // sources per tile (4 arrays, 16 kB in 3D), reused from L1 for every target of a block
+    constexpr std::size_t s_sourceTile { 512 };
+    // targets per block, the unit of the parallel loop
+    constexpr std::size_t s_targetBlock { 32 };
+
+    struct PairSumArgs
+    {
+        const double* sourceX;
+        const double* sourceY;
+        const double* sourceZ;
+        const double* charge;
+        std::size_t numSources;
+        const std::size_t* targets; // nullptr: every source in order
+        std::size_t numTargets;
+        double bound;
+        bool periodic;
+        std::size_t dim;
+        double* x; // sum of q_j r_ij / r_ij^3 of each target
+        double* y;
+        double* z;
+    };
+
+    // sum of q_j r_ij / r_ij^3 over the sources [begin, end) of a tile, added to `sum` (the vector lanes are reduced in a fixed order)
+    template <std::size_t N, bool Periodic>
+    [[gnu::always_inline]] inline void tileSum(const PairSumArgs& args, const std::size_t& begin, const std::size_t& end, const double (&target)[3], double (&sum)[3])
+    {
+        const double* __restrict sourceX { args.sourceX };
+        const double* __restrict sourceY { args.sourceY };
+        const double* __restrict sourceZ { args.sourceZ };
+        const double* __restrict charge { args.charge };
+        const double period { 2 * args.bound };
+
+        double x { 0. };
+        double y { 0. };
+        double z { 0. };
+
+        #pragma omp simd reduction(+:x,y,z)
+        for (std::size_t j = begin; j < end; ++j)
+        {
+            double dx { target[0] - sourceX[j] };
+            double dy { target[1] - sourceY[j] };
+            double dz { N == 3 ? target[2] - sourceZ[j] : 0. };
+            if constexpr (Periodic)
+            {
+                // minimum image convention, same as Utilities::r_prime (the int conversion vectorizes, std::trunc doesn't everywhere)
+                dx -= static_cast<double>(static_cast<int>(dx / args.bound)) * period;
+                dy -= static_cast<double>(static_cast<int>(dy / args.bound)) * period;
+                if constexpr (N == 3) { dz -= static_cast<double>(static_cast<int>(dz / args.bound)) * period; }
+            }
+
+            const double r2 { dx*dx + dy*dy + dz*dz };
+            const double weight { charge[j] / (r2 * std::sqrt(r2)) };
+            x += dx * weight;
+            y += dy * weight;
+            if constexpr (N == 3) { z += dz * weight; }
+        }
+
+        sum[0] += x;
+        sum[1] += y;
+        sum[2] += z;
+    };
+
+    // the sums of one block of targets: its targets see the tiles in the same order whichever thread runs it,
+    // so the schedule of the blocks only decides who computes a target, never the order of its additions
+    template <std::size_t N, bool Periodic>
+    [[gnu::always_inline]] inline void pairSumBlock(const PairSumArgs& args, const std::size_t& block)
+    {
+        const std::size_t begin { block * s_targetBlock };
+        const std::size_t end { std::min(begin + s_targetBlock, args.numTargets) };
+
+        double sums[s_targetBlock][3] {};
+
+        for (std::size_t tileBegin = 0; tileBegin < args.numSources; tileBegin += s_sourceTile)
+        {
+            const std::size_t tileEnd { std::min(tileBegin + s_sourceTile, args.numSources) };
+
+            for (std::size_t k = begin; k < end; ++k)
+            {
+                const std::size_t i { args.targets ? args.targets[k] : k };
+                const double target[3] { args.sourceX[i], args.sourceY[i], N == 3 ? args.sourceZ[i] : 0. };
+
+                // the target itself splits its tile in two, the loops stay free of branches
+                if (i < tileBegin || i >= tileEnd) { tileSum<N, Periodic>(args, tileBegin, tileEnd, target, sums[k - begin]); }
+                else
+                {
+                    tileSum<N, Periodic>(args, tileBegin, i, target, sums[k - begin]);
+                    tileSum<N, Periodic>(args, i + 1, tileEnd, target, sums[k - begin]);
+                }
+            }
+        }
+
+        double* out[3] { args.x, args.y, args.z };
+        for (std::size_t k = begin; k < end; ++k)
+        {
+            for (std::size_t d = 0; d < N; ++d) { out[d][k] = sums[k - begin][d]; }
+        }
+    };
+
+    [[gnu::always_inline]] inline void pairSumBlock(const PairSumArgs& args, const std::size_t& block)
+    {
+        if (args.dim == 3) { args.periodic ? pairSumBlock<3, true>(args, block) : pairSumBlock<3, false>(args, block); }
+        else { args.periodic ? pairSumBlock<2, true>(args, block) : pairSumBlock<2, false>(args, block); }
+    };
+
+    std::size_t numBlocks(const PairSumArgs& args)
+    {
+        return (args.numTargets + s_targetBlock - 1) / s_targetBlock;
+    };
+
+    // the parallel loop is in each ISA's function (not in the inlined block), so that its outlined body is compiled for that ISA
+    void pairSumScalar(const PairSumArgs& args)
+    {
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (std::size_t block = 0; block < numBlocks(args); ++block) { pairSumBlock(args, block); }
+    };
+
+#if defined(__x86_64__)
+    __attribute__((target("avx2,fma"))) void pairSumAVX2(const PairSumArgs& args)
+    {
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (std::size_t block = 0; block < numBlocks(args); ++block) { pairSumBlock(args, block); }
+    };
+
+    __attribute__((target("avx512f"))) void pairSumAVX512(const PairSumArgs& args)
+    {
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (std::size_t block = 0; block < numBlocks(args); ++block) { pairSumBlock(args, block); }
+    };
+#endif
+};
+
+DirectSum::DirectSum(const double& bound, const bool& periodic)
+    : m_bound {bound}
+    , m_periodic {periodic}
+{
+};
+
+template <std::size_t N>
+void DirectSum::load(const std::vector<ChargedParticle<N>>& particles)
+{
+    const std::size_t numParticles { particles.size() };
+    for (std::size_t d = 0; d < N; ++d) { m_positions[d].resize(numParticles); }
+    m_charges.resize(numParticles);
+
+    #pragma omp parallel for schedule(static)
+    for (std::size_t j = 0; j < numParticles; ++j)
+    {
+        for (std::size_t d = 0; d < N; ++d) { m_positions[d][j] = particles[j].position[d]; }
+        m_charges[j] = particles[j].charge;
+    }
+};
+
+template <std::size_t N>
+void DirectSum::accumulate(const std::vector<ChargedParticle<N>>& particles, const std::size_t* targets, const std::size_t& numTargets, std::vector<Point<N>>& acceleration)
+{
+    load(particles);
+    for (AlignedVector& column : m_sums) { column.resize(numTargets); }
+
+    const PairSumArgs args { m_positions[0].data(), m_positions[1].data(), m_positions[2].data(), m_charges.data(), m_charges.size(),
+                             targets, numTargets, m_bound, m_periodic, N, m_sums[0].data(), m_sums[1].data(), m_sums[2].data() };
+
+    switch (FieldKernels::activeISA())
+    {
+#if defined(__x86_64__)
+        case FieldKernels::ISA::avx512: pairSumAVX512(args); break;
+        case FieldKernels::ISA::avx2: pairSumAVX2(args); break;
+#endif
+        default: pairSumScalar(args); break;
+    }
+
+    // a_i = q_i / m_i * sum_j q_j r_ij / r_ij^3
+    acceleration.resize(numTargets);
+    #pragma omp parallel for schedule(static)
+    for (std::size_t k = 0; k < numTargets; ++k)
+    {
+        const ChargedParticle<N>& particle { particles[targets ? targets[k] : k] };
+        Point<N> sum;
+        for (std::size_t d = 0; d < N; ++d) { sum[d] = m_sums[d][k]; }
+        acceleration[k] = sum * (particle.charge / particle.mass);
+    }
+};
+
+template <std::size_t N>
+std::vector<Point<N>> DirectSum::calculateAcceleration(const std::vector<ChargedParticle<N>>& particles)
+{
+    std::vector<Point<N>> acceleration;
+    accumulate(particles, nullptr, particles.size(), acceleration);
+    return acceleration;
+};
+
+template <std::size_t N>
+std::vector<Point<N>> DirectSum::calculateAcceleration(const std::vector<ChargedParticle<N>>& particles, const std::vector<std::size_t>& active)
+{
+    std::vector<Point<N>> acceleration;
+    accumulate(particles, active.data(), active.size(), acceleration);
+    return acceleration;
+};
+
+template std::vector<Point2D> DirectSum::calculateAcceleration<2>(const std::vector<ChargedParticle2D>&);
+template std::vector<Point3D> DirectSum::calculateAcceleration<3>(const std::vector<ChargedParticle3D>&);
+template std::vector<Point2D> DirectSum::calculateAcceleration<2>(const std::vector<ChargedParticle2D>&, const std::vector<std::size_t>&);
+template std::vector<Point3D> DirectSum::calculateAcceleration<3>(const std::vector<ChargedParticle3D>&, const std::vector<std::size_t>&);
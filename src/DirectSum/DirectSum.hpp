@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "../Points/Points.hpp"
+#include "../Fields/Fields.hpp"
+#include "../Utilities/Utilities.hpp"
+
+// Exact O(N^2) pair sum as a cache-blocked kernel ("force solver": "tiled"), for the sizes where the direct sum is still affordable
+// but the row-per-particle loop is too slow. The particles are copied into structure-of-arrays columns, blocks of targets sweep
+// tiles of sources that stay in L1 and every (target, tile) is one vectorized loop with a fixed lane reduction (same ISA dispatch
+// as FieldKernels). A target is summed by one thread, tile after tile, no matter how the blocks are split, so the accelerations are
+// bit for bit the same for every number of threads (for the same kernel ISA). They differ from the "direct" solver only by the
+// order of the additions.
+class DirectSum
+{
+private:
+    double m_bound;
+    bool m_periodic;
+
+    // the sources (z only in 3D)
+    std::array<AlignedVector, 3> m_positions;
+    AlignedVector m_charges;
+    std::array<AlignedVector, 3> m_sums; // sum of q_j r_ij / r_ij^3 of each target
+
+    template <std::size_t N>
+    void load(const std::vector<ChargedParticle<N>>& particles);
+
+    // accelerations of `targets` (nullptr: every particle), `acceleration[k]` belongs to `targets[k]`
+    template <std::size_t N>
+    void accumulate(const std::vector<ChargedParticle<N>>& particles, const std::size_t* targets, const std::size_t& numTargets, std::vector<Point<N>>& acceleration);
+
+public:
+    DirectSum(const double& bound, const bool& periodic);
+
+    template <std::size_t N>
+    std::vector<Point<N>> calculateAcceleration(const std::vector<ChargedParticle<N>>& particles);
+
+    // accelerations of the `active` particles only (in that order), from every particle
+    template <std::size_t N>
+    std::vector<Point<N>> calculateAcceleration(const std::vector<ChargedParticle<N>>& particles, const std::vector<std::size_t>& active);
+};
@@ -1,53 +1,201 @@
 #include "DynamicPhysics.hpp"
 
-DynamicPhysics::DynamicPhysics(const std::size_t& dim, const double& bound, const std::size_t& numPoints, const std::size_t& numSteps, const double& dt)
-    : m_static_physics {dim, bound, numPoints}
-    , m_numSteps {numSteps}
-    , m_dt {dt}
-    , m_acceleration { calculateAcceleration(Utilities::particles) }
+#include <limits>
+
+template <std::size_t N>
+DynamicPhysics<N>::DynamicPhysics(const Utilities::Config& config, SharedGrid<N> shared)
+    : m_config {config}
+    , m_profiler {config}
+    , m_static_physics {config, std::move(shared)}
+    , m_numSteps {config.numSteps}
+    , m_dt {config.dt}
+    , m_barnes_hut {config.bound, config.periodic, config.theta}
+    , m_ewald {config.bound, config.ewaldTolerance, config.ewaldCutoff, config.forceSolver == Utilities::ForceSolver::pppm, config.assignment, config.pppmMesh}
+    , m_direct_sum {config.bound, config.periodic}
+    , m_acceleration { calculateAcceleration(config.inputParticles<N>()) }
+    , m_checkpoint {config}
+    , m_diagnostics {config}
+    , m_population {config, config.inputParticles<N>().size()}
+    , m_spatial_sort {config.bound, config.numPoints, config.sortCurve}
 {
-    Utilities::initMessage();
+    if (!m_config.verbose) { return; }
+
+    Utilities::initMessage(m_config);
+
+    if (m_config.forceSolver == Utilities::ForceSolver::ewald || m_config.forceSolver == Utilities::ForceSolver::pppm)
+    {
+        m_ewald.report(std::cout);
+    }
 }
 
-void DynamicPhysics::run(std::vector<ChargedParticle2D>& particles, std::vector<InfiniteWire2D>& wires)
+template <std::size_t N>
+void DynamicPhysics<N>::run(std::vector<ChargedParticle<N>>& particles, std::vector<InfiniteWire2D>& wires)
 {
-    std::cout << "Run starting!" << std::endl;
-    std::cout << "Current iteration: " << m_iteration << '\n';
+    if (m_config.verbose) { std::cout << "Run starting!" << std::endl; }
     
-    m_static_physics.calculateInfiniteWireMagneticField(wires);
+    if constexpr (N == 2)
+    {
+        m_static_physics.calculateInfiniteWireMagneticField(wires);
+
+        // the Boris pusher evaluates the wires at the particles, staged as structure-of-arrays once
+        m_wireX.clear();
+        m_wireY.clear();
+        m_wireCurrent.clear();
+        m_wireDirectionX.clear();
+        m_wireDirectionY.clear();
+        m_wireDirectionZ.clear();
+        for (const InfiniteWire2D& wire : wires)
+        {
+            m_wireX.push_back(wire.position.x());
+            m_wireY.push_back(wire.position.y());
+            m_wireCurrent.push_back(wire.current);
+            m_wireDirectionX.push_back(wire.direction.x());
+            m_wireDirectionY.push_back(wire.direction.y());
+            m_wireDirectionZ.push_back(wire.direction.z());
+        }
+    }
+    else if (!wires.empty())
+    {
+        std::cerr << "Infinite wires are only implemented for 2D domains! Ignoring the wires..." << std::endl;
+    }
     
-    if (!particles.empty())
+    m_profiler.endSetup();
+
+    // a run can start empty when its sources fill it
+    if (!particles.empty() || !m_config.sources.empty())
     {
-        m_static_physics.calculateElectricField(particles, true);
-        m_static_physics.writeFields(Utilities::outputFilename + "_" +  std::to_string(m_iteration));
+        if (restore(particles))
+        {
+            // the frame and diagnostics row of the checkpoint's iteration are already written
+            m_static_physics.resumeOutput(m_iteration);
+            m_diagnostics.resume(m_iteration);
+        }
+        else
+        {
+            // the particles are numbered in input order before anything reorders them
+            for (std::size_t i = 0; i < particles.size(); ++i) { particles[i].id = i; }
+            if (m_config.sortInterval > 0) { sortParticles(particles); }
 
+            if (m_config.outputInterval > 0 || m_diagnostics.enabled())
+            {
+                const Profiler::Scope scope { m_profiler, Profiler::Phase::field };
+                // the sources fill the run later (the multigrid field of the conductors is there without particles)
+                if (particles.empty() && m_config.forceSolver != Utilities::ForceSolver::multigrid) { m_static_physics.clearElectricField(); }
+                else { m_static_physics.calculateElectricField(particles); }
+                m_profiler.count(Profiler::Counter::gridPoints, m_static_physics.E_field().magnitude.size());
+            }
+            if (m_config.outputInterval > 0)
+            {
+                const Profiler::Scope scope { m_profiler, Profiler::Phase::write };
+                m_static_physics.writeFrame(m_iteration, particles);
+            }
+            if (m_diagnostics.enabled())
+            {
+                const Profiler::Scope scope { m_profiler, Profiler::Phase::diagnostics };
+                m_diagnostics.record(m_iteration, particles, &m_static_physics.E_field().magnitude);
+            }
+        }
+
+        m_profiler.startSteps();
         while (m_iteration < m_numSteps-1)
         {
             evolve(particles);
-            std::cout << "Current iteration: " << m_iteration << '\n';
+            if (m_checkpoint.isDue(m_iteration))
+            {
+                const Profiler::Scope scope { m_profiler, Profiler::Phase::checkpoint };
+                writeCheckpoint(particles);
+            }
+            m_profiler.endStep();
+
+            // the console costs as much as a small step, so progress is only printed every "progress seconds"
+            if (m_config.verbose && m_profiler.progressDue(m_iteration))
+            {
+                m_profiler.progress(std::cout, m_iteration);
+                if (m_config.timestepLevels > 0)
+                {
+                    const double saved { 100. * (1. - static_cast<double>(m_forceEvaluations) / static_cast<double>(std::max<std::size_t>(m_sharedForceEvaluations, 1))) };
+                    std::cout << " (force evaluations: " << m_forceEvaluations << " of " << m_sharedForceEvaluations << ", " << std::fixed << std::setprecision(1) << saved << "% saved)" << std::defaultfloat;
+                }
+                std::cout << std::endl;
+            }
+        }
+
+        // the final state is kept as well, so the run can be continued with more steps
+        if (m_checkpoint.enabled() && !m_checkpoint.hasWritten(m_iteration))
+        {
+            const Profiler::Scope scope { m_profiler, Profiler::Phase::checkpoint };
+            writeCheckpoint(particles);
+        }
+        m_checkpoint.finish();
+        m_static_physics.closeOutput();
+        m_diagnostics.close();
+        if (m_config.verbose && m_checkpoint.enabled()) { m_checkpoint.report(std::cout); }
+        if constexpr (N == 2)
+        {
+            if (m_config.verbose) { m_static_physics.multigrid().report(std::cout); }
+        }
+
+        if (m_config.profile)
+        {
+            m_profiler.write(particles.size(), {{"frames", m_static_physics.bytesWritten()}, {"checkpoints", m_checkpoint.bytesWritten()}, {"diagnostics", m_diagnostics.bytesWritten()}});
+            if (m_config.verbose)
+            {
+                std::cout << "profile: " << m_profiler.path() << " (force " << std::fixed << std::setprecision(3) << m_profiler.total(Profiler::Phase::force) << " s, push "
+                          << m_profiler.total(Profiler::Phase::push) << " s, field " << m_profiler.total(Profiler::Phase::field) << " s, write "
+                          << m_profiler.total(Profiler::Phase::write) << " s)" << std::defaultfloat << std::endl;
+            }
         }
     }
 
-    std::cout << "Run complete!" << std::endl;
+    if (m_config.verbose) { std::cout << "Run complete!" << std::endl; }
 };
 
-std::vector<Point2D> DynamicPhysics::calculateAcceleration(std::vector<ChargedParticle2D>& particles)
+template <std::size_t N>
+std::vector<Point<N>> DynamicPhysics<N>::calculateAcceleration(const std::vector<ChargedParticle<N>>& particles)
 {
-    const std::size_t& numParticles { particles.size() };
-    std::vector<Point2D> acceleration(numParticles, Point2D{ 0.0, 0.0 });
+    if (m_config.forceSolver == Utilities::ForceSolver::tiled)
+    {
+        return m_direct_sum.calculateAcceleration(particles);
+    }
 
-    for (std::size_t i = 0; i < numParticles; ++i)
+    if constexpr (N == 2)
     {
-        for (std::size_t j = i+1; j < numParticles; ++j)
+        if (m_config.forceSolver == Utilities::ForceSolver::barnesHut)
         {
-            Point2D r_prime { Utilities::r_prime(particles[i].position, particles[j].position) };
+            // the tree is rebuilt from scratch every step since every particle moves
+            m_barnes_hut.build(particles);
+            return m_barnes_hut.calculateAcceleration(particles);
+        }
 
-            double r { r_prime.magnitude() };
-            acceleration[i] += Point2D { r_prime * particles[i].charge * particles[j].charge / (particles[i].mass * r*r*r) };
-            acceleration[j] -= Point2D { r_prime * particles[i].charge * particles[j].charge / (particles[j].mass * r*r*r) };
+        if (m_config.forceSolver == Utilities::ForceSolver::particleMesh)
+        {
+            // the grid electric field of this solve is filled in only when a frame is written
+            return m_static_physics.calculateMeshAcceleration(particles);
+        }
+
+        if (m_config.forceSolver == Utilities::ForceSolver::multigrid)
+        {
+            // warm started from the potential of the last solve, the grid electric field is filled in for the frames like particle-mesh
+            return m_static_physics.calculateMultigridAcceleration(particles);
+        }
+
+        if (m_config.forceSolver == Utilities::ForceSolver::ewald || m_config.forceSolver == Utilities::ForceSolver::pppm)
+        {
+            return m_ewald.calculateAcceleration(particles);
         }
     }
 
+    // direct summation (reference path)
+    // every particle sums its own row so the loop runs in parallel
+    const std::size_t& numParticles { particles.size() };
+    std::vector<Point<N>> acceleration(numParticles);
+
+    #pragma omp parallel for schedule(static)
+    for (std::size_t i = 0; i < numParticles; ++i)
+    {
+        acceleration[i] = directAcceleration(i, particles);
+    }
+
     return acceleration;
         
         // for (ChargedParticle2D& particle : particles)
@@ -62,83 +210,163 @@ std::vector<Point2D> DynamicPhysics::calculateAcceleration(std::vector<ChargedPa
         //         acceleration += Point2D { r_prime * particle.charge * other_particle.charge / (particle.mass * r*r*r) };
         //     }
         // }
-
-    // temporary fix until annihilation is implemented
-    // double max_acceleration { 10 };
-    // if (abs(acceleration.x()) > max_acceleration)
-    // { 
-    //     // std::cout << "ax:\t" << acceleration.x() << '\n' << "ay:\t" << acceleration.y() << std::endl;        
-    //     acceleration.setX(Utilities::sign<double>(acceleration.x()) * max_acceleration); 
-    //     acceleration.setX(0.);
-    // }
-    // else if (abs(acceleration.y()) > max_acceleration)
-    // {
-    //     // acceleration.setY(Utilities::sign<double>(acceleration.y()) * max_acceleration);
-    //     acceleration.setY(0.);
-    // }
 };
 
-void DynamicPhysics::evolve(std::vector<ChargedParticle2D>& particles)
+template <std::size_t N>
+std::vector<Point<N>> DynamicPhysics<N>::calculateAcceleration(const std::vector<ChargedParticle<N>>& particles, const std::vector<std::size_t>& active)
 {
-    
-    #pragma omp parallel for
-    for (std::size_t i = 0; i < particles.size(); ++i)
+    if (m_config.forceSolver == Utilities::ForceSolver::tiled)
     {
-        // std::size_t idx = Utilities::findNearestGridPointIndex(particle.position);
-        // const Field2D& E_field = m_static_physics.E_field()[idx];
-        // double a { particle.charge * E_field.magnitude / particle.mass };
-        // Point2D acceleration { a * E_field.direction.x(), a * E_field.direction.y() };
+        return m_direct_sum.calculateAcceleration(particles, active);
+    }
 
-        ChargedParticle2D& particle { particles[i] };
-        const Point2D& acceleration { m_acceleration[i] };
+    std::vector<Point<N>> acceleration(active.size());
 
-        // update the position according to Verlet integration
-        double next_x { particle.position.x() + particle.velocity.x()*m_dt + 0.5 * acceleration.x()*m_dt*m_dt };
-        double next_y { particle.position.y() + particle.velocity.y()*m_dt + 0.5 * acceleration.y()*m_dt*m_dt };
+    if constexpr (N == 2)
+    {
+        if (m_config.forceSolver == Utilities::ForceSolver::barnesHut)
+        {
+            // the tree needs every particle, only the walks are limited to the active ones
+            m_barnes_hut.build(particles);
+            return m_barnes_hut.calculateAcceleration(particles, active);
+        }
 
-        if (abs(next_x) >= Utilities::bound)
+        if (m_config.forceSolver != Utilities::ForceSolver::direct)
         {
-            if (Utilities::periodic)
-            {
-                particle.position.setX( next_x - Utilities::sign<double>(next_x) * 2 * Utilities::bound );
-            }
-            else
-            {
-                particle.position.setX( Utilities::sign<double>(next_x) * Utilities::bound );
-            }
+            // the mesh and Ewald solvers are global, the active particles are picked out of the full solve
+            const std::vector<Point<N>> all { calculateAcceleration(particles) };
+            for (std::size_t k = 0; k < active.size(); ++k) { acceleration[k] = all[active[k]]; }
+            return acceleration;
         }
-        else
+    }
+
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (std::size_t k = 0; k < active.size(); ++k)
+    {
+        acceleration[k] = directAcceleration(active[k], particles);
+    }
+
+    return acceleration;
+};
+
+template <std::size_t N>
+std::vector<Point<N>> DynamicPhysics<N>::stepAcceleration(const std::vector<ChargedParticle<N>>& particles, const std::vector<std::size_t>* targets)
+{
+    std::vector<Point<N>> acceleration;
+    {
+        const Profiler::Scope scope { m_profiler, Profiler::Phase::force };
+        acceleration = targets ? calculateAcceleration(particles, *targets) : calculateAcceleration(particles);
+    }
+
+    // direct and tiled: each target with every other particle, the other solvers count what they evaluated
+    const std::size_t numParticles { particles.size() };
+    std::size_t evaluations { targets ? targets->size() : numParticles };
+    std::size_t pairs { evaluations * (numParticles > 0 ? numParticles - 1 : 0) };
+    if constexpr (N == 2)
+    {
+        switch (m_config.forceSolver)
         {
-            particle.position.setX( next_x );
+            case Utilities::ForceSolver::direct:
+            case Utilities::ForceSolver::tiled: break;
+            case Utilities::ForceSolver::barnesHut: pairs = m_barnes_hut.interactions(); break;
+            case Utilities::ForceSolver::particleMesh:
+            case Utilities::ForceSolver::multigrid: evaluations = numParticles; pairs = 0; break;
+            case Utilities::ForceSolver::ewald:
+            case Utilities::ForceSolver::pppm: evaluations = numParticles; pairs = m_ewald.pairInteractions(); break;
         }
+    }
+    m_profiler.count(Profiler::Counter::forceEvaluations, evaluations);
+    m_profiler.count(Profiler::Counter::pairInteractions, pairs);
+
+    return acceleration;
+};
+
+template <std::size_t N>
+Point<N> DynamicPhysics<N>::directAcceleration(const std::size_t& i, const std::vector<ChargedParticle<N>>& particles) const
+{
+    // the pairs j < i come first and use r_prime(j, i) so that the sum is bit for bit the one of the serial symmetric (i < j) loop
+    const std::size_t& numParticles { particles.size() };
+    Point<N> acceleration;
+
+    for (std::size_t j = 0; j < i; ++j)
+    {
+        Point<N> r_prime { Utilities::r_prime(particles[j].position, particles[i].position, m_config.periodic, m_config.bound) };
 
-        if (abs(next_y) >= Utilities::bound)
+        double r { r_prime.magnitude() };
+        acceleration -= Point<N> { r_prime * particles[j].charge * particles[i].charge / (particles[i].mass * r*r*r) };
+    }
+    for (std::size_t j = i+1; j < numParticles; ++j)
+    {
+        Point<N> r_prime { Utilities::r_prime(particles[i].position, particles[j].position, m_config.periodic, m_config.bound) };
+
+        double r { r_prime.magnitude() };
+        acceleration += Point<N> { r_prime * particles[i].charge * particles[j].charge / (particles[i].mass * r*r*r) };
+    }
+
+    return acceleration;
+};
+
+template <std::size_t N>
+double DynamicPhysics<N>::velocityLimit() const
+{
+    if (!m_config.velocityClamp) { return std::numeric_limits<double>::infinity(); }
+    return m_static_physics.geometry().bound() / (8 * m_dt); // max velocity is 1/8-th the domain grid per time step
+};
+
+template <std::size_t N>
+std::size_t DynamicPhysics<N>::verletStep(std::vector<ChargedParticle<N>>& particles)
+{
+    // drift
+    {
+        const Profiler::Scope scope { m_profiler, Profiler::Phase::push };
+
+        #pragma omp parallel for
+        for (std::size_t i = 0; i < particles.size(); ++i)
         {
-            if (Utilities::periodic)
-            {
-                particle.position.setY( next_y - Utilities::sign<double>(next_y) * 2 * Utilities::bound );
-            }
-            else
+            // std::size_t idx = Utilities::findNearestGridPointIndex(particle.position);
+            // const Field2D E_field = m_static_physics.E_field()[idx];
+            // double a { particle.charge * E_field.magnitude / particle.mass };
+            // Point2D acceleration { a * E_field.direction.x(), a * E_field.direction.y() };
+
+            ChargedParticle<N>& particle { particles[i] };
+            const Point<N>& acceleration { m_acceleration[i] };
+
+            for (std::size_t d = 0; d < N; ++d)
             {
-                particle.position.setY( Utilities::sign<double>(next_y) * Utilities::bound );
+                // update the position according to Verlet integration
+                double next { particle.position[d] + particle.velocity[d]*m_dt + 0.5 * acceleration[d]*m_dt*m_dt };
+
+                if (std::abs(next) >= m_config.bound)
+                {
+                    if (m_config.periodic)
+                    {
+                        particle.position[d] = next - Utilities::sign<double>(next) * 2 * m_config.bound;
+                    }
+                    else
+                    {
+                        particle.position[d] = Utilities::sign<double>(next) * m_config.bound;
+                    }
+                }
+                else
+                {
+                    particle.position[d] = next;
+                }
             }
         }
-        else
-        {
-            particle.position.setY( next_y );
-        }
     }
-    
-    std::vector<Point2D> new_accelerations { calculateAcceleration(particles) };
-    
-    #pragma omp parallel for
+
+    std::vector<Point<N>> new_accelerations { stepAcceleration(particles) };
+    std::size_t clamped { 0 };
+    const Profiler::Scope scope { m_profiler, Profiler::Phase::push };
+
+    #pragma omp parallel for reduction(+:clamped)
     for (std::size_t i = 0; i < particles.size(); ++i)
     {
-        ChargedParticle2D& particle { particles[i] };
-        const Point2D& acceleration { m_acceleration[i] };
-        const Point2D& new_acceleration { new_accelerations[i] };
+        ChargedParticle<N>& particle { particles[i] };
+        const Point<N>& acceleration { m_acceleration[i] };
+        const Point<N>& new_acceleration { new_accelerations[i] };
 
-        const double v_limit { m_static_physics.geometry().bound() / (8 * m_dt) }; // max velocity is 1/8-th the domain grid per time step
+        const double v_limit { velocityLimit() };
 
         /*
         From the position-setting loop, now any particles
@@ -147,38 +375,390 @@ void DynamicPhysics::evolve(std::vector<ChargedParticle2D>& particles)
         */
 
         // update the velocity according to Verlet velocity integration
-        if (abs(particle.position.x()) == Utilities::bound)
+        for (std::size_t d = 0; d < N; ++d)
         {
-            particle.velocity.setX( -particle.velocity.x() );
+            if (std::abs(particle.position[d]) == m_config.bound)
+            {
+                particle.velocity[d] = -particle.velocity[d];
+            }
+            else
+            {
+                const double& new_v { particle.velocity[d] + 0.5 * (acceleration[d] + new_acceleration[d])*m_dt };
+                if (std::abs(new_v) < v_limit)
+                {
+                    particle.velocity[d] = new_v;
+                }
+                else
+                {
+                    particle.velocity[d] = Utilities::sign<double>(new_v) * v_limit;
+                    ++clamped;
+                }
+            }
         }
-        else
+
+        m_acceleration[i] = new_accelerations[i];
+
+        // Not in use, but here for nostalgia...
+        // use RK4 to update the position and velocity
+        // RK4(particle, acceleration);
+    }
+
+    return clamped;
+};
+
+template <std::size_t N>
+std::size_t DynamicPhysics<N>::borisStep(std::vector<ChargedParticle<N>>& particles)
+{
+    const std::size_t numParticles { particles.size() };
+    const double v_limit { velocityLimit() }; // same limit as the Verlet step
+    std::size_t clamped { 0 };
+
+    {
+        const Profiler::Scope scope { m_profiler, Profiler::Phase::push };
+        magneticFieldAtParticles(particles);
+
+        #pragma omp parallel for reduction(+:clamped)
+        for (std::size_t i = 0; i < numParticles; ++i)
         {
-            const double& new_v { particle.velocity.x() + 0.5 * (acceleration.x() + new_acceleration.x())*m_dt };
-            particle.velocity.setX( (abs(new_v) < v_limit) ? new_v : Utilities::sign<double>(new_v) * v_limit );
+            ChargedParticle<N>& particle { particles[i] };
+            const Point<N>& acceleration { m_acceleration[i] }; // q E / m at the current positions
+
+            // half of the electric kick
+            Point3D velocity { particle.velocity };
+            for (std::size_t d = 0; d < N; ++d) { velocity[d] += 0.5 * acceleration[d] * m_dt; }
+
+            // rotation about the magnetic field by the angle q B dt / m (exact magnitude, no energy drift from the magnetic part)
+            const double halfGyration { 0.5 * particle.charge / particle.mass * m_dt };
+            const Point3D t { halfGyration * m_B_x[i], halfGyration * m_B_y[i], halfGyration * m_B_z[i] };
+            const Point3D s { 2. / (1. + t.magnitudeSquared()) * t };
+            const Point3D rotated { velocity + velocity.cross(t) };
+            velocity += rotated.cross(s);
+
+            // other half of the electric kick
+            for (std::size_t d = 0; d < N; ++d) { velocity[d] += 0.5 * acceleration[d] * m_dt; }
+
+            for (std::size_t d = 0; d < 3; ++d)
+            {
+                if (std::abs(velocity[d]) >= v_limit)
+                {
+                    velocity[d] = Utilities::sign<double>(velocity[d]) * v_limit;
+                    ++clamped;
+                }
+            }
+
+            // drift with the new (half step) velocity, the walls reflect like in the Verlet step
+            for (std::size_t d = 0; d < N; ++d)
+            {
+                const double next { particle.position[d] + velocity[d] * m_dt };
+
+                if (std::abs(next) >= m_config.bound)
+                {
+                    if (m_config.periodic)
+                    {
+                        particle.position[d] = next - Utilities::sign<double>(next) * 2 * m_config.bound;
+                    }
+                    else
+                    {
+                        particle.position[d] = Utilities::sign<double>(next) * m_config.bound;
+                        velocity[d] = -velocity[d];
+                    }
+                }
+                else
+                {
+                    particle.position[d] = next;
+                }
+            }
+
+            particle.velocity = velocity;
         }
+    }
+
+    // the electric kicks of the next step use the field at the new positions
+    m_acceleration = stepAcceleration(particles);
 
-        if (abs(particle.position.y()) == Utilities::bound)
+    return clamped;
+};
+
+template <std::size_t N>
+std::size_t DynamicPhysics<N>::blockStep(std::vector<ChargedParticle<N>>& particles)
+{
+    const std::size_t numParticles { particles.size() };
+    const std::size_t maxLevel { m_config.timestepLevels };
+    const std::size_t ticksPerStep { std::size_t { 1 } << maxLevel };
+    const double tick { m_dt / static_cast<double>(ticksPerStep) }; // smallest step, every step is a power of two of these
+    const double v_limit { velocityLimit() };
+
+    // a new run starts everyone on the smallest step, the criterion lets them climb to larger ones
+    if (m_levels.size() != numParticles) { m_levels.assign(numParticles, static_cast<std::uint8_t>(maxLevel)); }
+
+    // every particle is synchronized at the start of a global step: (position, velocity, acceleration) at tick 0
+    m_syncPositions.resize(numParticles);
+    for (std::size_t i = 0; i < numParticles; ++i) { m_syncPositions[i] = particles[i].position; }
+    m_ticks.assign(numParticles, 0);
+
+    std::size_t clamped { 0 };
+    std::size_t evaluations { 0 };
+    std::size_t blockTimes { 0 };
+    std::vector<std::size_t> active;
+
+    std::size_t now { 0 };
+    while (now < ticksPerStep)
+    {
+        std::size_t next { ticksPerStep };
         {
-            particle.velocity.setY( -particle.velocity.y() );
+            const Profiler::Scope scope { m_profiler, Profiler::Phase::push };
+
+            // the next block time is the earliest end of a particle's step, the particles whose step ends there are active
+            for (std::size_t i = 0; i < numParticles; ++i) { next = std::min(next, m_ticks[i] + (ticksPerStep >> m_levels[i])); }
+
+            active.clear();
+            for (std::size_t i = 0; i < numParticles; ++i)
+            {
+                if (m_ticks[i] + (ticksPerStep >> m_levels[i]) == next) { active.push_back(i); }
+            }
+
+            // everyone is predicted to the block time (the Verlet position update, only kept for the active particles)
+            #pragma omp parallel for
+            for (std::size_t i = 0; i < numParticles; ++i)
+            {
+                ChargedParticle<N>& particle { particles[i] };
+                const Point<N>& acceleration { m_acceleration[i] };
+                const double tau { static_cast<double>(next - m_ticks[i]) * tick };
+
+                for (std::size_t d = 0; d < N; ++d)
+                {
+                    double predicted { m_syncPositions[i][d] + particle.velocity[d]*tau + 0.5 * acceleration[d]*tau*tau };
+
+                    if (std::abs(predicted) >= m_config.bound)
+                    {
+                        predicted = m_config.periodic ? predicted - Utilities::sign<double>(predicted) * 2 * m_config.bound : Utilities::sign<double>(predicted) * m_config.bound;
+                    }
+                    particle.position[d] = predicted;
+                }
+            }
         }
-        else
+
+        const std::vector<Point<N>> new_accelerations { stepAcceleration(particles, &active) };
+        const Profiler::Scope scope { m_profiler, Profiler::Phase::push };
+
+        #pragma omp parallel for reduction(+:clamped)
+        for (std::size_t k = 0; k < active.size(); ++k)
         {
-            const double& new_v { particle.velocity.y() + 0.5 * (acceleration.y() + new_acceleration.y())*m_dt };
-            particle.velocity.setY( (abs(new_v) < v_limit) ? new_v : Utilities::sign<double>(new_v) * v_limit );
+            const std::size_t i { active[k] };
+            ChargedParticle<N>& particle { particles[i] };
+            const Point<N>& acceleration { m_acceleration[i] };
+            const Point<N>& new_acceleration { new_accelerations[k] };
+            const std::size_t ticks { ticksPerStep >> m_levels[i] };
+            const double h { static_cast<double>(ticks) * tick };
+
+            // velocity Verlet over the particle's own step (same update as verletStep)
+            for (std::size_t d = 0; d < N; ++d)
+            {
+                if (std::abs(particle.position[d]) == m_config.bound)
+                {
+                    particle.velocity[d] = -particle.velocity[d];
+                }
+                else
+                {
+                    const double& new_v { particle.velocity[d] + 0.5 * (acceleration[d] + new_acceleration[d])*h };
+                    if (std::abs(new_v) < v_limit)
+                    {
+                        particle.velocity[d] = new_v;
+                    }
+                    else
+                    {
+                        particle.velocity[d] = Utilities::sign<double>(new_v) * v_limit;
+                        ++clamped;
+                    }
+                }
+            }
+
+            // step criterion: eta |a| / |da/dt|, the jerk taken from the change of the acceleration over the step
+            const double jerk { (new_acceleration - acceleration).magnitude() / h };
+            const double desired { jerk > 0. ? m_config.timestepAccuracy * new_acceleration.magnitude() / jerk : m_dt };
+            std::size_t level { 0 };
+            while (level < maxLevel && m_dt / static_cast<double>(std::size_t { 1 } << level) > desired) { ++level; }
+
+            // smaller steps right away, a larger step only one level at a time and where that step starts on its own block
+            if (level < m_levels[i])
+            {
+                level = (next % (2 * ticks) == 0) ? m_levels[i] - 1u : m_levels[i];
+            }
+
+            m_levels[i] = static_cast<std::uint8_t>(level);
+            m_acceleration[i] = new_acceleration;
+            m_syncPositions[i] = particle.position;
+            m_ticks[i] = next;
         }
 
-        m_acceleration[i] = new_accelerations[i];
+        evaluations += active.size();
+        ++blockTimes;
+        now = next;
+    }
 
-        // Not in use, but here for nostalgia...
-        // use RK4 to update the position and velocity
-        // RK4(particle, acceleration);
+    // a shared step as small as the smallest one taken would have evaluated every particle at every block time
+    m_forceEvaluations = evaluations;
+    m_sharedForceEvaluations = blockTimes * numParticles;
+
+    return clamped;
+};
+
+template <std::size_t N>
+void DynamicPhysics<N>::magneticFieldAtParticles(const std::vector<ChargedParticle<N>>& particles)
+{
+    const std::size_t numParticles { particles.size() };
+    m_B_x.assign(numParticles, 0.);
+    m_B_y.assign(numParticles, 0.);
+    m_B_z.assign(numParticles, 0.);
+
+    if constexpr (N == 2)
+    {
+        if (m_wireX.empty()) { return; }
+
+        m_particleX.resize(numParticles);
+        m_particleY.resize(numParticles);
+        for (std::size_t i = 0; i < numParticles; ++i)
+        {
+            m_particleX[i] = particles[i].position.x();
+            m_particleY[i] = particles[i].position.y();
+        }
+
+        FieldKernels::infiniteWireFieldAtPoints(m_particleX.data(), m_particleY.data(), numParticles,
+                                                m_wireX.data(), m_wireY.data(), m_wireCurrent.data(),
+                                                m_wireDirectionX.data(), m_wireDirectionY.data(), m_wireDirectionZ.data(), m_wireX.size(),
+                                                m_B_x.data(), m_B_y.data(), m_B_z.data());
     }
+};
+
+template <std::size_t N>
+void DynamicPhysics<N>::evolve(std::vector<ChargedParticle<N>>& particles)
+{
+    std::size_t clamped { 0 };
+    if (m_config.timestepLevels > 0) { clamped = blockStep(particles); }
+    else if (m_config.integrator == Utilities::Integrator::boris) { clamped = borisStep(particles); }
+    else { clamped = verletStep(particles); }
 
     ++m_iteration;
-    m_static_physics.calculateElectricField(particles, false);
-    m_static_physics.writeFields(Utilities::outputFilename + "_" +  std::to_string(m_iteration));
+    if (m_population.enabled()) { updatePopulation(particles); }
+    if (m_config.sortInterval > 0 && m_iteration % m_config.sortInterval == 0) { sortParticles(particles); }
+    m_diagnostics.countClamped(clamped);
+    m_profiler.count(Profiler::Counter::particleSteps, particles.size());
+
+    const bool output { isOutputStep() };
+    const bool diagnostics { m_diagnostics.isDue(m_iteration) };
+    if (!output && !diagnostics) { return; }
+
+    // the O(grid points * particles) field evaluation is only done for the frames and rows that are written
+    {
+        const Profiler::Scope scope { m_profiler, Profiler::Phase::field };
+        updateElectricField(particles);
+        m_profiler.count(Profiler::Counter::gridPoints, m_static_physics.E_field().magnitude.size());
+    }
+    if (output)
+    {
+        const Profiler::Scope scope { m_profiler, Profiler::Phase::write };
+        m_static_physics.writeFrame(m_iteration, particles);
+    }
+    if (diagnostics)
+    {
+        const Profiler::Scope scope { m_profiler, Profiler::Phase::diagnostics };
+        m_diagnostics.record(m_iteration, particles, &m_static_physics.E_field().magnitude);
+    }
 }
 
+template <std::size_t N>
+void DynamicPhysics<N>::updatePopulation(std::vector<ChargedParticle<N>>& particles)
+{
+    bool changed { false };
+    {
+        const Profiler::Scope scope { m_profiler, Profiler::Phase::population };
+        changed = m_population.update(m_iteration, particles, m_acceleration, m_levels);
+    }
+    m_diagnostics.countPopulation(m_population.injected(), m_population.removed());
+    m_profiler.count(Profiler::Counter::injectedParticles, m_population.injected());
+    m_profiler.count(Profiler::Counter::removedParticles, m_population.removed());
+
+    // every particle is synchronized at the end of a step (block time-stepping too), so all of them take the new accelerations
+    if (changed) { m_acceleration = stepAcceleration(particles); }
+};
+
+template <std::size_t N>
+void DynamicPhysics<N>::sortParticles(std::vector<ChargedParticle<N>>& particles)
+{
+    const Profiler::Scope scope { m_profiler, Profiler::Phase::sort };
+    m_spatial_sort.sort(particles, m_acceleration, m_levels);
+};
+
+template <std::size_t N>
+void DynamicPhysics<N>::updateElectricField(std::vector<ChargedParticle<N>>& particles)
+{
+    if (particles.empty() && m_config.forceSolver != Utilities::ForceSolver::multigrid)
+    {
+        // every particle was removed, the frames still hold a field
+        m_static_physics.clearElectricField();
+        return;
+    }
+
+    if constexpr (N == 2)
+    {
+        if (m_config.forceSolver == Utilities::ForceSolver::particleMesh || m_config.forceSolver == Utilities::ForceSolver::multigrid)
+        {
+            // the particle-mesh or multigrid solve in calculateAcceleration was done for these positions
+            m_static_physics.updateMeshElectricField();
+            return;
+        }
+    }
+
+    m_static_physics.calculateElectricField(particles);
+};
+
+template <std::size_t N>
+bool DynamicPhysics<N>::restore(std::vector<ChargedParticle<N>>& particles)
+{
+    if (m_config.restartFile.empty()) { return false; }
+
+    if (!std::filesystem::exists(m_config.restartFile))
+    {
+        std::cerr << "No checkpoint at " << m_config.restartFile << "! Starting from the initial particles..." << std::endl;
+        return false;
+    }
+
+    std::vector<double> potential;
+    std::size_t ewaldParticles { 0 };
+    m_iteration = m_checkpoint.read(m_config.restartFile, particles, m_acceleration, m_levels, potential, ewaldParticles);
+    // the multigrid solver continues from the potential it had, so the restarted run takes the same V-cycles,
+    // and the ewald solvers keep the parameters they had chosen
+    if constexpr (N == 2)
+    {
+        if (!potential.empty()) { m_static_physics.multigrid().setPotential(potential); }
+    }
+    if (ewaldParticles > 0) { m_ewald.tuneFor(ewaldParticles); }
+    if (m_config.verbose)
+    {
+        std::cout << "Restarted from " << m_config.restartFile << " at iteration " << m_iteration << " (" << particles.size() << " particles)" << std::endl;
+    }
+    return true;
+};
+
+template <std::size_t N>
+void DynamicPhysics<N>::writeCheckpoint(const std::vector<ChargedParticle<N>>& particles)
+{
+    m_static_physics.flushOutput();
+    m_diagnostics.flush();
+    if constexpr (N == 2) { m_checkpoint.write(m_iteration, particles, m_acceleration, m_levels, m_static_physics.multigrid().potential(), m_ewald.tunedParticles()); }
+    else { m_checkpoint.write(m_iteration, particles, m_acceleration, m_levels, {}, 0); }
+};
+
+template <std::size_t N>
+bool DynamicPhysics<N>::isOutputStep() const
+{
+    if (m_config.outputInterval == 0) { return false; }
+    return m_iteration % m_config.outputInterval == 0 || m_iteration + 1 >= m_numSteps;
+};
+
+template class DynamicPhysics<2>;
+template class DynamicPhysics<3>;
+
 // void DynamicPhysics::RK4(ChargedParticle2D& particle, std::vector<ChargedParticle2D>& particles)
 // {
 //     const Point2D k1 { particle.velocity.x(), particle.velocity.y() };
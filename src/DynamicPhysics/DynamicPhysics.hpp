@@ -1,25 +1,103 @@
 #pragma once
 
 #include "../StaticPhysics/StaticPhysics.hpp"
+#include "../BarnesHut/BarnesHut.hpp"
+#include "../Ewald/Ewald.hpp"
+#include "../DirectSum/DirectSum.hpp"
+#include "../Checkpoint/Checkpoint.hpp"
+#include "../Diagnostics/Diagnostics.hpp"
+#include "../Profiler/Profiler.hpp"
+#include "../Population/Population.hpp"
+#include "../SpatialSort/SpatialSort.hpp"
 
+// the dimension picks the static physics (and grid) the particles live in, the integrator is the same for 2D and 3D
+// (Barnes-Hut, particle-mesh and the Ewald solvers are 2D only, a 3D run always uses the direct or the tiled direct sum)
+template <std::size_t N>
 class DynamicPhysics
 {
 private:
-    StaticPhysics m_static_physics;
+    const Utilities::Config& m_config;
+    Profiler m_profiler; // first, so that the setup time includes building everything else
+    StaticPhysics<N> m_static_physics;
     
     std::size_t m_iteration { 0 };
-    const std::size_t& m_numSteps;
-    const double& m_dt;
-    std::vector<Point2D> m_acceleration;
+    const std::size_t m_numSteps;
+    const double m_dt;
+    BarnesHut m_barnes_hut; // only used with the "barnes-hut" force solver (must be constructed before m_acceleration)
+    Ewald m_ewald; // only used with the "ewald" and "pppm" force solvers (must be constructed before m_acceleration)
+    DirectSum m_direct_sum; // only used with the "tiled" force solver (must be constructed before m_acceleration)
+    std::vector<Point<N>> m_acceleration;
+    Checkpoint m_checkpoint;
+    Diagnostics m_diagnostics;
+    Population m_population; // particles injected and removed during the run
+    SpatialSort m_spatial_sort; // reorders the particles along the "sort curve" every "sort interval" steps
+
+    // Boris pusher: the wires and the particle positions as structure-of-arrays, and the magnetic field at each particle
+    std::vector<double> m_wireX;
+    std::vector<double> m_wireY;
+    std::vector<double> m_wireCurrent;
+    std::vector<double> m_wireDirectionX;
+    std::vector<double> m_wireDirectionY;
+    std::vector<double> m_wireDirectionZ;
+    std::vector<double> m_particleX;
+    std::vector<double> m_particleY;
+    std::vector<double> m_B_x;
+    std::vector<double> m_B_y;
+    std::vector<double> m_B_z;
+
+    // block time-stepping: each particle steps with dt / 2^level, level 0 to "timestep levels"
+    std::vector<std::uint8_t> m_levels;
+    std::vector<std::size_t> m_ticks; // where each particle is within the global step (in units of the smallest step)
+    std::vector<Point<N>> m_syncPositions; // position at m_ticks (the particles hold the positions predicted to the current block time)
+    std::size_t m_forceEvaluations { 0 }; // in the last global step
+    std::size_t m_sharedForceEvaluations { 0 }; // what a shared step as small as the smallest one would have needed
+
+    // bound / (8 dt), or no limit with "velocity clamp": false
+    double velocityLimit() const;
+    // one step of each integrator, all return how many velocity components the v_limit clamp cut
+    std::size_t verletStep(std::vector<ChargedParticle<N>>& particles);
+    // leapfrog: the half step velocities get the electric kicks around the magnetic rotation, then the positions drift with them
+    std::size_t borisStep(std::vector<ChargedParticle<N>>& particles);
+    // one global step dt made of power-of-two block steps: at each block time every particle is predicted there
+    // and only the particles whose own step ends there get a new force and a velocity Verlet update
+    std::size_t blockStep(std::vector<ChargedParticle<N>>& particles);
+    // analytic magnetic field of the wires at every particle (zero in 3D, where there are no wires)
+    void magneticFieldAtParticles(const std::vector<ChargedParticle<N>>& particles);
+
+    // absorbing walls, collisions and sources after a step (the accelerations are solved again when anything changed)
+    void updatePopulation(std::vector<ChargedParticle<N>>& particles);
+
+    // reorders the particles (and their accelerations and levels) along the space-filling curve
+    void sortParticles(std::vector<ChargedParticle<N>>& particles);
+
+    // every "output interval"-th step and the last one are written (none if the interval is 0)
+    bool isOutputStep() const;
+    // grid electric field of the current positions (only evaluated for the frames and diagnostics rows)
+    void updateElectricField(std::vector<ChargedParticle<N>>& particles);
+
+    // the step's force solve for `targets` of the particles (the profile's force phase and interaction counts)
+    std::vector<Point<N>> stepAcceleration(const std::vector<ChargedParticle<N>>& particles, const std::vector<std::size_t>* targets = nullptr);
+
+    // direct sum of the accelerations on particle i
+    Point<N> directAcceleration(const std::size_t& i, const std::vector<ChargedParticle<N>>& particles) const;
+
+    // loads the particles, accelerations and iteration of the "restart" checkpoint (false if there is none to load)
+    bool restore(std::vector<ChargedParticle<N>>& particles);
+    // the frames up to now are flushed first so that the run file matches the checkpoint
+    void writeCheckpoint(const std::vector<ChargedParticle<N>>& particles);
 
 public:
-    DynamicPhysics(const std::size_t& dim, const double& bound, const std::size_t& numPoints, const std::size_t& numSteps, const double& dt);
+    // everything is read from `config` (which has to outlive the run), the grid and the wire field are built unless `shared` holds them
+    DynamicPhysics(const Utilities::Config& config, SharedGrid<N> shared = {});
 
-    void run(std::vector<ChargedParticle2D>& particles, std::vector<InfiniteWire2D>& wires);
+    // the wires are only used in 2D
+    void run(std::vector<ChargedParticle<N>>& particles, std::vector<InfiniteWire2D>& wires);
 
-    void evolve(std::vector<ChargedParticle2D>& particles);
+    void evolve(std::vector<ChargedParticle<N>>& particles);
 
-    std::vector<Point2D> calculateAcceleration(std::vector<ChargedParticle2D>& particles);
+    std::vector<Point<N>> calculateAcceleration(const std::vector<ChargedParticle<N>>& particles);
+    // accelerations of the `active` particles only (in that order), from every particle
+    std::vector<Point<N>> calculateAcceleration(const std::vector<ChargedParticle<N>>& particles, const std::vector<std::size_t>& active);
 
     // void RK4(ChargedParticle2D& particle, std::vector<ChargedParticle2D>& particles);
 };
@@ -0,0 +1,192 @@
+#include "Ensemble.hpp"
+
+namespace
+{
+    // key of the wires of a 2D run (bit exact, runs only share a field of the very same wires)
+    std::string wiresKey(const Utilities::Config& config)
+    {
+        std::ostringstream key;
+        key << std::setprecision(17) << config.bound << ' ' << config.numPoints;
+        for (const InfiniteWire2D& wire : config.wires)
+        {
+            key << ' ' << wire.current << ' ' << wire.position.x() << ' ' << wire.position.y()
+                << ' ' << wire.direction.x() << ' ' << wire.direction.y() << ' ' << wire.direction.z();
+        }
+        return key.str();
+    };
+
+    template <std::size_t N>
+    void runDynamics(Utilities::Config& config, const SharedGrid<N>& shared)
+    {
+        DynamicPhysics<N> dynamic_physics(config, shared);
+        dynamic_physics.run(config.inputParticles<N>(), config.wires);
+    };
+};
+
+Ensemble::Ensemble(const nlohmann::json& _j)
+{
+    const nlohmann::json& spec { _j["ensemble"] };
+
+    nlohmann::json base = spec.contains("config") ? Utilities::loadJsonFile(spec["config"]) : _j;
+    base.erase("ensemble");
+    m_outputDirectory = base.value("output directory", "outputs");
+    m_outputFilename = base.value("output filename", "output");
+
+    // every combination of the swept values
+    const nlohmann::json sweep = spec.value("sweep", nlohmann::json::object());
+    std::vector<nlohmann::json> combinations { nlohmann::json::object() };
+    for (const auto& [key, values] : sweep.items())
+    {
+        std::vector<nlohmann::json> extended;
+        for (const nlohmann::json& combination : combinations)
+        {
+            for (const nlohmann::json& value : (values.is_array() ? values : nlohmann::json::array({values})))
+            {
+                nlohmann::json next = combination;
+                next[key] = value;
+                extended.push_back(next);
+            }
+        }
+        combinations = std::move(extended);
+    }
+
+    nlohmann::json explicitRuns = spec.value("runs", nlohmann::json::array());
+    if (explicitRuns.empty()) { explicitRuns.push_back(nlohmann::json::object()); }
+
+    for (const nlohmann::json& explicitRun : explicitRuns)
+    {
+        for (const nlohmann::json& combination : combinations)
+        {
+            const std::size_t index { m_runs.size() };
+            nlohmann::json overrides = explicitRun;
+            overrides.merge_patch(combination);
+
+            nlohmann::json config = base;
+            config.merge_patch(overrides);
+            if (!overrides.contains("output filename"))
+            {
+                config["output filename"] = m_outputFilename + "_" + std::to_string(index);
+            }
+
+            m_runs.push_back(Run { index, overrides, Utilities::parseConfig(config), {}, {}, 0., {} });
+            m_runs.back().config.verbose = false;
+        }
+    }
+
+    const std::size_t hardwareThreads { static_cast<std::size_t>(std::max(omp_get_max_threads(), 1)) };
+    const std::size_t threads { static_cast<std::size_t>(spec.value("threads", 0)) };
+    const std::size_t threadsPerRun { static_cast<std::size_t>(spec.value("threads per run", 0)) };
+    m_threads = threads > 0 ? threads : std::max<std::size_t>(hardwareThreads / std::max<std::size_t>(threadsPerRun, 1), 1);
+    m_threads = std::min(m_threads, std::max<std::size_t>(m_runs.size(), 1));
+    m_threadsPerRun = threadsPerRun > 0 ? threadsPerRun : std::max<std::size_t>(hardwareThreads / m_threads, 1);
+};
+
+void Ensemble::share()
+{
+    for (Run& run : m_runs)
+    {
+        const Utilities::Config& config { run.config };
+        const std::pair<double, std::size_t> grid { config.bound, config.numPoints };
+
+        if (config.dim == 3)
+        {
+            std::shared_ptr<const Geometry<3>>& geometry { m_geometries3D[grid] };
+            if (!geometry) { geometry = std::make_shared<const Geometry<3>>(config.bound, config.numPoints); }
+            run.shared3D.geometry = geometry;
+            continue;
+        }
+
+        std::shared_ptr<const Geometry<2>>& geometry { m_geometries2D[grid] };
+        if (!geometry) { geometry = std::make_shared<const Geometry<2>>(config.bound, config.numPoints); }
+        run.shared2D.geometry = geometry;
+
+        std::shared_ptr<const FieldStore2D>& B_field { m_B_fields[wiresKey(config)] };
+        if (!B_field)
+        {
+            auto field { std::make_shared<FieldStore2D>() };
+            StaticPhysics<2>::calculateInfiniteWireMagneticField(*geometry, config.wires, *field);
+            B_field = field;
+        }
+        run.shared2D.B_field = B_field;
+    }
+};
+
+void Ensemble::execute(Run& run)
+{
+    const auto start { std::chrono::steady_clock::now() };
+    try
+    {
+        if (run.config.dim == 3) { runDynamics<3>(run.config, run.shared3D); }
+        else { runDynamics<2>(run.config, run.shared2D); }
+    }
+    catch (const std::exception& error)
+    {
+        run.error = error.what();
+    }
+    const std::chrono::duration<double> elapsed { std::chrono::steady_clock::now() - start };
+    run.seconds = elapsed.count();
+
+    std::lock_guard<std::mutex> lock { m_logMutex };
+    ++m_finished;
+    std::cout << "run " << run.index << " (" << m_finished << "/" << m_runs.size() << ") " << run.overrides.dump();
+    if (run.error.empty()) { std::cout << " done in " << run.seconds << " s" << std::endl; }
+    else { std::cout << " failed: " << run.error << std::endl; }
+};
+
+void Ensemble::run()
+{
+    if (m_runs.empty()) { return; }
+
+    std::cout << "Ensemble starting!" << std::endl;
+    const auto start { std::chrono::steady_clock::now() };
+
+    share();
+    std::cout << m_runs.size() << " runs, " << m_threads << " at a time with " << m_threadsPerRun << " OpenMP threads each, "
+              << m_geometries2D.size() + m_geometries3D.size() << " shared grids, " << m_B_fields.size() << " shared wire fields" << std::endl;
+
+    std::size_t steals { 0 };
+    {
+        ThreadPool pool { m_threads, [this](std::size_t) { omp_set_num_threads(static_cast<int>(m_threadsPerRun)); } };
+        for (Run& run : m_runs)
+        {
+            pool.submit([this, &run] { execute(run); });
+        }
+        pool.wait();
+        steals = pool.steals();
+    }
+
+    const std::chrono::duration<double> elapsed { std::chrono::steady_clock::now() - start };
+    writeSummary(elapsed.count(), steals);
+
+    std::cout << "Ensemble complete! (" << elapsed.count() << " s)" << std::endl;
+};
+
+void Ensemble::writeSummary(const double& seconds, const std::size_t& steals) const
+{
+    const std::string path { m_outputDirectory + "/" + m_outputFilename + "_ensemble.json" };
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        throw std::ios_base::failure("Failed to open file for writing: " + path);
+    }
+
+    nlohmann::json _j;
+    _j["threads"] = m_threads;
+    _j["threads per run"] = m_threadsPerRun;
+    _j["seconds"] = seconds;
+    _j["steals"] = steals;
+    _j["runs"] = nlohmann::json::array();
+    for (const Run& run : m_runs)
+    {
+        _j["runs"].push_back({
+            {"index", run.index},
+            {"overrides", run.overrides},
+            {"output filename", run.config.outputFilename},
+            {"seconds", run.seconds},
+            {"status", run.error.empty() ? "done" : "failed"},
+            {"error", run.error},
+        });
+    }
+
+    file << _j.dump(4) << '\n';
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../DynamicPhysics/DynamicPhysics.hpp"
+#include "../ThreadPool/ThreadPool.hpp"
+
+/*
+Ensemble: many variants of one configuration run in one process, given by an "ensemble" block in the config:
+
+"ensemble": {
+    "config": "inputs/dynamics_test.json",                  base configuration (default: this file without the "ensemble" block)
+    "sweep": {"dt": [0.01, 0.005], "charge scale": [0.5, 2.0]}, every combination of the values of these config keys
+    "runs": [{"periodic": true}, {"particles": [...]}],       explicit overrides, each combined with every sweep combination
+    "threads": 4,                                             runs at the same time (default: the OpenMP threads / "threads per run")
+    "threads per run": 1                                      OpenMP threads inside each run (default: the OpenMP threads / "threads")
+}
+
+Run k is the base config with its overrides merged in (json merge patch, so an array like "particles" is replaced as a whole),
+its "output filename" gets a "_<k>" suffix unless the overrides set one. Runs with the same dim, bound and numPoints share
+one (read-only) Geometry, 2D runs that also have the same wires share the magnetic field of the wires. The runs are scheduled on
+a work-stealing ThreadPool, and every run is summarized in <output directory>/<output filename>_ensemble.json.
+*/
+class Ensemble
+{
+private:
+    struct Run
+    {
+        std::size_t index;
+        nlohmann::json overrides;
+        Utilities::Config config; // the physics of the run keep a reference to it
+        SharedGrid<2> shared2D;
+        SharedGrid<3> shared3D;
+        double seconds { 0. }; // wall time
+        std::string error; // what the run threw (empty if it finished)
+    };
+
+    std::string m_outputDirectory;
+    std::string m_outputFilename;
+    std::size_t m_threads;
+    std::size_t m_threadsPerRun;
+    std::vector<Run> m_runs;
+
+    // grid (and wires) of each shared part
+    std::map<std::pair<double, std::size_t>, std::shared_ptr<const Geometry<2>>> m_geometries2D;
+    std::map<std::pair<double, std::size_t>, std::shared_ptr<const Geometry<3>>> m_geometries3D;
+    std::map<std::string, std::shared_ptr<const FieldStore2D>> m_B_fields;
+
+    std::mutex m_logMutex;
+    std::size_t m_finished { 0 };
+
+    // builds the geometries and wire fields once (before any run starts) and hands them to the runs
+    void share();
+    void execute(Run& run);
+    void writeSummary(const double& seconds, const std::size_t& steals) const;
+
+public:
+    explicit Ensemble(const nlohmann::json& _j);
+
+    void run();
+
+    // Getters
+    std::size_t size() const { return m_runs.size(); }
+};
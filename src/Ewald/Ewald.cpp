@@ -0,0 +1,461 @@
+#include "Ewald.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../Constants/Constants.hpp"
+#include "../ParticleMesh/ParticleMesh.hpp"
+
+namespace
+{
+    // neighbours within the real space cutoff that a setup aims for with PPPM (the mesh does the rest)
+    constexpr double s_pppmNeighbours { 50. };
+    // particles whose PPPM reciprocal force is checked against the direct k sum
+    constexpr std::size_t s_errorSamples { 64 };
+    // largest automatic PPPM mesh (per dimension), low order assignments at tight tolerances would ask for more
+    constexpr std::size_t s_maxMesh { 2048 };
+    // the parameters are chosen again once the number of particles is this factor above or below the tuned one
+    // (a source or absorbing walls change it every step, a setup rebuilds the influence function and measures its error)
+    constexpr std::size_t s_retuneFactor { 2 };
+
+    double sinc(double x)
+    {
+        return std::abs(x) < 1e-12 ? 1. : std::sin(x) / x;
+    };
+};
+
+Ewald::Ewald(const double& bound, const double& tolerance, const double& cutoff, const bool& pppm, const Utilities::Assignment& assignment, const std::size_t& meshSize)
+    : m_bound {bound}
+    , m_length {2 * bound}
+    , m_area {4 * bound * bound}
+    , m_tolerance {std::clamp(tolerance, 1e-16, 0.1)}
+    , m_requestedCutoff {cutoff}
+    , m_pppm {pppm}
+    , m_assignment {assignment}
+    , m_requestedMesh {meshSize}
+{};
+
+void Ewald::setup(const std::vector<ChargedParticle2D>& particles, const std::size_t& numParticles)
+{
+    m_numParticles = numParticles;
+    const double n { static_cast<double>(std::max<std::size_t>(m_numParticles, 1)) };
+    const double s { std::sqrt(-std::log(m_tolerance)) }; // erfc(s) ~ tolerance
+
+    if (m_requestedCutoff > 0)
+    {
+        m_cutoff = m_requestedCutoff;
+    }
+    else if (m_pppm)
+    {
+        m_cutoff = std::sqrt(s_pppmNeighbours * m_area / (Constants::pi * n));
+    }
+    else
+    {
+        // balances the real space (N^2 pi rc^2/A) and reciprocal space (N A kMax^2/4pi) work
+        const double alpha { std::sqrt(Constants::pi) * std::pow(n, 0.25) / std::sqrt(m_area) };
+        m_cutoff = s / alpha;
+    }
+    // the minimum image must be the only image within the cutoff
+    m_cutoff = std::min(m_cutoff, m_bound);
+
+    m_alpha = s / m_cutoff;
+    m_kMax = 2 * m_alpha * s;
+
+    m_numCells = static_cast<std::size_t>(std::floor(m_length / m_cutoff));
+    if (m_numCells < 3) { m_numCells = 1; } // every cell would be its own neighbour, just loop over all pairs
+
+    if (m_pppm)
+    {
+        // The mesh error goes as (h alpha)^p for an order p assignment, h alpha = tolerance^(1/2p) puts it a bit below the
+        // real space error for TSC (measured, see report()), and the mesh has to resolve kMax in any case
+        const double order { m_assignment == Utilities::Assignment::NGP ? 1. : (m_assignment == Utilities::Assignment::CIC ? 2. : 3.) };
+        const double spacing { std::pow(m_tolerance, 1. / (2 * order)) / m_alpha };
+        const double wanted { std::max(m_length / spacing, m_kMax * m_length / Constants::pi) };
+        m_meshSize = m_requestedMesh > 0 ? m_requestedMesh : FFT::nextFastSize(std::clamp<std::size_t>(static_cast<std::size_t>(std::ceil(wanted)), 8, s_maxMesh));
+        m_waves.clear();
+        initializeInfluence();
+    }
+    else
+    {
+        initializeWaves();
+    }
+
+    estimateErrors(particles);
+};
+
+void Ewald::initializeWaves()
+{
+    const double dk { 2 * Constants::pi / m_length };
+    const long nMax { static_cast<long>(std::floor(m_kMax / dk)) };
+
+    // half of k space, -k is accounted for by the factor 2 in the prefactor
+    m_waves.clear();
+    for (long mx = 0; mx <= nMax; ++mx)
+    {
+        for (long my = -nMax; my <= nMax; ++my)
+        {
+            if (mx == 0 && my <= 0) { continue; }
+
+            const double kx { dk * static_cast<double>(mx) };
+            const double ky { dk * static_cast<double>(my) };
+            const double k { std::sqrt(kx*kx + ky*ky) };
+            if (k > m_kMax) { continue; }
+
+            m_waves.push_back(Wave {kx, ky, 2 * 2 * Constants::pi / m_area * std::erfc(k / (2 * m_alpha)) / k});
+        }
+    }
+
+    m_structureReal.assign(m_waves.size(), 0.);
+    m_structureImag.assign(m_waves.size(), 0.);
+};
+
+void Ewald::initializeInfluence()
+{
+    const std::size_t M { m_meshSize };
+    const double h { m_length / static_cast<double>(M) };
+    const double dk { 2 * Constants::pi / m_length };
+    const double order { m_assignment == Utilities::Assignment::NGP ? 1. : (m_assignment == Utilities::Assignment::CIC ? 2. : 3.) };
+
+    m_influence.assign(M * M, 0.);
+    for (std::size_t i = 0; i < M; ++i)
+    {
+        for (std::size_t j = 0; j < M; ++j)
+        {
+            if (i == 0 && j == 0) { continue; }
+
+            const double kx { dk * (i <= M/2 ? static_cast<double>(i) : static_cast<double>(i) - static_cast<double>(M)) };
+            const double ky { dk * (j <= M/2 ? static_cast<double>(j) : static_cast<double>(j) - static_cast<double>(M)) };
+            const double k { std::sqrt(kx*kx + ky*ky) };
+
+            // the assignment function is deconvolved twice (deposit and interpolation)
+            const double W { std::pow(sinc(0.5 * kx * h) * sinc(0.5 * ky * h), order) };
+
+            // M^2 undoes the normalization of the inverse FFT
+            m_influence[i*M + j] = static_cast<double>(M * M) / m_area * 2 * Constants::pi * std::erfc(k / (2 * m_alpha)) / k / (W * W);
+        }
+    }
+
+    m_rho.assign(M * M, FFT::Complex{0., 0.});
+    m_Ex.assign(M * M, FFT::Complex{0., 0.});
+    m_Ey.assign(M * M, FFT::Complex{0., 0.});
+};
+
+void Ewald::estimateErrors(const std::vector<ChargedParticle2D>& particles)
+{
+    double sumQ2 { 0. };
+    for (const ChargedParticle2D& particle : particles) { sumQ2 += particle.charge * particle.charge; }
+    const double n { static_cast<double>(std::max<std::size_t>(particles.size(), 1)) };
+
+    // RMS force error from the pairs beyond the cutoff and from the waves beyond kMax (random positions, see the header)
+    m_realError = std::sqrt(2.) * sumQ2 / (m_cutoff * std::sqrt(n * m_area)) * std::exp(-m_alpha*m_alpha * m_cutoff*m_cutoff);
+    m_reciprocalError = sumQ2 / std::sqrt(n) * std::sqrt(8. / m_area) * m_alpha*m_alpha * std::exp(-m_kMax*m_kMax / (4 * m_alpha*m_alpha)) / m_kMax;
+
+    // the mesh error dominates for PPPM, it is measured on the first solve instead
+    m_reciprocalErrorMeasured = false;
+};
+
+void Ewald::buildCells(const std::vector<ChargedParticle2D>& particles)
+{
+    const std::size_t nc { m_numCells };
+    const double scale { static_cast<double>(nc) / m_length };
+
+    auto cellOf = [&](const ChargedParticle2D& particle)
+    {
+        const auto index = [&](double coordinate)
+        {
+            const long c { static_cast<long>(std::floor((coordinate + m_bound) * scale)) };
+            return static_cast<std::size_t>(std::clamp(c, 0L, static_cast<long>(nc) - 1));
+        };
+        return index(particle.position.x()) * nc + index(particle.position.y());
+    };
+
+    // counting sort of the particles by cell
+    m_cellStart.assign(nc * nc + 1, 0);
+    for (const ChargedParticle2D& particle : particles) { ++m_cellStart[cellOf(particle) + 1]; }
+    for (std::size_t c = 0; c < nc * nc; ++c) { m_cellStart[c + 1] += m_cellStart[c]; }
+
+    m_cellParticles.resize(particles.size());
+    std::vector<std::size_t> fill(m_cellStart.begin(), m_cellStart.end() - 1);
+    for (std::size_t i = 0; i < particles.size(); ++i) { m_cellParticles[fill[cellOf(particles[i])]++] = i; }
+};
+
+std::size_t Ewald::addRealSpace(const std::vector<ChargedParticle2D>& particles, std::vector<Point2D>& field) const
+{
+    const std::size_t nc { m_numCells };
+    const double scale { static_cast<double>(nc) / m_length };
+    const double cutoff2 { m_cutoff * m_cutoff };
+    const double alpha2 { m_alpha * m_alpha };
+    const double gaussian { 2 * m_alpha / std::sqrt(Constants::pi) };
+
+    std::size_t pairs { 0 };
+
+    #pragma omp parallel for schedule(dynamic, 64) reduction(+:pairs)
+    for (std::size_t i = 0; i < particles.size(); ++i)
+    {
+        const double xi { particles[i].position.x() };
+        const double yi { particles[i].position.y() };
+        double ex { 0. };
+        double ey { 0. };
+
+        const auto addPair = [&](std::size_t j)
+        {
+            if (j == i) { return; }
+
+            // minimum image, same as Utilities::r_prime
+            double dx { xi - particles[j].position.x() };
+            double dy { yi - particles[j].position.y() };
+            dx -= std::trunc(dx / m_bound) * m_length;
+            dy -= std::trunc(dy / m_bound) * m_length;
+
+            const double r2 { dx*dx + dy*dy };
+            if (r2 >= cutoff2) { return; }
+            ++pairs;
+
+            const double r { std::sqrt(r2) };
+            const double magnitude { particles[j].charge * (std::erfc(m_alpha * r) / r + gaussian * std::exp(-alpha2 * r2)) / r2 };
+            ex += magnitude * dx;
+            ey += magnitude * dy;
+        };
+
+        if (nc == 1)
+        {
+            for (std::size_t j = 0; j < particles.size(); ++j) { addPair(j); }
+        }
+        else
+        {
+            const long cx { std::clamp(static_cast<long>(std::floor((xi + m_bound) * scale)), 0L, static_cast<long>(nc) - 1) };
+            const long cy { std::clamp(static_cast<long>(std::floor((yi + m_bound) * scale)), 0L, static_cast<long>(nc) - 1) };
+            const long n { static_cast<long>(nc) };
+
+            for (long ox = -1; ox <= 1; ++ox)
+            {
+                for (long oy = -1; oy <= 1; ++oy)
+                {
+                    const std::size_t cell { static_cast<std::size_t>(((cx + ox + n) % n) * n + (cy + oy + n) % n) };
+                    for (std::size_t k = m_cellStart[cell]; k < m_cellStart[cell + 1]; ++k) { addPair(m_cellParticles[k]); }
+                }
+            }
+        }
+
+        field[i] += Point2D { ex, ey };
+    }
+
+    return pairs;
+};
+
+void Ewald::addReciprocalEwald(const std::vector<ChargedParticle2D>& particles, std::vector<Point2D>& field, const std::vector<std::size_t>& targets)
+{
+    // structure factors S(k) = sum_j q_j exp(i k.r_j)
+    #pragma omp parallel for schedule(static)
+    for (std::size_t w = 0; w < m_waves.size(); ++w)
+    {
+        double real { 0. };
+        double imag { 0. };
+        for (const ChargedParticle2D& particle : particles)
+        {
+            const double phase { m_waves[w].kx * particle.position.x() + m_waves[w].ky * particle.position.y() };
+            real += particle.charge * std::cos(phase);
+            imag += particle.charge * std::sin(phase);
+        }
+        m_structureReal[w] = real;
+        m_structureImag[w] = imag;
+    }
+
+    // empty `targets` means every particle
+    const std::size_t numTargets { targets.empty() ? particles.size() : targets.size() };
+
+    #pragma omp parallel for schedule(static)
+    for (std::size_t t = 0; t < numTargets; ++t)
+    {
+        const std::size_t i { targets.empty() ? t : targets[t] };
+        double ex { 0. };
+        double ey { 0. };
+        for (std::size_t w = 0; w < m_waves.size(); ++w)
+        {
+            const double phase { m_waves[w].kx * particles[i].position.x() + m_waves[w].ky * particles[i].position.y() };
+            // Im(exp(i k.r_i) conj(S))
+            const double weight { m_waves[w].prefactor * (std::sin(phase) * m_structureReal[w] - std::cos(phase) * m_structureImag[w]) };
+            ex += weight * m_waves[w].kx;
+            ey += weight * m_waves[w].ky;
+        }
+        field[i] += Point2D { ex, ey };
+    }
+};
+
+std::size_t Ewald::meshWeights(double coordinate, std::size_t (&nodes)[3], double (&weights)[3]) const
+{
+    const long M { static_cast<long>(m_meshSize) };
+    long first { 0 };
+    const std::size_t count { assignmentStencil(m_assignment, (coordinate + m_bound) * static_cast<double>(M) / m_length, first, weights) };
+
+    for (std::size_t k = 0; k < count; ++k)
+    {
+        const long idx { first + static_cast<long>(k) };
+        nodes[k] = static_cast<std::size_t>(((idx % M) + M) % M);
+    }
+
+    return count;
+};
+
+void Ewald::addReciprocalPPPM(const std::vector<ChargedParticle2D>& particles, std::vector<Point2D>& field)
+{
+    const std::size_t M { m_meshSize };
+    const double dk { 2 * Constants::pi / m_length };
+
+    // 1. charge assignment (private mesh per thread summed in thread order like ParticleMesh::deposit)
+    std::vector<std::vector<double>> meshes(static_cast<std::size_t>(omp_get_max_threads()));
+    #pragma omp parallel
+    {
+        const std::size_t threads { static_cast<std::size_t>(omp_get_num_threads()) };
+        std::vector<double>& rho { meshes[static_cast<std::size_t>(omp_get_thread_num())] };
+        rho.assign(M * M, 0.);
+
+        #pragma omp for schedule(static)
+        for (std::size_t p = 0; p < particles.size(); ++p)
+        {
+            std::size_t nodesX[3], nodesY[3];
+            double weightsX[3], weightsY[3];
+            const std::size_t count { meshWeights(particles[p].position.x(), nodesX, weightsX) };
+            meshWeights(particles[p].position.y(), nodesY, weightsY);
+
+            for (std::size_t a = 0; a < count; ++a)
+            {
+                for (std::size_t b = 0; b < count; ++b) { rho[nodesX[a] * M + nodesY[b]] += particles[p].charge * weightsX[a] * weightsY[b]; }
+            }
+        }
+
+        #pragma omp for schedule(static)
+        for (std::size_t i = 0; i < M; ++i)
+        {
+            for (std::size_t j = 0; j < M; ++j)
+            {
+                double sum { 0. };
+                for (std::size_t t = 0; t < threads; ++t) { sum += meshes[t][i*M + j]; }
+                m_rho[i*M + j] = FFT::Complex{ sum, 0. };
+            }
+        }
+    }
+
+    // 2. potential in k space and E = -i k phi (the Nyquist modes have no well-defined derivative)
+    FFT::transform2D(m_rho, M, M, false);
+
+    #pragma omp parallel for
+    for (std::size_t i = 0; i < M; ++i)
+    {
+        const double kx { (2 * i == M) ? 0. : dk * (i <= M/2 ? static_cast<double>(i) : static_cast<double>(i) - static_cast<double>(M)) };
+        for (std::size_t j = 0; j < M; ++j)
+        {
+            const double ky { (2 * j == M) ? 0. : dk * (j <= M/2 ? static_cast<double>(j) : static_cast<double>(j) - static_cast<double>(M)) };
+            const FFT::Complex phi { m_influence[i*M + j] * m_rho[i*M + j] };
+            m_Ex[i*M + j] = FFT::Complex{0., -kx} * phi;
+            m_Ey[i*M + j] = FFT::Complex{0., -ky} * phi;
+        }
+    }
+
+    FFT::transform2D(m_Ex, M, M, true);
+    FFT::transform2D(m_Ey, M, M, true);
+
+    // 3. back to the particles with the same weights
+    #pragma omp parallel for
+    for (std::size_t p = 0; p < particles.size(); ++p)
+    {
+        std::size_t nodesX[3], nodesY[3];
+        double weightsX[3], weightsY[3];
+        const std::size_t count { meshWeights(particles[p].position.x(), nodesX, weightsX) };
+        meshWeights(particles[p].position.y(), nodesY, weightsY);
+
+        double ex { 0. };
+        double ey { 0. };
+        for (std::size_t a = 0; a < count; ++a)
+        {
+            for (std::size_t b = 0; b < count; ++b)
+            {
+                const double weight { weightsX[a] * weightsY[b] };
+                ex += weight * m_Ex[nodesX[a] * M + nodesY[b]].real();
+                ey += weight * m_Ey[nodesX[a] * M + nodesY[b]].real();
+            }
+        }
+        field[p] += Point2D { ex, ey };
+    }
+};
+
+std::vector<Point2D> Ewald::calculateAcceleration(const std::vector<ChargedParticle2D>& particles)
+{
+    if (particles.empty()) { return {}; }
+    const std::size_t numParticles { particles.size() };
+    if (m_restoredParticles > 0)
+    {
+        setup(particles, m_restoredParticles);
+        m_restoredParticles = 0;
+    }
+    else if (m_numParticles == 0 || numParticles > s_retuneFactor * m_numParticles || s_retuneFactor * numParticles < m_numParticles)
+    {
+        setup(particles, numParticles);
+    }
+
+    // electric field at each particle (force per unit charge)
+    std::vector<Point2D> field(particles.size(), Point2D{ 0.0, 0.0 });
+
+    buildCells(particles);
+    m_pairInteractions = addRealSpace(particles, field);
+
+    if (m_pppm)
+    {
+        std::vector<Point2D> reciprocal(particles.size(), Point2D{ 0.0, 0.0 });
+        addReciprocalPPPM(particles, reciprocal);
+
+        if (!m_reciprocalErrorMeasured)
+        {
+            // RMS difference to the direct k sum on a few evenly spread particles (only done once per setup)
+            std::vector<std::size_t> samples;
+            const std::size_t stride { std::max<std::size_t>(particles.size() / s_errorSamples, 1) };
+            for (std::size_t i = 0; i < particles.size(); i += stride) { samples.push_back(i); }
+
+            initializeWaves();
+            std::vector<Point2D> reference(particles.size(), Point2D{ 0.0, 0.0 });
+            addReciprocalEwald(particles, reference, samples);
+
+            double sumSquares { 0. };
+            for (const std::size_t& i : samples)
+            {
+                const Point2D difference { particles[i].charge * (reciprocal[i] - reference[i]) };
+                sumSquares += difference.x()*difference.x() + difference.y()*difference.y();
+            }
+            m_reciprocalError = std::sqrt(sumSquares / static_cast<double>(samples.size()));
+            m_reciprocalErrorMeasured = true;
+
+            m_waves.clear();
+            m_waves.shrink_to_fit();
+        }
+
+        for (std::size_t i = 0; i < particles.size(); ++i) { field[i] += reciprocal[i]; }
+    }
+    else
+    {
+        addReciprocalEwald(particles, field, {});
+    }
+
+    std::vector<Point2D> acceleration(particles.size(), Point2D{ 0.0, 0.0 });
+    for (std::size_t i = 0; i < particles.size(); ++i)
+    {
+        acceleration[i] = (particles[i].charge / particles[i].mass) * field[i];
+    }
+
+    return acceleration;
+};
+
+void Ewald::report(std::ostream& out) const
+{
+    out << (m_pppm ? "pppm" : "ewald") << ": alpha " << m_alpha << ", real space cutoff " << m_cutoff << " (" << m_numCells << "x" << m_numCells << " cells)"
+        << ", kMax " << m_kMax;
+    if (m_pppm)
+    {
+        out << ", mesh " << m_meshSize << "x" << m_meshSize;
+    }
+    else
+    {
+        out << " (" << m_waves.size() << " waves)";
+    }
+    out << '\n' << "estimated RMS force error: real space " << m_realError << ", reciprocal space " << m_reciprocalError
+        << (m_pppm ? (m_reciprocalErrorMeasured ? " (measured against the direct k sum)" : " (analytic, measured on the first solve)") : "") << std::endl;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+
+#include "../FFT/FFT.hpp"
+#include "../Points/Points.hpp"
+#include "../Utilities/Utilities.hpp"
+
+// Ewald summation for the periodic domain: the 1/r interaction with every periodic image of every charge
+// (the minimum image convention alone truncates the sum at the box edge).
+// The particles live in the z = 0 plane of a 2D periodic lattice (period 2*bound), so this is the 2D-periodic
+// ("slab") Ewald sum evaluated at z = 0, split by erfc(alpha r)/r + erf(alpha r)/r:
+//     real space:       q_i q_j [erfc(alpha r)/r^2 + 2 alpha/sqrt(pi) exp(-alpha^2 r^2)/r] r_hat   for r < cutoff (cell lists)
+//     reciprocal space: q_i (2 pi/A) sum_k k_hat erfc(k/(2 alpha)) Im(exp(i k.r_i) conj(S(k))),   S(k) = sum_j q_j exp(i k.r_j)
+// The k = 0 term does not depend on the positions, so it never contributes to the forces (a net charge acts as if
+// it had a uniform neutralizing background).
+// The reciprocal sum is done either directly over the k vectors (Ewald, O(N^1.5) with balanced parameters) or on an
+// FFT mesh (PPPM: charge assignment, influence function with the assignment deconvolved, ik differentiation,
+// back-interpolation, O(N log N)).
+
+class Ewald
+{
+private:
+    struct Wave
+    {
+        double kx;
+        double ky;
+        double prefactor; // 2 (for -k) * 2 pi/A * erfc(k/(2 alpha))/k
+    };
+
+    double m_bound;
+    double m_length; // period
+    double m_area;
+    double m_tolerance; // erfc(alpha * cutoff), and the same relative cut on the reciprocal sum
+    double m_requestedCutoff; // 0: chosen from the number of particles
+    bool m_pppm;
+    Utilities::Assignment m_assignment;
+    std::size_t m_requestedMesh; // 0: chosen from the reciprocal cutoff
+
+    // parameters of the current setup (redone when the number of particles moved a factor s_retuneFactor away from the tuned one)
+    std::size_t m_numParticles { 0 }; // the parameters were chosen for (0: not set up yet)
+    std::size_t m_restoredParticles { 0 }; // tune for this number on the next solve (a restarted run, see tuneFor)
+    double m_cutoff { 0. };
+    double m_alpha { 0. };
+    double m_kMax { 0. };
+    std::size_t m_meshSize { 0 };
+    double m_realError { 0. }; // estimated RMS force errors
+    double m_reciprocalError { 0. };
+    bool m_reciprocalErrorMeasured { false }; // PPPM: measured against the direct k sum on the first solve
+    std::size_t m_pairInteractions { 0 }; // real space pairs of the last solve
+
+    // real space cell lists (cells at least `cutoff` wide, particles sorted by cell)
+    std::size_t m_numCells { 0 };
+    std::vector<std::size_t> m_cellStart;
+    std::vector<std::size_t> m_cellParticles;
+
+    // Ewald reciprocal space
+    std::vector<Wave> m_waves;
+    std::vector<double> m_structureReal;
+    std::vector<double> m_structureImag;
+
+    // PPPM
+    std::vector<double> m_influence; // per mesh mode, includes the FFT normalization and 1/A
+    std::vector<FFT::Complex> m_rho;
+    std::vector<FFT::Complex> m_Ex;
+    std::vector<FFT::Complex> m_Ey;
+
+    void setup(const std::vector<ChargedParticle2D>& particles, const std::size_t& numParticles);
+    void initializeWaves();
+    void initializeInfluence();
+    void estimateErrors(const std::vector<ChargedParticle2D>& particles);
+
+    void buildCells(const std::vector<ChargedParticle2D>& particles);
+    // returns the number of pairs within the cutoff
+    std::size_t addRealSpace(const std::vector<ChargedParticle2D>& particles, std::vector<Point2D>& field) const;
+    void addReciprocalEwald(const std::vector<ChargedParticle2D>& particles, std::vector<Point2D>& field, const std::vector<std::size_t>& targets);
+    void addReciprocalPPPM(const std::vector<ChargedParticle2D>& particles, std::vector<Point2D>& field);
+
+    // mesh nodes and weights of a particle along one dimension (periodic)
+    std::size_t meshWeights(double coordinate, std::size_t (&nodes)[3], double (&weights)[3]) const;
+
+public:
+    Ewald(const double& bound, const double& tolerance, const double& cutoff, const bool& pppm, const Utilities::Assignment& assignment, const std::size_t& meshSize);
+
+    // periodic Coulomb acceleration of every particle
+    std::vector<Point2D> calculateAcceleration(const std::vector<ChargedParticle2D>& particles);
+
+    // the next solve chooses the parameters for `numParticles` (the tuned number of a checkpoint), so that a restarted run
+    // with a changing population keeps the parameters it had
+    void tuneFor(const std::size_t& numParticles) { m_restoredParticles = numParticles; }
+
+    // parameters and error estimates of the current setup
+    void report(std::ostream& out) const;
+
+    // Getters
+    double alpha() const { return m_alpha; }
+    double cutoff() const { return m_cutoff; }
+    double kMax() const { return m_kMax; }
+    std::size_t meshSize() const { return m_meshSize; }
+    std::size_t tunedParticles() const { return m_numParticles; }
+    double realSpaceError() const { return m_realError; }
+    double reciprocalError() const { return m_reciprocalError; }
+    std::size_t pairInteractions() const { return m_pairInteractions; }
+};
@@ -0,0 +1,126 @@
+#include "FFT.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include "../Constants/Constants.hpp"
+
+namespace FFT
+{
+    namespace
+    {
+        std::size_t smallestFactor(std::size_t n)
+        {
+            if (n % 2 == 0) { return 2; }
+            for (std::size_t p = 3; p * p <= n; p += 2)
+            {
+                if (n % p == 0) { return p; }
+            }
+            return n;
+        };
+
+        std::vector<Complex> makeTwiddles(std::size_t n, bool inverse)
+        {
+            const double sign { inverse ? 1. : -1. };
+            std::vector<Complex> twiddles(n);
+            for (std::size_t t = 0; t < n; ++t)
+            {
+                twiddles[t] = std::polar(1., sign * 2 * Constants::pi * static_cast<double>(t) / static_cast<double>(n));
+            }
+            return twiddles;
+        };
+
+        // decimation in time on the smallest prime factor p of n: split into p interleaved subsequences,
+        // transform them recursively and combine (`twiddles` belongs to the top-level size n * stride)
+        void transformRecursive(Complex* data, Complex* scratch, std::size_t n, std::size_t stride, const std::vector<Complex>& twiddles)
+        {
+            if (n == 1) { return; }
+
+            const std::size_t p { smallestFactor(n) };
+            const std::size_t m { n / p };
+
+            for (std::size_t r = 0; r < p; ++r)
+            {
+                for (std::size_t k = 0; k < m; ++k) { scratch[r*m + k] = data[k*p + r]; }
+            }
+
+            // `data` is free to be used as scratch space by the sub-transforms now
+            for (std::size_t r = 0; r < p; ++r)
+            {
+                transformRecursive(scratch + r*m, data + r*m, m, stride * p, twiddles);
+            }
+
+            for (std::size_t q = 0; q < p; ++q)
+            {
+                for (std::size_t k = 0; k < m; ++k)
+                {
+                    const std::size_t idx { k + q*m };
+                    Complex sum { scratch[k] };
+                    for (std::size_t r = 1; r < p; ++r)
+                    {
+                        sum += scratch[r*m + k] * twiddles[((r * idx) % n) * stride];
+                    }
+                    data[idx] = sum;
+                }
+            }
+        };
+    };
+
+    void transform(std::vector<Complex>& data, bool inverse)
+    {
+        const std::size_t n { data.size() };
+        if (n < 2) { return; }
+
+        std::vector<Complex> scratch(n);
+        transformRecursive(data.data(), scratch.data(), n, 1, makeTwiddles(n, inverse));
+
+        if (inverse)
+        {
+            for (Complex& value : data) { value /= static_cast<double>(n); }
+        }
+    };
+
+    void transform2D(std::vector<Complex>& data, std::size_t nx, std::size_t ny, bool inverse)
+    {
+        const std::vector<Complex> rowTwiddles { makeTwiddles(ny, inverse) };
+        const std::vector<Complex> columnTwiddles { makeTwiddles(nx, inverse) };
+
+        #pragma omp parallel
+        {
+            std::vector<Complex> scratch(std::max(nx, ny));
+            std::vector<Complex> column(nx);
+
+            #pragma omp for
+            for (std::size_t i = 0; i < nx; ++i)
+            {
+                transformRecursive(data.data() + i*ny, scratch.data(), ny, 1, rowTwiddles);
+            }
+
+            #pragma omp for
+            for (std::size_t j = 0; j < ny; ++j)
+            {
+                for (std::size_t i = 0; i < nx; ++i) { column[i] = data[i*ny + j]; }
+                transformRecursive(column.data(), scratch.data(), nx, 1, columnTwiddles);
+                for (std::size_t i = 0; i < nx; ++i) { data[i*ny + j] = column[i]; }
+            }
+        }
+
+        if (inverse)
+        {
+            const double norm { 1. / static_cast<double>(nx * ny) };
+            for (Complex& value : data) { value *= norm; }
+        }
+    };
+
+    std::size_t nextFastSize(std::size_t n)
+    {
+        for (std::size_t m = std::max<std::size_t>(n, 1);; ++m)
+        {
+            std::size_t rest { m };
+            for (const std::size_t p : {std::size_t{2}, std::size_t{3}, std::size_t{5}})
+            {
+                while (rest % p == 0) { rest /= p; }
+            }
+            if (rest == 1) { return m; }
+        }
+    };
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+
+// Small self-contained mixed-radix FFT (no external dependency)
+// Sizes with only small prime factors are fast, any size works (large prime factors fall back to an O(n p) combine step)
+
+namespace FFT
+{
+    using Complex = std::complex<double>;
+
+    // in-place 1D transform, the inverse is normalized by 1/n
+    void transform(std::vector<Complex>& data, bool inverse);
+
+    // in-place 2D transform of a row-major nx by ny array (rows and columns are transformed in parallel)
+    void transform2D(std::vector<Complex>& data, std::size_t nx, std::size_t ny, bool inverse);
+
+    // smallest size >= n whose only prime factors are 2, 3 and 5
+    std::size_t nextFastSize(std::size_t n);
+};
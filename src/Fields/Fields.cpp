@@ -0,0 +1,547 @@
+#include "Fields.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "../Constants/Constants.hpp"
+
+namespace FieldKernels
+{
+    namespace
+    {
+        // grid points per block, the block's coordinates and accumulators (5 arrays, 10 kB) stay in L1 while a source tile is applied
+        constexpr std::size_t s_blockSize { 256 };
+        // sources per tile (3 arrays, 12 kB), reused from L1 for every grid block of a thread
+        constexpr std::size_t s_sourceTile { 512 };
+
+        struct PointChargeArgs
+        {
+            const double* gridX;
+            const double* gridY;
+            std::size_t numGridPoints;
+            const double* sourceX;
+            const double* sourceY;
+            const double* charge;
+            std::size_t numSources;
+            double bound;
+            double* magnitude;
+            double* x;
+            double* y;
+        };
+
+        struct PointCharge3DArgs
+        {
+            const double* axisX;
+            const double* axisY;
+            const double* axisZ;
+            std::size_t numX;
+            std::size_t numY;
+            std::size_t numZ;
+            const double* sourceX;
+            const double* sourceY;
+            const double* sourceZ;
+            const double* charge;
+            std::size_t numSources;
+            double bound;
+            double* magnitude;
+            double* x;
+            double* y;
+            double* z;
+        };
+
+        struct InfiniteWireArgs
+        {
+            const double* gridX;
+            const double* gridY;
+            std::size_t numGridPoints;
+            const double* wireX;
+            const double* wireY;
+            const double* current;
+            const double* directionX;
+            const double* directionY;
+            const double* directionZ;
+            std::size_t numWires;
+            double* magnitude;
+            double* x;
+            double* y;
+        };
+
+        struct WirePointArgs
+        {
+            const double* pointX;
+            const double* pointY;
+            std::size_t numPoints;
+            const double* wireX;
+            const double* wireY;
+            const double* current;
+            const double* directionX;
+            const double* directionY;
+            const double* directionZ;
+            std::size_t numWires;
+            double* fieldX;
+            double* fieldY;
+            double* fieldZ;
+        };
+
+        [[gnu::always_inline]] inline void normalize(double* __restrict x, double* __restrict y, std::size_t begin, std::size_t end)
+        {
+            #pragma omp simd
+            for (std::size_t idx = begin; idx < end; ++idx)
+            {
+                const double inverseNorm { 1. / std::sqrt(x[idx]*x[idx] + y[idx]*y[idx]) };
+                x[idx] *= inverseNorm;
+                y[idx] *= inverseNorm;
+            }
+        };
+
+        // Parallel, cache-tiled sweep over grid blocks x source tiles:
+        // each thread owns a contiguous range of grid blocks, and every tile of sources is applied to all of its blocks
+        // before moving on, so a tile (s_sourceTile sources) stays in L1 while the accumulators stream through L1/L2.
+        // All loops use the same static schedule, so a thread keeps the same blocks throughout (no barriers needed
+        // between them, and the accumulators are first touched by the thread that uses them).
+        // The loops are the orphaned worksharing loops of the parallel region each ISA's function opens (see below).
+        template <typename Accumulate>
+        [[gnu::always_inline]] inline void tiledGridLoop(std::size_t numGridPoints, std::size_t numSources, double* magnitude, double* x, double* y, const Accumulate& accumulate)
+        {
+            const std::size_t numBlocks { (numGridPoints + s_blockSize - 1) / s_blockSize };
+
+            #pragma omp for schedule(static) nowait
+            for (std::size_t block = 0; block < numBlocks; ++block)
+            {
+                const std::size_t begin { block * s_blockSize };
+                const std::size_t end { std::min(begin + s_blockSize, numGridPoints) };
+                std::fill(magnitude + begin, magnitude + end, 0.);
+                std::fill(x + begin, x + end, 0.);
+                std::fill(y + begin, y + end, 0.);
+            }
+
+            for (std::size_t tileBegin = 0; tileBegin < numSources; tileBegin += s_sourceTile)
+            {
+                const std::size_t tileEnd { std::min(tileBegin + s_sourceTile, numSources) };
+
+                #pragma omp for schedule(static) nowait
+                for (std::size_t block = 0; block < numBlocks; ++block)
+                {
+                    const std::size_t begin { block * s_blockSize };
+                    accumulate(begin, std::min(begin + s_blockSize, numGridPoints), tileBegin, tileEnd);
+                }
+            }
+
+            #pragma omp for schedule(static) nowait
+            for (std::size_t block = 0; block < numBlocks; ++block)
+            {
+                const std::size_t begin { block * s_blockSize };
+                normalize(x, y, begin, std::min(begin + s_blockSize, numGridPoints));
+            }
+        };
+
+        // one sqrt and one division per pair (instead of a division per component), divisions are the bottleneck at any vector width
+        template <bool Periodic>
+        [[gnu::always_inline]] inline void pointChargeFieldImpl(const PointChargeArgs& args)
+        {
+            const double* __restrict gridX { args.gridX };
+            const double* __restrict gridY { args.gridY };
+            double* __restrict magnitude { args.magnitude };
+            double* __restrict x { args.x };
+            double* __restrict y { args.y };
+            const double period { 2 * args.bound };
+            const double inverseBound { 1. / args.bound };
+
+            tiledGridLoop(args.numGridPoints, args.numSources, magnitude, x, y, [&](std::size_t begin, std::size_t end, std::size_t sourceBegin, std::size_t sourceEnd)
+            {
+                for (std::size_t s = sourceBegin; s < sourceEnd; ++s)
+                {
+                    const double sourceX { args.sourceX[s] };
+                    const double sourceY { args.sourceY[s] };
+                    const double charge { args.charge[s] };
+                    const double sign { charge < 0 ? -1. : 1. }; // negative charge means the electric field points towards the charge
+
+                    #pragma omp simd
+                    for (std::size_t idx = begin; idx < end; ++idx)
+                    {
+                        double dx { gridX[idx] - sourceX };
+                        double dy { gridY[idx] - sourceY };
+                        if constexpr (Periodic)
+                        {
+                            // minimum image convention, same as Utilities::r_prime
+                            dx -= std::trunc(dx * inverseBound) * period;
+                            dy -= std::trunc(dy * inverseBound) * period;
+                        }
+
+                        const double inverseR { 1. / std::sqrt(dx*dx + dy*dy) };
+                        magnitude[idx] += charge * inverseR * inverseR;
+                        x[idx] += sign * dx * inverseR;
+                        y[idx] += sign * dy * inverseR;
+                    }
+                }
+            });
+        };
+
+        // 3D: a block is one row of the grid (fixed x and y, every z), so the x/y separation is computed once per row and source
+        // and only the z loop is vectorized. Same tiling and static schedule as tiledGridLoop.
+        template <bool Periodic>
+        [[gnu::always_inline]] inline void pointChargeField3DImpl(const PointCharge3DArgs& args)
+        {
+            const double* __restrict axisZ { args.axisZ };
+            const std::size_t numZ { args.numZ };
+            const std::size_t numRows { args.numX * args.numY };
+            const double period { 2 * args.bound };
+            const double inverseBound { 1. / args.bound };
+
+            #pragma omp for schedule(static) nowait
+            for (std::size_t row = 0; row < numRows; ++row)
+            {
+                const std::size_t begin { row * numZ };
+                std::fill(args.magnitude + begin, args.magnitude + begin + numZ, 0.);
+                std::fill(args.x + begin, args.x + begin + numZ, 0.);
+                std::fill(args.y + begin, args.y + begin + numZ, 0.);
+                std::fill(args.z + begin, args.z + begin + numZ, 0.);
+            }
+
+            for (std::size_t tileBegin = 0; tileBegin < args.numSources; tileBegin += s_sourceTile)
+            {
+                const std::size_t tileEnd { std::min(tileBegin + s_sourceTile, args.numSources) };
+
+                #pragma omp for schedule(static) nowait
+                for (std::size_t row = 0; row < numRows; ++row)
+                {
+                    const double gridX { args.axisX[row / args.numY] };
+                    const double gridY { args.axisY[row % args.numY] };
+                    double* __restrict magnitude { args.magnitude + row * numZ };
+                    double* __restrict x { args.x + row * numZ };
+                    double* __restrict y { args.y + row * numZ };
+                    double* __restrict z { args.z + row * numZ };
+
+                    for (std::size_t s = tileBegin; s < tileEnd; ++s)
+                    {
+                        const double sourceZ { args.sourceZ[s] };
+                        const double charge { args.charge[s] };
+                        const double sign { charge < 0 ? -1. : 1. }; // negative charge means the electric field points towards the charge
+
+                        double dx { gridX - args.sourceX[s] };
+                        double dy { gridY - args.sourceY[s] };
+                        if constexpr (Periodic)
+                        {
+                            // minimum image convention, same as Utilities::r_prime
+                            dx -= std::trunc(dx * inverseBound) * period;
+                            dy -= std::trunc(dy * inverseBound) * period;
+                        }
+                        const double rxy2 { dx*dx + dy*dy };
+
+                        #pragma omp simd
+                        for (std::size_t k = 0; k < numZ; ++k)
+                        {
+                            double dz { axisZ[k] - sourceZ };
+                            if constexpr (Periodic)
+                            {
+                                dz -= std::trunc(dz * inverseBound) * period;
+                            }
+
+                            const double inverseR { 1. / std::sqrt(rxy2 + dz*dz) };
+                            magnitude[k] += charge * inverseR * inverseR;
+                            x[k] += sign * dx * inverseR;
+                            y[k] += sign * dy * inverseR;
+                            z[k] += sign * dz * inverseR;
+                        }
+                    }
+                }
+            }
+
+            #pragma omp for schedule(static) nowait
+            for (std::size_t row = 0; row < numRows; ++row)
+            {
+                double* __restrict x { args.x + row * numZ };
+                double* __restrict y { args.y + row * numZ };
+                double* __restrict z { args.z + row * numZ };
+
+                #pragma omp simd
+                for (std::size_t k = 0; k < numZ; ++k)
+                {
+                    const double inverseNorm { 1. / std::sqrt(x[k]*x[k] + y[k]*y[k] + z[k]*z[k]) };
+                    x[k] *= inverseNorm;
+                    y[k] *= inverseNorm;
+                    z[k] *= inverseNorm;
+                }
+            }
+        };
+
+        [[gnu::always_inline]] inline void infiniteWireFieldImpl(const InfiniteWireArgs& args)
+        {
+            const double* __restrict gridX { args.gridX };
+            const double* __restrict gridY { args.gridY };
+            double* __restrict magnitude { args.magnitude };
+            double* __restrict x { args.x };
+            double* __restrict y { args.y };
+            const double inverseTwoPi { 1. / (2 * Constants::pi) };
+
+            tiledGridLoop(args.numGridPoints, args.numWires, magnitude, x, y, [&](std::size_t begin, std::size_t end, std::size_t wireBegin, std::size_t wireEnd)
+            {
+                for (std::size_t w = wireBegin; w < wireEnd; ++w)
+                {
+                    const double wireX { args.wireX[w] };
+                    const double wireY { args.wireY[w] };
+                    const double current { args.current[w] };
+                    const double dirX { args.directionX[w] };
+                    const double dirY { args.directionY[w] };
+                    const double dirZ { args.directionZ[w] };
+
+                    #pragma omp simd
+                    for (std::size_t idx = begin; idx < end; ++idx)
+                    {
+                        const double rx { gridX[idx] - wireX };
+                        const double ry { gridY[idx] - wireY };
+                        const double inverseR { 1. / std::sqrt(rx*rx + ry*ry) };
+
+                        // direction x (unit vector from the wire to the grid point, z = 0)
+                        const double ux { rx * inverseR };
+                        const double uy { ry * inverseR };
+                        const double cx { -dirZ * uy };
+                        const double cy { dirZ * ux };
+                        const double cz { dirX * uy - dirY * ux };
+
+                        magnitude[idx] += current * inverseTwoPi * inverseR * std::sqrt(cx*cx + cy*cy + cz*cz);
+                        x[idx] += cx * inverseR;
+                        y[idx] += cy * inverseR;
+                    }
+                }
+            });
+        };
+
+        // points in blocks (a block's coordinates and field stay in L1 while every wire is applied), one division per pair
+        [[gnu::always_inline]] inline void infiniteWireFieldAtPointsBlock(const WirePointArgs& args, std::size_t block)
+        {
+            const double* __restrict pointX { args.pointX };
+            const double* __restrict pointY { args.pointY };
+            double* __restrict fieldX { args.fieldX };
+            double* __restrict fieldY { args.fieldY };
+            double* __restrict fieldZ { args.fieldZ };
+            const double inverseTwoPi { 1. / (2 * Constants::pi) };
+
+            const std::size_t begin { block * s_blockSize };
+            const std::size_t end { std::min(begin + s_blockSize, args.numPoints) };
+            std::fill(fieldX + begin, fieldX + end, 0.);
+            std::fill(fieldY + begin, fieldY + end, 0.);
+            std::fill(fieldZ + begin, fieldZ + end, 0.);
+
+            for (std::size_t w = 0; w < args.numWires; ++w)
+            {
+                const double wireX { args.wireX[w] };
+                const double wireY { args.wireY[w] };
+                const double strength { args.current[w] * inverseTwoPi };
+                const double dirX { args.directionX[w] };
+                const double dirY { args.directionY[w] };
+                const double dirZ { args.directionZ[w] };
+
+                #pragma omp simd
+                for (std::size_t idx = begin; idx < end; ++idx)
+                {
+                    // separation from the wire with the part along the wire taken out (the point is at z = 0)
+                    const double rx { pointX[idx] - wireX };
+                    const double ry { pointY[idx] - wireY };
+                    const double along { rx * dirX + ry * dirY };
+                    const double rhoX { rx - along * dirX };
+                    const double rhoY { ry - along * dirY };
+                    const double rhoZ { -along * dirZ };
+                    const double scale { strength / (rhoX*rhoX + rhoY*rhoY + rhoZ*rhoZ) };
+
+                    fieldX[idx] += scale * (dirY * rhoZ - dirZ * rhoY);
+                    fieldY[idx] += scale * (dirZ * rhoX - dirX * rhoZ);
+                    fieldZ[idx] += scale * (dirX * rhoY - dirY * rhoX);
+                }
+            }
+        };
+
+        std::size_t numPointBlocks(const WirePointArgs& args)
+        {
+            return (args.numPoints + s_blockSize - 1) / s_blockSize;
+        };
+
+        // the parallel regions are in each ISA's function (not in the inlined kernels), so that their outlined bodies are compiled
+        // for that ISA (like DirectSum's pair sums)
+        void pointChargeFieldScalar(const PointChargeArgs& args, bool periodic)
+        {
+            #pragma omp parallel
+            { periodic ? pointChargeFieldImpl<true>(args) : pointChargeFieldImpl<false>(args); }
+        };
+
+        void pointChargeField3DScalar(const PointCharge3DArgs& args, bool periodic)
+        {
+            #pragma omp parallel
+            { periodic ? pointChargeField3DImpl<true>(args) : pointChargeField3DImpl<false>(args); }
+        };
+
+        void infiniteWireFieldScalar(const InfiniteWireArgs& args)
+        {
+            #pragma omp parallel
+            { infiniteWireFieldImpl(args); }
+        };
+
+        void infiniteWireFieldAtPointsScalar(const WirePointArgs& args)
+        {
+            #pragma omp parallel for schedule(static)
+            for (std::size_t block = 0; block < numPointBlocks(args); ++block) { infiniteWireFieldAtPointsBlock(args, block); }
+        };
+
+#if defined(__x86_64__)
+        __attribute__((target("avx2,fma"))) void pointChargeFieldAVX2(const PointChargeArgs& args, bool periodic)
+        {
+            #pragma omp parallel
+            { periodic ? pointChargeFieldImpl<true>(args) : pointChargeFieldImpl<false>(args); }
+        };
+
+        __attribute__((target("avx2,fma"))) void pointChargeField3DAVX2(const PointCharge3DArgs& args, bool periodic)
+        {
+            #pragma omp parallel
+            { periodic ? pointChargeField3DImpl<true>(args) : pointChargeField3DImpl<false>(args); }
+        };
+
+        __attribute__((target("avx2,fma"))) void infiniteWireFieldAVX2(const InfiniteWireArgs& args)
+        {
+            #pragma omp parallel
+            { infiniteWireFieldImpl(args); }
+        };
+
+        __attribute__((target("avx2,fma"))) void infiniteWireFieldAtPointsAVX2(const WirePointArgs& args)
+        {
+            #pragma omp parallel for schedule(static)
+            for (std::size_t block = 0; block < numPointBlocks(args); ++block) { infiniteWireFieldAtPointsBlock(args, block); }
+        };
+
+        __attribute__((target("avx512f"))) void pointChargeFieldAVX512(const PointChargeArgs& args, bool periodic)
+        {
+            #pragma omp parallel
+            { periodic ? pointChargeFieldImpl<true>(args) : pointChargeFieldImpl<false>(args); }
+        };
+
+        __attribute__((target("avx512f"))) void pointChargeField3DAVX512(const PointCharge3DArgs& args, bool periodic)
+        {
+            #pragma omp parallel
+            { periodic ? pointChargeField3DImpl<true>(args) : pointChargeField3DImpl<false>(args); }
+        };
+
+        __attribute__((target("avx512f"))) void infiniteWireFieldAVX512(const InfiniteWireArgs& args)
+        {
+            #pragma omp parallel
+            { infiniteWireFieldImpl(args); }
+        };
+
+        __attribute__((target("avx512f"))) void infiniteWireFieldAtPointsAVX512(const WirePointArgs& args)
+        {
+            #pragma omp parallel for schedule(static)
+            for (std::size_t block = 0; block < numPointBlocks(args); ++block) { infiniteWireFieldAtPointsBlock(args, block); }
+        };
+#endif
+
+        ISA& selectedISA()
+        {
+            static ISA isa { detectISA() };
+            return isa;
+        };
+    };
+
+    ISA detectISA()
+    {
+#if defined(__x86_64__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) { return ISA::avx512; }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) { return ISA::avx2; }
+#endif
+        return ISA::scalar;
+    };
+
+    const char* isaName(ISA isa)
+    {
+        switch (isa)
+        {
+            case ISA::avx2: return "avx2";
+            case ISA::avx512: return "avx512";
+            default: return "scalar";
+        }
+    };
+
+    ISA activeISA()
+    {
+        return selectedISA();
+    };
+
+    void setISA(ISA isa)
+    {
+        if (static_cast<int>(isa) > static_cast<int>(detectISA()))
+        {
+            std::cerr << isaName(isa) << " is not supported on this machine! Using " << isaName(detectISA()) << "..." << std::endl;
+            isa = detectISA();
+        }
+        selectedISA() = isa;
+    };
+
+    void pointChargeField(const AlignedVector& gridX, const AlignedVector& gridY,
+                          const double* sourceX, const double* sourceY, const double* charge, std::size_t numSources,
+                          bool periodic, double bound, FieldStore2D& field)
+    {
+        field.resize(gridX.size());
+        const PointChargeArgs args { gridX.data(), gridY.data(), gridX.size(), sourceX, sourceY, charge, numSources, bound, field.magnitude.data(), field.x.data(), field.y.data() };
+
+        switch (activeISA())
+        {
+#if defined(__x86_64__)
+            case ISA::avx512: pointChargeFieldAVX512(args, periodic); break;
+            case ISA::avx2: pointChargeFieldAVX2(args, periodic); break;
+#endif
+            default: pointChargeFieldScalar(args, periodic); break;
+        }
+    };
+
+    void pointChargeField3D(const AlignedVector& axisX, const AlignedVector& axisY, const AlignedVector& axisZ,
+                            const double* sourceX, const double* sourceY, const double* sourceZ, const double* charge, std::size_t numSources,
+                            bool periodic, double bound, FieldStore3D& field)
+    {
+        field.resize(axisX.size() * axisY.size() * axisZ.size());
+        const PointCharge3DArgs args { axisX.data(), axisY.data(), axisZ.data(), axisX.size(), axisY.size(), axisZ.size(),
+                                       sourceX, sourceY, sourceZ, charge, numSources, bound, field.magnitude.data(), field.x.data(), field.y.data(), field.z.data() };
+
+        switch (activeISA())
+        {
+#if defined(__x86_64__)
+            case ISA::avx512: pointChargeField3DAVX512(args, periodic); break;
+            case ISA::avx2: pointChargeField3DAVX2(args, periodic); break;
+#endif
+            default: pointChargeField3DScalar(args, periodic); break;
+        }
+    };
+
+    void infiniteWireField(const AlignedVector& gridX, const AlignedVector& gridY,
+                           const double* wireX, const double* wireY, const double* current,
+                           const double* directionX, const double* directionY, const double* directionZ, std::size_t numWires,
+                           FieldStore2D& field)
+    {
+        field.resize(gridX.size());
+        const InfiniteWireArgs args { gridX.data(), gridY.data(), gridX.size(), wireX, wireY, current, directionX, directionY, directionZ, numWires, field.magnitude.data(), field.x.data(), field.y.data() };
+
+        switch (activeISA())
+        {
+#if defined(__x86_64__)
+            case ISA::avx512: infiniteWireFieldAVX512(args); break;
+            case ISA::avx2: infiniteWireFieldAVX2(args); break;
+#endif
+            default: infiniteWireFieldScalar(args); break;
+        }
+    };
+
+    void infiniteWireFieldAtPoints(const double* pointX, const double* pointY, std::size_t numPoints,
+                                   const double* wireX, const double* wireY, const double* current,
+                                   const double* directionX, const double* directionY, const double* directionZ, std::size_t numWires,
+                                   double* fieldX, double* fieldY, double* fieldZ)
+    {
+        const WirePointArgs args { pointX, pointY, numPoints, wireX, wireY, current, directionX, directionY, directionZ, numWires, fieldX, fieldY, fieldZ };
+
+        switch (activeISA())
+        {
+#if defined(__x86_64__)
+            case ISA::avx512: infiniteWireFieldAtPointsAVX512(args); break;
+            case ISA::avx2: infiniteWireFieldAtPointsAVX2(args); break;
+#endif
+            default: infiniteWireFieldAtPointsScalar(args); break;
+        }
+    };
+};
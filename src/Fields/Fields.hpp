@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "../Points/Points.hpp"
+
+// 64 byte aligned allocations (one cache line, or one AVX-512 register)
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator
+{
+    using value_type = T;
+
+    template <typename U>
+    struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator() = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(std::size_t n)
+    {
+        // std::aligned_alloc needs the size to be a multiple of the alignment
+        const std::size_t bytes { ((n * sizeof(T) + Alignment - 1) / Alignment) * Alignment };
+        void* ptr { std::aligned_alloc(Alignment, bytes) };
+        if (ptr == nullptr) { throw std::bad_alloc(); }
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, std::size_t) { std::free(ptr); }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+};
+
+using AlignedVector = std::vector<double, AlignedAllocator<double>>;
+
+// structure-of-arrays storage of a 2D field on the grid, entry idx belongs to Geometry<2>::grid()[idx]
+struct FieldStore2D
+{
+    AlignedVector magnitude; // V/m or T
+    AlignedVector x; // unit vector components
+    AlignedVector y;
+
+    std::size_t size() const { return magnitude.size(); }
+    bool empty() const { return magnitude.empty(); }
+
+    void resize(std::size_t n)
+    {
+        magnitude.resize(n, 0.);
+        x.resize(n, 0.);
+        y.resize(n, 0.);
+    }
+
+    Field2D operator[](std::size_t idx) const { return Field2D {magnitude[idx], Point2D {x[idx], y[idx]}}; }
+
+    // in the order they are written to the run file
+    std::vector<const AlignedVector*> components() const { return { &magnitude, &x, &y }; }
+};
+
+// same for a 3D field
+struct FieldStore3D
+{
+    AlignedVector magnitude; // V/m
+    AlignedVector x; // unit vector components
+    AlignedVector y;
+    AlignedVector z;
+
+    std::size_t size() const { return magnitude.size(); }
+    bool empty() const { return magnitude.empty(); }
+
+    void resize(std::size_t n)
+    {
+        magnitude.resize(n, 0.);
+        x.resize(n, 0.);
+        y.resize(n, 0.);
+        z.resize(n, 0.);
+    }
+
+    Field3D operator[](std::size_t idx) const { return Field3D {magnitude[idx], Point3D {x[idx], y[idx], z[idx]}}; }
+
+    std::vector<const AlignedVector*> components() const { return { &magnitude, &x, &y, &z }; }
+};
+
+// Field kernels on the SoA grid, the grid point loops are written to vectorize (no branches, no getters)
+// and are compiled once per instruction set, picking the widest one the CPU supports at runtime.
+// The scalar build is the reference; the vector builds only differ from it by FMA contraction/rounding,
+// and all of them agree with the original per-point loop to round-off.
+// (sqrt must not set errno for the loops to vectorize: -fno-math-errno, which is already the default on macOS)
+
+namespace FieldKernels
+{
+    enum class ISA
+    {
+        scalar, // whatever the baseline target gives (SSE2 on x86-64, NEON on arm64)
+        avx2,
+        avx512,
+    };
+
+    // widest instruction set supported by both this build and the CPU
+    ISA detectISA();
+    const char* isaName(ISA isa);
+
+    // the instruction set used by the kernels (detected on first use, can be overridden e.g. to compare against the scalar path)
+    ISA activeISA();
+    void setISA(ISA isa);
+
+    // point-charge electric field (same conventions as StaticPhysics: summed q/r^2 and summed signed unit vectors)
+    void pointChargeField(const AlignedVector& gridX, const AlignedVector& gridY,
+                          const double* sourceX, const double* sourceY, const double* charge, std::size_t numSources,
+                          bool periodic, double bound, FieldStore2D& field);
+
+    // point-charge electric field on the 3D tensor grid axisX x axisY x axisZ (z runs fastest, same conventions as the 2D field)
+    // only the axes are needed: the coordinates of the (up to millions of) grid points are never stored
+    void pointChargeField3D(const AlignedVector& axisX, const AlignedVector& axisY, const AlignedVector& axisZ,
+                            const double* sourceX, const double* sourceY, const double* sourceZ, const double* charge, std::size_t numSources,
+                            bool periodic, double bound, FieldStore3D& field);
+
+    // infinite-wire magnetic field
+    void infiniteWireField(const AlignedVector& gridX, const AlignedVector& gridY,
+                           const double* wireX, const double* wireY, const double* current,
+                           const double* directionX, const double* directionY, const double* directionZ, std::size_t numWires,
+                           FieldStore2D& field);
+
+    // infinite-wire magnetic field vector at arbitrary points of the plane z = 0 (the particles, for the Boris pusher):
+    // B = current / (2 pi) * (direction x rho) / |rho|^2 with rho the perpendicular separation from the wire,
+    // the same strength as infiniteWireField but as Cartesian components instead of magnitude and direction
+    void infiniteWireFieldAtPoints(const double* pointX, const double* pointY, std::size_t numPoints,
+                                   const double* wireX, const double* wireY, const double* current,
+                                   const double* directionX, const double* directionY, const double* directionZ, std::size_t numWires,
+                                   double* fieldX, double* fieldY, double* fieldZ);
+};
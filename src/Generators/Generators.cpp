@@ -0,0 +1,205 @@
+#include "Generators.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+    // what one generator block of the config asks for
+    struct Spec
+    {
+        std::string type;
+        std::size_t count { 0 }; // particles (plasma: twice the pairs)
+        std::array<std::size_t, 3> points { 0, 0, 0 }; // lattice points per dimension
+        double charge { 1. };
+        double mass { 1. };
+        double electronMass { 1. };
+        double temperature { 0. };
+        double electronTemperature { 0. };
+        Point3D drift { 0., 0., 0. };
+        Point3D center { 0., 0., 0. };
+        double sigma { 0. };
+        double separation { 0. };
+        std::array<double, 3> lower; // box the particles are placed in (within the domain)
+        std::array<double, 3> upper;
+    };
+
+    template <std::size_t N>
+    Spec parse(const nlohmann::json& _j, const double& bound, const double& chargeScale)
+    {
+        Spec spec;
+        spec.type = _j.value("type", "uniform");
+        spec.charge = chargeScale * _j.value("charge", 1.);
+        spec.mass = std::abs(_j.value("mass", 1.));
+        spec.electronMass = std::abs(_j.value("electron mass", 1.));
+        spec.temperature = _j.value("temperature", 0.);
+        spec.electronTemperature = _j.value("electron temperature", spec.temperature);
+        spec.temperature = _j.value("ion temperature", spec.temperature);
+        spec.sigma = _j.value("sigma", 0.1 * bound);
+        spec.separation = _j.value("separation", 1e-3 * bound);
+
+        const nlohmann::json drift = _j.value("drift", nlohmann::json::object());
+        spec.drift = Point3D { drift.value("vx", 0.), drift.value("vy", 0.), drift.value("vz", 0.) };
+        const nlohmann::json center = _j.value("center", nlohmann::json::object());
+        spec.center = Point3D { center.value("x", 0.), center.value("y", 0.), center.value("z", 0.) };
+
+        // the box of the particles is clipped to the domain, so every generated particle is inside of it
+        const nlohmann::json box = _j.value("box", nlohmann::json::object());
+        const char* names[3][2] { {"xmin", "xmax"}, {"ymin", "ymax"}, {"zmin", "zmax"} };
+        for (std::size_t d = 0; d < 3; ++d)
+        {
+            spec.lower[d] = std::max(box.value(names[d][0], -bound), -bound);
+            spec.upper[d] = std::min(box.value(names[d][1], bound), bound);
+            if (spec.lower[d] > spec.upper[d])
+            {
+                std::cerr << "Empty generator box! Using the whole domain..." << std::endl;
+                spec.lower[d] = -bound;
+                spec.upper[d] = bound;
+            }
+        }
+
+        if (spec.type == "lattice")
+        {
+            const nlohmann::json points = _j.value("points", nlohmann::json(10));
+            spec.count = 1;
+            for (std::size_t d = 0; d < N; ++d)
+            {
+                spec.points[d] = points.is_array() ? points.at(std::min(d, points.size() - 1)).get<std::size_t>() : points.get<std::size_t>();
+                spec.count *= spec.points[d];
+            }
+        }
+        else if (spec.type == "plasma")
+        {
+            spec.count = 2 * _j.value("pairs", std::size_t {0});
+        }
+        else
+        {
+            if (spec.type != "uniform" && spec.type != "gaussian")
+            {
+                std::cerr << "Unknown generator \"" << spec.type << "\"! Using a uniform cloud..." << std::endl;
+                spec.type = "uniform";
+            }
+            spec.count = _j.value("count", std::size_t {0});
+        }
+
+        return spec;
+    };
+
+    template <std::size_t N>
+    Point<N> uniformPosition(const Spec& spec, Philox& random)
+    {
+        Point<N> position;
+        for (std::size_t d = 0; d < N; ++d) { position[d] = spec.lower[d] + (spec.upper[d] - spec.lower[d]) * random.uniform(); }
+        return position;
+    };
+
+    // the particles of one generator, particle i only draws from its own stream
+    template <std::size_t N>
+    void fill(const Spec& spec, const std::uint64_t& seed, const std::uint32_t& generator, const double& bound,
+              std::vector<Point<N>>& positions, std::vector<Point3D>& velocities)
+    {
+        const bool plasma { spec.type == "plasma" };
+        const bool gaussian { spec.type == "gaussian" };
+        const bool lattice { spec.type == "lattice" };
+
+        #pragma omp parallel for schedule(static)
+        for (std::size_t i = 0; i < spec.count; ++i)
+        {
+            // the placement stream of a plasma pair is shared by both particles (the electron starts at the ion), everything
+            // else (the electron's offset and every velocity) comes from the particle's own stream
+            Philox random { seed, plasma ? i / 2 : i, generator };
+            Philox own { seed, i, generator | 0x80000000u };
+
+            Point<N> position;
+            if (lattice)
+            {
+                std::size_t index { i };
+                for (std::size_t d = N; d-- > 0;)
+                {
+                    const std::size_t cell { index % spec.points[d] };
+                    index /= spec.points[d];
+                    position[d] = spec.lower[d] + (spec.upper[d] - spec.lower[d]) * (static_cast<double>(cell) + 0.5) / static_cast<double>(spec.points[d]);
+                }
+            }
+            else if (gaussian)
+            {
+                // a fixed number of attempts keeps the streams reproducible, the rare leftover is clamped into the box
+                for (std::size_t attempt = 0; attempt < 64; ++attempt)
+                {
+                    for (std::size_t d = 0; d < N; ++d) { position[d] = spec.center[d] + spec.sigma * random.normal(); }
+                    if (Utilities::checkPointWithinBounds(position, bound)) { break; }
+                }
+                for (std::size_t d = 0; d < N; ++d) { position[d] = std::clamp(position[d], spec.lower[d], spec.upper[d]); }
+            }
+            else
+            {
+                position = uniformPosition<N>(spec, random);
+            }
+
+            if (plasma && i % 2 == 1)
+            {
+                // random direction (normalized normal draws), turned around if it leaves the box
+                Point<N> direction;
+                for (std::size_t d = 0; d < N; ++d) { direction[d] = own.normal(); }
+                direction *= spec.separation / std::max(direction.magnitude(), 1e-300);
+                if (!Utilities::checkPointWithinBounds(position + direction, bound)) { direction *= -1.; }
+                position += direction;
+                for (std::size_t d = 0; d < N; ++d) { position[d] = std::clamp(position[d], spec.lower[d], spec.upper[d]); }
+            }
+            positions[i] = position;
+
+            const bool electron { plasma && i % 2 == 1 };
+            const double mass { electron ? spec.electronMass : spec.mass };
+            const double thermalSpeed { std::sqrt(std::max(electron ? spec.electronTemperature : spec.temperature, 0.) / mass) };
+            Point3D velocity { spec.drift };
+            if (thermalSpeed > 0.)
+            {
+                for (std::size_t d = 0; d < N; ++d) { velocity[d] += thermalSpeed * own.normal(); }
+            }
+            velocities[i] = velocity;
+        }
+    };
+};
+
+namespace Generators
+{
+    template <std::size_t N>
+    std::size_t generate(const nlohmann::json& spec, const std::uint64_t& seed, const double& bound, const double& chargeScale,
+                         std::vector<ChargedParticle<N>>& particles)
+    {
+        const nlohmann::json generators = spec.is_array() ? spec : nlohmann::json::array({spec});
+
+        std::size_t total { 0 };
+        std::vector<Spec> specs;
+        for (const nlohmann::json& generator : generators)
+        {
+            specs.push_back(parse<N>(generator, bound, chargeScale));
+            total += specs.back().count;
+        }
+        particles.reserve(particles.size() + total);
+
+        // the drawing runs in parallel into plain points, the particles are appended after it
+        std::vector<Point<N>> positions;
+        std::vector<Point3D> velocities;
+        for (std::size_t g = 0; g < specs.size(); ++g)
+        {
+            const Spec& generator { specs[g] };
+            positions.resize(generator.count);
+            velocities.resize(generator.count);
+            fill<N>(generator, seed, static_cast<std::uint32_t>(g), bound, positions, velocities);
+
+            const bool plasma { generator.type == "plasma" };
+            for (std::size_t i = 0; i < generator.count; ++i)
+            {
+                const bool electron { plasma && i % 2 == 1 };
+                particles.emplace_back(ChargedParticle<N>{electron ? -generator.charge : generator.charge, electron ? generator.electronMass : generator.mass,
+                                                          positions[i], velocities[i]});
+            }
+        }
+
+        return total;
+    };
+
+    template std::size_t generate<2>(const nlohmann::json&, const std::uint64_t&, const double&, const double&, std::vector<ChargedParticle2D>&);
+    template std::size_t generate<3>(const nlohmann::json&, const std::uint64_t&, const double&, const double&, std::vector<ChargedParticle3D>&);
+};
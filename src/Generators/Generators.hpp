@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../Constants/Constants.hpp"
+#include "../Points/Points.hpp"
+#include "../Utilities/Utilities.hpp"
+
+/*
+Initial conditions generated in the run instead of listed in the config:
+
+"seed": 42,
+"generate": [
+    {"type": "uniform", "count": 100000, "charge": -1, "mass": 1, "temperature": 0.01},
+    {"type": "gaussian", "count": 1000, "center": {"x": 0.5, "y": 0.0}, "sigma": 0.1, "charge": 1},
+    {"type": "lattice", "points": [100, 100], "charge": 1, "mass": 1836},
+    {"type": "plasma", "pairs": 50000, "charge": 1, "mass": 1836, "electron mass": 1, "ion temperature": 0.001, "electron temperature": 0.01, "separation": 0.001}
+]
+
+uniform     "count" particles uniformly in the "box" (same keys as "output box", default the domain)
+gaussian    "count" particles around "center" (default the origin) with the standard deviation "sigma" (default a tenth of the bound)
+            in every dimension, draws that land outside of the domain are drawn again
+lattice     "points" per dimension (one number for every dimension or one per dimension) at the cell centers of the "box"
+plasma      "pairs" of an ion (charge "charge", mass "mass") uniformly in the "box" and an electron (charge -"charge", mass "electron mass")
+            "separation" away from it in a random direction, so every pair is neutral
+
+Every generator takes "charge" (default 1, times the "charge scale"), "mass" (default 1), a Maxwellian velocity with the "temperature" T
+(k_B = 1: every velocity component is normal with variance T / m, vz only in 3D, plasma: "ion temperature" and "electron temperature")
+and a "drift" {"vx", "vy", "vz"} added to every velocity.
+
+Particle i of generator g always draws the same numbers for the same "seed" (a counter-based Philox stream per particle, see Philox),
+so the particles don't depend on the number of threads they are generated with.
+*/
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", 2011): a bijection of a 128-bit counter under a 64-bit key,
+// so any number of independent streams can be drawn in parallel without sharing any state
+class Philox
+{
+private:
+    std::array<std::uint32_t, 2> m_key;
+    std::array<std::uint32_t, 4> m_counter;
+    std::array<std::uint32_t, 4> m_block {};
+    std::size_t m_used { 4 }; // 32-bit words of m_block already handed out
+    double m_spare { 0. }; // second normal of the last Box-Muller pair
+    bool m_hasSpare { false };
+
+    static void round(std::array<std::uint32_t, 4>& counter, const std::array<std::uint32_t, 2>& key)
+    {
+        const std::uint64_t product0 { static_cast<std::uint64_t>(0xD2511F53u) * counter[0] };
+        const std::uint64_t product1 { static_cast<std::uint64_t>(0xCD9E8D57u) * counter[2] };
+        counter = {
+            static_cast<std::uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+            static_cast<std::uint32_t>(product1),
+            static_cast<std::uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+            static_cast<std::uint32_t>(product0),
+        };
+    }
+
+public:
+    // stream `stream` (e.g. the index of a particle) of the generator `substream` for the seed `seed`
+    Philox(const std::uint64_t& seed, const std::uint64_t& stream, const std::uint32_t& substream = 0)
+        : m_key { static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32) }
+        , m_counter { static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32), substream, 0 }
+    {
+    }
+
+    // the 128 bits of the counter `counter` under `key`
+    static std::array<std::uint32_t, 4> block(std::array<std::uint32_t, 4> counter, std::array<std::uint32_t, 2> key)
+    {
+        for (std::size_t r = 0; r < 10; ++r)
+        {
+            if (r > 0)
+            {
+                key[0] += 0x9E3779B9u;
+                key[1] += 0xBB67AE85u;
+            }
+            round(counter, key);
+        }
+        return counter;
+    }
+
+    std::uint64_t next64()
+    {
+        if (m_used == 4)
+        {
+            m_block = block(m_counter, m_key);
+            ++m_counter[3];
+            m_used = 0;
+        }
+        const std::uint64_t value { static_cast<std::uint64_t>(m_block[m_used]) << 32 | m_block[m_used + 1] };
+        m_used += 2;
+        return value;
+    }
+
+    // (0, 1], never 0 so that its logarithm is finite
+    double uniform() { return (static_cast<double>(next64() >> 11) + 1.) * 0x1p-53; }
+
+    // standard normal (Box-Muller, every other call returns the second one of the pair)
+    double normal()
+    {
+        if (m_hasSpare)
+        {
+            m_hasSpare = false;
+            return m_spare;
+        }
+        const double radius { std::sqrt(-2. * std::log(uniform())) };
+        const double angle { 2. * Constants::pi * uniform() };
+        m_spare = radius * std::sin(angle);
+        m_hasSpare = true;
+        return radius * std::cos(angle);
+    }
+};
+
+namespace Generators
+{
+    // appends the particles of every generator in `spec` (an object or a list of them, see above) and returns how many there are
+    template <std::size_t N>
+    std::size_t generate(const nlohmann::json& spec, const std::uint64_t& seed, const double& bound, const double& chargeScale,
+                         std::vector<ChargedParticle<N>>& particles);
+};
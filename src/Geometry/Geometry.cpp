@@ -1,90 +1,56 @@
 #include "Geometry.hpp"
 
-Geometry::Geometry(const std::size_t& dim, const double& bound, const std::size_t& numPoints) : m_dim{dim}, m_bound{bound}, m_numPoints{numPoints}
+template <std::size_t N>
+Geometry<N>::Geometry(const double& bound, const std::size_t& numPoints) : m_bound{bound}, m_numPoints{numPoints}
 {
-    checkDomainDimension(m_dim);
-    
-    // Create a grid of points (either 2D or 3D)
+    // Create a grid of points
     constructWorld();
 };
 
-int Geometry::checkDomainDimension(const std::size_t& dim)
+template <std::size_t N>
+std::size_t Geometry<N>::numGridPoints() const
 {
-    if (dim != 2 && dim != 3)
-    {
-        std::cerr << "Currently only implemented for 2D and 3D domains." << std::endl;
-        return -1;
-    }
-
-    return 0;
+    std::size_t numGridPoints { 1 };
+    for (std::size_t d = 0; d < N; ++d) { numGridPoints *= m_axis.size(); }
+    return numGridPoints;
 };
 
-void Geometry::constructWorld()
+template <std::size_t N>
+void Geometry<N>::constructWorld()
 {
-    if (m_dim == 2)
+    std::cout << "Constructing " << N << "D world..." << std::endl;
+
+    const std::size_t numNodes { m_numPoints + 1 };
+    double dx = 2*m_bound / static_cast<double>(m_numPoints);
+    m_axis.resize(numNodes);
+    for (std::size_t i = 0; i < numNodes; ++i)
     {
-        std::cout << "Constructing 2D world..." << std::endl;
-        std::vector<Point2D>& grid {std::get<std::vector<Point2D>>(m_grid)};
-        grid.reserve(m_numPoints * m_numPoints);
-        double dx = 2*m_bound / static_cast<double>(m_numPoints);
-        for (std::size_t i = 0; i < m_numPoints+1; ++i)
-        {
-            for (std::size_t j = 0; j < m_numPoints+1; ++j)
-            {
-                grid.emplace_back(Point2D(-m_bound + static_cast<double>(i)*dx, -m_bound + static_cast<double>(j)*dx));
-            }
-        }
+        m_axis[i] = -m_bound + static_cast<double>(i)*dx;
     }
-    else if (m_dim == 3)
+
+    if constexpr (N == 2)
     {
-        std::cout << "Constructing 3D world..." << std::endl;
-        std::vector<Point3D>& grid {std::get<std::vector<Point3D>>(m_grid)};
-        grid.reserve(m_numPoints * m_numPoints * m_numPoints);
-        double dx = 2*m_bound / static_cast<double>(m_numPoints);
-        for (std::size_t i = 0; i < m_numPoints+1; ++i)
+        m_grid.clear();
+        m_grid.reserve(numNodes * numNodes);
+        for (std::size_t i = 0; i < numNodes; ++i)
         {
-            for (std::size_t j = 0; j < m_numPoints+1; ++j)
+            for (std::size_t j = 0; j < numNodes; ++j)
             {
-                for (std::size_t k = 0; k < m_numPoints+1; ++k)
-                {
-                    grid.emplace_back(Point3D(-m_bound + static_cast<double>(i)*dx, -m_bound + static_cast<double>(j)*dx, -m_bound + static_cast<double>(k)*dx));
-                }
+                m_grid.emplace_back(Point2D(m_axis[i], m_axis[j]));
             }
         }
-    }
-    // Don't need an else statement since checkDomainDimension() should catch any other cases
-};
-
-void Geometry::writeGrid(const std::string& filename, const std::string ext, const std::string delimiter)
-{
-    // Currently for macOS, will change to $HOME for Linux
-    std::ofstream file("/Users/max/ClassicalEM++/outputs/" + filename + "." + ext);
 
-    // ensure file is open for writing (needs to caught in a try catch block)
-    if (!file.is_open()) {
-        throw std::ios_base::failure("Failed to open file for writing");
-    }
-    
-    // do not write headers for now
-    // file << 'x' << delimiter << 'y' << '\n';
-    if (m_dim == 2)
-    {
-        const std::vector<Point2D> grid = std::get<std::vector<Point2D>>(m_grid);
-        for (const Point2D& point : grid)
-        {
-            file << point.x() << delimiter << point.y() << std::endl;
-        }
-    }
-    else if (m_dim == 3)
-    {
-        const std::vector<Point3D> grid = std::get<std::vector<Point3D>>(m_grid);
-        for (const Point3D& point : grid)
+        for (std::size_t d = 0; d < N; ++d)
         {
-            file << point.x() << delimiter << point.y() << delimiter << point.z() << std::endl;
+            m_coordinates[d].clear();
+            m_coordinates[d].reserve(m_grid.size());
+            for (const Point<N>& point : m_grid)
+            {
+                m_coordinates[d].push_back(point[d]);
+            }
         }
     }
-    else
-    {
-        std::cerr << "Error: Dimension not supported." << std::endl;
-    }
 };
+
+template class Geometry<2>;
+template class Geometry<3>;
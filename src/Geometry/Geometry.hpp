@@ -1,37 +1,49 @@
 #pragma once
 
+#include <array>
 #include <iostream>
 #include <cmath>
 #include <vector>
-#include <variant>
 #include <fstream>
 #include <string>
 
 #include "../Points/Points.hpp"
+#include "../Fields/Fields.hpp"
 
 // Currently only implemented for square and cube world volumes
+// The dimension is a template parameter (Geometry<2>, Geometry<3>), so nothing branches on it at runtime
 
+template <std::size_t N>
 class Geometry
 {
+    static_assert(N == 2 || N == 3, "Currently only implemented for 2D and 3D domains.");
+
 private:
-    const std::size_t& m_dim;
-    const double& m_bound; // maximum value of x and y (and z if applicable)
-    const std::size_t& m_numPoints; // number of points (minus 1) in each dimension (should be even integer if you want origin centered in domain)
-    
-    // only one of these will be used
-    std::variant<std::vector<Point2D>, std::vector<Point3D>> m_grid;
+    const double m_bound; // maximum value of x and y (and z if applicable)
+    const std::size_t m_numPoints; // number of points (minus 1) in each dimension (should be even integer if you want origin centered in domain)
+
+    // numPoints+1 node coordinates, the same along every dimension
+    AlignedVector m_axis;
+
+    // 2D only: the (numPoints+1)^2 points (the last coordinate runs fastest) and their coordinates again as aligned
+    // structure-of-arrays, for the vectorized field kernels. A 3D grid is never stored point by point
+    // (201^3 points would be 8M points per array), the 3D kernels work from the axis.
+    std::vector<Point<N>> m_grid;
+    std::array<AlignedVector, N> m_coordinates;
 
 public:
-    Geometry(const std::size_t& dim, const double& bound, const std::size_t& numPoints);
+    static constexpr std::size_t dim { N };
+
+    Geometry(const double& bound, const std::size_t& numPoints);
 
     // Getters
-    // std::size_t dim() const { return m_dim; }
     double bound() const { return m_bound; }
     std::size_t numPoints() const { return m_numPoints; }
-    const std::vector<Point2D>& grid2D() const { return std::get<std::vector<Point2D>>(m_grid); }
-    const std::vector<Point3D>& grid3D() const { return std::get<std::vector<Point3D>>(m_grid); }
+    std::size_t numGridPoints() const;
+    const AlignedVector& axis() const { return m_axis; }
+    const std::vector<Point<N>>& grid() const requires (N == 2) { return m_grid; }
+    const AlignedVector& gridX() const requires (N == 2) { return m_coordinates[0]; }
+    const AlignedVector& gridY() const requires (N == 2) { return m_coordinates[1]; }
 
-    int checkDomainDimension(const std::size_t& dim);
     void constructWorld();
-    void writeGrid(const std::string& filename, const std::string ext="txt", const std::string delimiter=",");
 };
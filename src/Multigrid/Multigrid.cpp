@@ -0,0 +1,576 @@
+#include "Multigrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+#include "../Constants/Constants.hpp"
+#include "../ParticleMesh/ParticleMesh.hpp"
+
+namespace
+{
+    constexpr std::size_t s_preSweeps { 2 };
+    constexpr std::size_t s_postSweeps { 2 };
+    constexpr std::size_t s_minCoarseIntervals { 4 }; // a grid is only halved if the coarse one keeps at least this many intervals
+    constexpr double s_coarsestReduction { 1e-3 }; // of the coarsest grid's residual per V-cycle
+
+    const std::vector<double> s_noPotential;
+};
+
+Multigrid::Multigrid(const Utilities::Config& config)
+    : m_config {config}
+    , m_enabled {config.forceSolver == Utilities::ForceSolver::multigrid && config.dim == 2}
+{
+    if (!m_enabled) { return; }
+
+    buildLevels();
+    markFixed();
+};
+
+void Multigrid::buildLevels()
+{
+    std::size_t intervals { std::max<std::size_t>(m_config.numPoints, 1) };
+    while (true)
+    {
+        Level level;
+        level.size = m_config.periodic ? intervals : intervals + 1;
+        level.spacing = 2 * m_config.bound / static_cast<double>(intervals);
+
+        const std::size_t numNodes { level.size * level.size };
+        level.potential.assign(numNodes, 0.);
+        level.source.assign(numNodes, 0.);
+        level.residual.assign(numNodes, 0.);
+        level.fixed.assign(numNodes, 0);
+        m_levels.push_back(std::move(level));
+
+        if (intervals % 2 != 0 || intervals / 2 < s_minCoarseIntervals) { break; }
+        intervals /= 2;
+    }
+
+    const std::size_t numNodes { m_levels[0].size * m_levels[0].size };
+    m_rowSums.assign(m_levels[0].size, 0.);
+    m_Ex.assign(numNodes, 0.);
+    m_Ey.assign(numNodes, 0.);
+};
+
+void Multigrid::markFixed()
+{
+    Level& finest { m_levels[0] };
+    const std::size_t M { finest.size };
+    const double bound { m_config.bound };
+
+    // the walls (a conductor that reaches a wall holds those nodes at its own potential)
+    if (!m_config.periodic && m_config.boundary == Utilities::Boundary::dirichlet)
+    {
+        for (std::size_t i = 0; i < M; ++i)
+        {
+            for (std::size_t j = 0; j < M; ++j)
+            {
+                if (i == 0 || j == 0 || i == M - 1 || j == M - 1)
+                {
+                    finest.fixed[i*M + j] = 1;
+                    finest.potential[i*M + j] = m_config.boundaryPotential;
+                }
+            }
+        }
+    }
+
+    for (std::size_t c = 0; c < m_config.conductors.size(); ++c)
+    {
+        const Utilities::Conductor& conductor { m_config.conductors[c] };
+        std::size_t covered { 0 };
+        for (std::size_t i = 0; i < M; ++i)
+        {
+            const double x { -bound + static_cast<double>(i) * finest.spacing };
+            for (std::size_t j = 0; j < M; ++j)
+            {
+                const double y { -bound + static_cast<double>(j) * finest.spacing };
+                const bool inside { conductor.radius > 0.
+                    ? (x - conductor.x) * (x - conductor.x) + (y - conductor.y) * (y - conductor.y) <= conductor.radius * conductor.radius
+                    : x >= conductor.box.xMin && x <= conductor.box.xMax && y >= conductor.box.yMin && y <= conductor.box.yMax };
+                if (!inside) { continue; }
+
+                finest.fixed[i*M + j] = 1;
+                finest.potential[i*M + j] = conductor.potential;
+                ++covered;
+            }
+        }
+
+        if (covered == 0)
+        {
+            std::cerr << "Conductor " << c << " covers no grid point (make it larger than the grid spacing " << finest.spacing << ")! It has no effect..." << std::endl;
+        }
+    }
+
+    m_singular = std::find(finest.fixed.begin(), finest.fixed.end(), std::uint8_t {1}) == finest.fixed.end();
+
+    // a coarse node is fixed where the fine node at the same place is
+    for (std::size_t l = 1; l < m_levels.size(); ++l)
+    {
+        const Level& fine { m_levels[l - 1] };
+        Level& coarse { m_levels[l] };
+        for (std::size_t I = 0; I < coarse.size; ++I)
+        {
+            for (std::size_t J = 0; J < coarse.size; ++J) { coarse.fixed[I*coarse.size + J] = fine.fixed[2*I*fine.size + 2*J]; }
+        }
+    }
+};
+
+std::size_t Multigrid::lower(const Level& level, const std::size_t& i) const
+{
+    if (i > 0) { return i - 1; }
+    return m_config.periodic ? level.size - 1 : 1;
+};
+
+std::size_t Multigrid::upper(const Level& level, const std::size_t& i) const
+{
+    if (i + 1 < level.size) { return i + 1; }
+    return m_config.periodic ? 0 : level.size - 2;
+};
+
+std::size_t Multigrid::assignmentWeights(const double& coordinate, std::size_t (&nodes)[3], double (&weights)[3]) const
+{
+    const Level& finest { m_levels[0] };
+    long first { 0 };
+    const std::size_t count { assignmentStencil(m_config.assignment, (coordinate + m_config.bound) / finest.spacing, first, weights) };
+
+    const long size { static_cast<long>(finest.size) };
+    for (std::size_t k = 0; k < count; ++k)
+    {
+        long idx { first + static_cast<long>(k) };
+        // periodic: wrap around, walls: anything past the edge of the grid is piled onto the edge node
+        idx = m_config.periodic ? ((idx % size) + size) % size : std::clamp(idx, 0L, size - 1);
+        nodes[k] = static_cast<std::size_t>(idx);
+    }
+
+    return count;
+};
+
+void Multigrid::deposit(const std::vector<ChargedParticle2D>& particles)
+{
+    Level& finest { m_levels[0] };
+    const std::size_t M { finest.size };
+    const double scale { 4 * Constants::pi / (finest.spacing * finest.spacing) };
+
+    std::fill(finest.source.begin(), finest.source.end(), 0.);
+    for (const ChargedParticle2D& particle : particles)
+    {
+        std::size_t nodesX[3], nodesY[3];
+        double weightsX[3], weightsY[3];
+        const std::size_t count { assignmentWeights(particle.position.x(), nodesX, weightsX) };
+        assignmentWeights(particle.position.y(), nodesY, weightsY);
+
+        for (std::size_t a = 0; a < count; ++a)
+        {
+            for (std::size_t b = 0; b < count; ++b)
+            {
+                finest.source[nodesX[a] * M + nodesY[b]] += scale * particle.charge * weightsX[a] * weightsY[b];
+            }
+        }
+    }
+};
+
+void Multigrid::smooth(Level& level, const std::size_t& sweeps)
+{
+    const std::size_t M { level.size };
+    const double h2 { level.spacing * level.spacing };
+
+    // relaxes the nodes of one colour in row i
+    const auto relaxRow = [&](const std::size_t& i, const std::size_t& colour)
+    {
+        const std::size_t il { lower(level, i) };
+        const std::size_t iu { upper(level, i) };
+        for (std::size_t j = (i + colour) % 2; j < M; j += 2)
+        {
+            const std::size_t node { i*M + j };
+            if (level.fixed[node]) { continue; }
+
+            const double neighbours { level.potential[il*M + j] + level.potential[iu*M + j]
+                                    + level.potential[i*M + lower(level, j)] + level.potential[i*M + upper(level, j)] };
+            level.potential[node] = 0.25 * (neighbours + h2 * level.source[node]);
+        }
+    };
+
+    // a node only reads nodes of the other colour, so the rows of one colour can be relaxed in any order, except across
+    // the wrap of a periodic grid with an odd number of nodes: rows 0 and M-1 have the same colour there, so the last row
+    // is relaxed after the others (within a row the nodes are visited in order, so the column wrap is no race)
+    const std::size_t parallelRows { (m_config.periodic && M % 2 != 0) ? M - 1 : M };
+
+    for (std::size_t sweep = 0; sweep < sweeps; ++sweep)
+    {
+        for (std::size_t colour = 0; colour < 2; ++colour)
+        {
+            #pragma omp parallel for schedule(static)
+            for (std::size_t i = 0; i < parallelRows; ++i) { relaxRow(i, colour); }
+
+            for (std::size_t i = parallelRows; i < M; ++i) { relaxRow(i, colour); }
+        }
+    }
+};
+
+double Multigrid::computeResidual(Level& level, const bool& cold)
+{
+    const std::size_t M { level.size };
+    const double inverseH2 { 1. / (level.spacing * level.spacing) };
+
+    // the potential a cold start would begin with
+    const auto potential = [&](const std::size_t& node) { return (!cold || level.fixed[node]) ? level.potential[node] : 0.; };
+
+    #pragma omp parallel for schedule(static)
+    for (std::size_t i = 0; i < M; ++i)
+    {
+        const std::size_t il { lower(level, i) };
+        const std::size_t iu { upper(level, i) };
+        double sum { 0. };
+        for (std::size_t j = 0; j < M; ++j)
+        {
+            const std::size_t node { i*M + j };
+            if (level.fixed[node])
+            {
+                level.residual[node] = 0.;
+                continue;
+            }
+
+            const double laplacian { (potential(il*M + j) + potential(iu*M + j) + potential(i*M + lower(level, j)) + potential(i*M + upper(level, j))
+                                      - 4 * potential(node)) * inverseH2 };
+            const double residual { level.source[node] + laplacian };
+            level.residual[node] = residual;
+            sum += residual * residual;
+        }
+        m_rowSums[i] = sum;
+    }
+
+    double sum { 0. };
+    for (std::size_t i = 0; i < M; ++i) { sum += m_rowSums[i]; }
+    return std::sqrt(sum);
+};
+
+void Multigrid::restrictResidual(const Level& fine, Level& coarse)
+{
+    const std::size_t M { fine.size };
+    const std::size_t C { coarse.size };
+
+    #pragma omp parallel for schedule(static)
+    for (std::size_t I = 0; I < C; ++I)
+    {
+        const std::size_t i { 2 * I };
+        const std::size_t rows[3] { lower(fine, i), i, upper(fine, i) };
+        for (std::size_t J = 0; J < C; ++J)
+        {
+            if (coarse.fixed[I*C + J])
+            {
+                coarse.source[I*C + J] = 0.;
+                continue;
+            }
+
+            // 1/16 [1 2 1; 2 4 2; 1 2 1] around the fine node at the same place
+            const std::size_t j { 2 * J };
+            const std::size_t columns[3] { lower(fine, j), j, upper(fine, j) };
+            constexpr double weights[3] { 0.25, 0.5, 0.25 };
+            double sum { 0. };
+            for (std::size_t a = 0; a < 3; ++a)
+            {
+                for (std::size_t b = 0; b < 3; ++b) { sum += weights[a] * weights[b] * fine.residual[rows[a]*M + columns[b]]; }
+            }
+            coarse.source[I*C + J] = sum;
+        }
+    }
+};
+
+void Multigrid::prolongate(const Level& coarse, Level& fine)
+{
+    const std::size_t M { fine.size };
+    const std::size_t C { coarse.size };
+
+    // an even fine node sits on a coarse node, an odd one halfway between two
+    const auto stencil = [&](const std::size_t& i, std::size_t (&nodes)[2], double (&weights)[2])
+    {
+        nodes[0] = i / 2;
+        if (i % 2 == 0)
+        {
+            weights[0] = 1.;
+            return std::size_t {1};
+        }
+        nodes[1] = (i / 2 + 1) % C;
+        weights[0] = 0.5;
+        weights[1] = 0.5;
+        return std::size_t {2};
+    };
+
+    #pragma omp parallel for schedule(static)
+    for (std::size_t i = 0; i < M; ++i)
+    {
+        std::size_t rows[2];
+        double rowWeights[2];
+        const std::size_t numRows { stencil(i, rows, rowWeights) };
+        for (std::size_t j = 0; j < M; ++j)
+        {
+            if (fine.fixed[i*M + j]) { continue; }
+
+            std::size_t columns[2];
+            double columnWeights[2];
+            const std::size_t numColumns { stencil(j, columns, columnWeights) };
+            double correction { 0. };
+            for (std::size_t a = 0; a < numRows; ++a)
+            {
+                for (std::size_t b = 0; b < numColumns; ++b) { correction += rowWeights[a] * columnWeights[b] * coarse.potential[rows[a]*C + columns[b]]; }
+            }
+            fine.potential[i*M + j] += correction;
+        }
+    }
+};
+
+double Multigrid::mean(const Level& level, const std::vector<double>& values)
+{
+    const std::size_t M { level.size };
+    // the mirrored walls count half (the constant that is added to the source must not change the flux through them)
+    const auto weight = [&](const std::size_t& i) { return (!m_config.periodic && (i == 0 || i == M - 1)) ? 0.5 : 1.; };
+
+    double sum { 0. };
+    double total { 0. };
+    for (std::size_t i = 0; i < M; ++i)
+    {
+        for (std::size_t j = 0; j < M; ++j)
+        {
+            sum += weight(i) * weight(j) * values[i*M + j];
+            total += weight(i) * weight(j);
+        }
+    }
+    return sum / total;
+};
+
+void Multigrid::solveCoarsest(Level& level)
+{
+    const std::size_t M { level.size };
+    const double h2 { level.spacing * level.spacing };
+
+    if (m_singular)
+    {
+        const double offset { mean(level, level.source) };
+        for (double& value : level.source) { value -= offset; }
+    }
+
+    // lexicographic SOR with the factor of the model problem (serial, the coarsest grid is small)
+    const double intervals { static_cast<double>(m_config.periodic ? M : M - 1) };
+    const double omega { 2. / (1. + std::sin(Constants::pi / intervals)) };
+    const std::size_t maxSweeps { std::max<std::size_t>(100, 20 * M) };
+    const std::size_t checkEvery { 10 };
+
+    const double initial { computeResidual(level) };
+    for (std::size_t sweep = 0; sweep < maxSweeps; ++sweep)
+    {
+        for (std::size_t i = 0; i < M; ++i)
+        {
+            const std::size_t il { lower(level, i) };
+            const std::size_t iu { upper(level, i) };
+            for (std::size_t j = 0; j < M; ++j)
+            {
+                const std::size_t node { i*M + j };
+                if (level.fixed[node]) { continue; }
+
+                const double neighbours { level.potential[il*M + j] + level.potential[iu*M + j]
+                                        + level.potential[i*M + lower(level, j)] + level.potential[i*M + upper(level, j)] };
+                const double relaxed { 0.25 * (neighbours + h2 * level.source[node]) };
+                level.potential[node] += omega * (relaxed - level.potential[node]);
+            }
+        }
+
+        if ((sweep + 1) % checkEvery == 0 && computeResidual(level) <= s_coarsestReduction * initial) { break; }
+    }
+};
+
+void Multigrid::vCycle(const std::size_t& l)
+{
+    Level& level { m_levels[l] };
+    if (l + 1 == m_levels.size())
+    {
+        solveCoarsest(level);
+        return;
+    }
+
+    Level& coarse { m_levels[l + 1] };
+    smooth(level, s_preSweeps);
+    computeResidual(level);
+    restrictResidual(level, coarse);
+    std::fill(coarse.potential.begin(), coarse.potential.end(), 0.);
+    vCycle(l + 1);
+    prolongate(coarse, level);
+    smooth(level, s_postSweeps);
+};
+
+void Multigrid::calculateGradient()
+{
+    const Level& finest { m_levels[0] };
+    const std::size_t M { finest.size };
+
+    // neighbours along one dimension and the distance between them (central differences, one-sided on a wall)
+    const auto neighbours = [&](const std::size_t& i, std::size_t& il, std::size_t& iu, double& distance)
+    {
+        if (m_config.periodic)
+        {
+            il = lower(finest, i);
+            iu = upper(finest, i);
+            distance = 2 * finest.spacing;
+        }
+        else
+        {
+            il = (i == 0) ? 0 : i - 1;
+            iu = (i == M - 1) ? M - 1 : i + 1;
+            distance = static_cast<double>(iu - il) * finest.spacing;
+        }
+    };
+
+    #pragma omp parallel for schedule(static)
+    for (std::size_t i = 0; i < M; ++i)
+    {
+        std::size_t il, iu;
+        double dx;
+        neighbours(i, il, iu, dx);
+
+        for (std::size_t j = 0; j < M; ++j)
+        {
+            std::size_t jl, ju;
+            double dy;
+            neighbours(j, jl, ju, dy);
+
+            m_Ex[i*M + j] = -(finest.potential[iu*M + j] - finest.potential[il*M + j]) / dx;
+            m_Ey[i*M + j] = -(finest.potential[i*M + ju] - finest.potential[i*M + jl]) / dy;
+        }
+    }
+};
+
+void Multigrid::solve(const std::vector<ChargedParticle2D>& particles)
+{
+    if (!m_enabled) { return; }
+
+    Level& finest { m_levels[0] };
+    deposit(particles);
+    if (m_singular)
+    {
+        // the uniform background that cancels the net charge
+        const double offset { mean(finest, finest.source) };
+        for (double& value : finest.source) { value -= offset; }
+    }
+
+    // the potential left by the last solve is the first guess
+    const double reference { computeResidual(finest, true) };
+    double norm { computeResidual(finest) };
+    m_cycles = 0;
+    if (reference == 0.)
+    {
+        // no charge and every fixed node at zero
+        for (std::size_t node = 0; node < finest.potential.size(); ++node)
+        {
+            if (!finest.fixed[node]) { finest.potential[node] = 0.; }
+        }
+        norm = 0.;
+    }
+    while (norm > m_config.multigridTolerance * reference && m_cycles < m_config.multigridCycles)
+    {
+        vCycle(0);
+        ++m_cycles;
+        norm = computeResidual(finest);
+    }
+
+    if (m_singular)
+    {
+        const double offset { mean(finest, finest.potential) };
+        for (double& value : finest.potential) { value -= offset; }
+    }
+
+    m_residual = reference > 0. ? norm / reference : 0.;
+    ++m_numSolves;
+    m_totalCycles += m_cycles;
+
+    calculateGradient();
+};
+
+void Multigrid::fillField(FieldStore2D& field) const
+{
+    const std::size_t numPoints { m_config.numPoints };
+    field.resize((numPoints + 1) * (numPoints + 1));
+    if (!m_enabled) { return; }
+
+    const std::size_t M { m_levels[0].size };
+
+    #pragma omp parallel for schedule(static)
+    for (std::size_t i = 0; i < numPoints + 1; ++i)
+    {
+        for (std::size_t j = 0; j < numPoints + 1; ++j)
+        {
+            // when periodic the last grid point is the first node again
+            const std::size_t node { (i % M) * M + (j % M) };
+            const double magnitude { std::sqrt(m_Ex[node]*m_Ex[node] + m_Ey[node]*m_Ey[node]) };
+
+            const std::size_t idx { i * (numPoints + 1) + j };
+            field.magnitude[idx] = magnitude;
+            field.x[idx] = magnitude > 0. ? m_Ex[node] / magnitude : 0.;
+            field.y[idx] = magnitude > 0. ? m_Ey[node] / magnitude : 0.;
+        }
+    }
+};
+
+std::vector<Point2D> Multigrid::calculateAcceleration(const std::vector<ChargedParticle2D>& particles) const
+{
+    std::vector<Point2D> acceleration(particles.size(), Point2D{ 0.0, 0.0 });
+    if (!m_enabled) { return acceleration; }
+
+    const std::size_t M { m_levels[0].size };
+
+    #pragma omp parallel for schedule(static)
+    for (std::size_t p = 0; p < particles.size(); ++p)
+    {
+        std::size_t nodesX[3], nodesY[3];
+        double weightsX[3], weightsY[3];
+        const std::size_t count { assignmentWeights(particles[p].position.x(), nodesX, weightsX) };
+        assignmentWeights(particles[p].position.y(), nodesY, weightsY);
+
+        double Ex { 0. };
+        double Ey { 0. };
+        for (std::size_t a = 0; a < count; ++a)
+        {
+            for (std::size_t b = 0; b < count; ++b)
+            {
+                const std::size_t node { nodesX[a] * M + nodesY[b] };
+                Ex += weightsX[a] * weightsY[b] * m_Ex[node];
+                Ey += weightsX[a] * weightsY[b] * m_Ey[node];
+            }
+        }
+
+        const double qm { particles[p].charge / particles[p].mass };
+        acceleration[p] = Point2D { qm * Ex, qm * Ey };
+    }
+
+    return acceleration;
+};
+
+void Multigrid::setPotential(const std::vector<double>& potential)
+{
+    if (!m_enabled) { return; }
+
+    if (potential.size() != m_levels[0].potential.size())
+    {
+        std::cerr << "The checkpoint's potential does not fit the grid! Starting the multigrid solver cold..." << std::endl;
+        return;
+    }
+    m_levels[0].potential = potential;
+};
+
+const std::vector<double>& Multigrid::potential() const
+{
+    return m_enabled ? m_levels[0].potential : s_noPotential;
+};
+
+void Multigrid::report(std::ostream& out) const
+{
+    if (!m_enabled) { return; }
+
+    out << "multigrid: " << m_levels.size() << " level(s) from " << m_levels.front().size << "^2 to " << m_levels.back().size << "^2 nodes";
+    if (m_numSolves > 0)
+    {
+        out << ", " << m_numSolves << " solves with " << std::fixed << std::setprecision(2) << static_cast<double>(m_totalCycles) / static_cast<double>(m_numSolves)
+            << " V-cycles each on average (last residual " << std::scientific << std::setprecision(2) << m_residual << ")" << std::defaultfloat;
+    }
+    out << std::endl;
+};
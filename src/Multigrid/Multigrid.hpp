@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "../Fields/Fields.hpp"
+#include "../Points/Points.hpp"
+#include "../Utilities/Utilities.hpp"
+
+/*
+Geometric multigrid Poisson solver on the Geometry grid ("force solver": "multigrid", 2D):
+
+    -laplace(potential) = 4 pi rho    with the potential held fixed on the conductors and (unless "neumann" or periodic) the walls
+
+1. deposit the particle charges onto the grid nodes (same assignment as the particle-mesh solver, rho = charge / spacing^2)
+2. V-cycles from the potential of the previous solve (warm start, a step only moves the particles a little, so a solve usually
+   takes one or two cycles instead of the ~log(1 / tolerance) of a cold start) until the residual is "multigrid tolerance" times
+   the one of a zero potential, at most "multigrid cycles" of them
+3. E = -grad(potential) by central differences, interpolated back to the particles with the assignment weights
+
+A V-cycle smooths with red-black Gauss-Seidel (2 sweeps before and after), restricts the residual by full weighting to a grid with
+half the intervals and adds the bilinear interpolation of the coarse correction. The grid is halved while the number of intervals is
+even and at least 8 (a numPoints with many factors of two gives more levels and faster cycles), the coarsest grid is solved by SOR.
+The sweeps, restrictions and interpolations run over the rows in parallel, the deposit is serial: every step is independent of the
+thread count, so a run is bit for bit the same for any number of threads. A conductor is the set of grid nodes inside its box or
+circle, a coarse grid node is fixed when the fine node at the same place is.
+
+Unlike the other solvers, whose 2D particles are point charges (E = q / r^2), the 2D Poisson equation makes each particle a line
+charge along z (E = 2 q / r), the fields of the conductors and walls are those of infinitely long electrodes. Without any fixed node
+(periodic, or neumann walls without conductors) the potential is only defined up to a constant: a uniform background cancels the
+net charge and the potential has zero mean.
+*/
+
+// Poisson solver for the grid potential of the particles, the conductors and the walls, warm started from its last solution.
+class Multigrid
+{
+private:
+    // one grid of the hierarchy (level 0 is the Geometry grid)
+    struct Level
+    {
+        std::size_t size; // nodes per side (numPoints + 1, numPoints if periodic)
+        double spacing;
+        std::vector<double> potential; // level 0: the potential, coarser: the correction
+        std::vector<double> source; // right hand side f of -laplace(potential) = f
+        std::vector<double> residual;
+        std::vector<std::uint8_t> fixed; // nodes whose potential (level 0) or correction (coarser) is held
+    };
+
+    const Utilities::Config& m_config;
+    bool m_enabled;
+    bool m_singular { false }; // no fixed node
+    std::vector<Level> m_levels;
+    std::vector<double> m_rowSums; // per-row partial sums of a norm or mean (summed in row order)
+    std::vector<double> m_Ex;
+    std::vector<double> m_Ey;
+
+    // of the last solve and the run
+    std::size_t m_cycles { 0 };
+    double m_residual { 0. }; // relative
+    std::size_t m_numSolves { 0 };
+    std::size_t m_totalCycles { 0 };
+
+    void buildLevels();
+    void markFixed();
+
+    // neighbours of node i along one dimension (mirrored at a wall, which is only read for neumann walls)
+    std::size_t lower(const Level& level, const std::size_t& i) const;
+    std::size_t upper(const Level& level, const std::size_t& i) const;
+
+    void deposit(const std::vector<ChargedParticle2D>& particles);
+    // red-black Gauss-Seidel sweeps
+    void smooth(Level& level, const std::size_t& sweeps);
+    // residual of `level` into level.residual, returns its L2 norm (`cold`: of a zero potential except for the fixed nodes)
+    double computeResidual(Level& level, const bool& cold = false);
+    // full weighting of the fine residual into the coarse source
+    void restrictResidual(const Level& fine, Level& coarse);
+    // adds the bilinear interpolation of the coarse correction to the fine potential
+    void prolongate(const Level& coarse, Level& fine);
+    void solveCoarsest(Level& level);
+    void vCycle(const std::size_t& l);
+    // weighted mean of `values` over the nodes (trapezoid weights at neumann walls), the compatible constant of a singular problem
+    double mean(const Level& level, const std::vector<double>& values);
+    void calculateGradient();
+
+    // nodes (up to 3 per dimension) and weights that a particle at `coordinate` is spread over
+    std::size_t assignmentWeights(const double& coordinate, std::size_t (&nodes)[3], double (&weights)[3]) const;
+
+public:
+    explicit Multigrid(const Utilities::Config& config);
+
+    Multigrid(const Multigrid&) = delete;
+    Multigrid& operator=(const Multigrid&) = delete;
+
+    // deposit + V-cycles from the last potential + gradient for the current particle positions
+    void solve(const std::vector<ChargedParticle2D>& particles);
+
+    // copies the solved electric field onto every Geometry grid point (same ordering as Geometry<2>::grid)
+    void fillField(FieldStore2D& field) const;
+
+    // E interpolated back to each particle, times charge/mass
+    std::vector<Point2D> calculateAcceleration(const std::vector<ChargedParticle2D>& particles) const;
+
+    // the warm start of a restarted run (ignored if it does not fit the grid)
+    void setPotential(const std::vector<double>& potential);
+
+    void report(std::ostream& out) const;
+
+    // Getters
+    bool enabled() const { return m_enabled; }
+    const std::vector<double>& potential() const;
+    std::size_t numLevels() const { return m_levels.size(); }
+    std::size_t cycles() const { return m_cycles; }
+    double residual() const { return m_residual; }
+};
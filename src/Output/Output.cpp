@@ -0,0 +1,471 @@
+#include "Output.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace
+{
+    template <typename T>
+    void append(std::vector<char>& buffer, const T& value)
+    {
+        const char* bytes { reinterpret_cast<const char*>(&value) };
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    };
+};
+
+FrameWriter::~FrameWriter()
+{
+    close();
+};
+
+std::vector<char> FrameWriter::header(const std::size_t& dim, const std::vector<std::size_t>& shape, const double& bound,
+                                      const std::vector<std::string>& fieldNames, const std::vector<std::string>& staticFieldNames, const bool& compress)
+{
+    m_compress = compress;
+    m_dim = dim;
+    m_numGridPoints = 1;
+    for (const std::size_t& points : shape) { m_numGridPoints *= points; }
+    m_numFields = fieldNames.size();
+
+    std::vector<char> header;
+    header.insert(header.end(), {'C', 'E', 'M', 'F', 'R', 'A', 'M', 'E'});
+    append<std::uint32_t>(header, s_version);
+    append<std::uint32_t>(header, compress ? 1u : 0u);
+    append<std::uint32_t>(header, static_cast<std::uint32_t>(dim));
+    append<std::uint32_t>(header, static_cast<std::uint32_t>(m_numFields));
+    append<std::uint64_t>(header, static_cast<std::uint64_t>(shape[0]));
+    append<double>(header, bound);
+    append<std::uint32_t>(header, static_cast<std::uint32_t>(staticFieldNames.size()));
+    append<std::uint32_t>(header, static_cast<std::uint32_t>(shape[1]));
+    append<std::uint32_t>(header, static_cast<std::uint32_t>(dim == 3 ? shape[2] : 0));
+    header.resize(64, '\0');
+
+    for (const std::vector<std::string>* names : {&fieldNames, &staticFieldNames})
+    {
+        for (const std::string& name : *names)
+        {
+            char padded[8] {};
+            std::memcpy(padded, name.data(), std::min<std::size_t>(name.size(), sizeof(padded)));
+            header.insert(header.end(), padded, padded + sizeof(padded));
+        }
+    }
+
+    return header;
+};
+
+void FrameWriter::open(const std::string& path, const std::size_t& dim, const std::vector<std::size_t>& shape, const double& bound,
+                       const std::vector<const AlignedVector*>& grid,
+                       const std::vector<std::string>& fieldNames,
+                       const std::vector<std::string>& staticFieldNames, const std::vector<const AlignedVector*>& staticComponents,
+                       const bool& compress)
+{
+    close();
+
+    if ((dim != 2 && dim != 3) || shape.size() != dim || grid.size() != dim || staticComponents.size() != staticFieldNames.size() * (1 + dim))
+    {
+        throw std::length_error("Grid or static fields do not match the run file!");
+    }
+
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+    m_file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open())
+    {
+        throw std::ios_base::failure("Failed to open file for writing: " + path);
+    }
+
+    m_path = path;
+    m_bytesWritten = 0;
+    const std::vector<char> header { this->header(dim, shape, bound, fieldNames, staticFieldNames, compress) };
+
+    m_file.write(header.data(), static_cast<std::streamsize>(header.size()));
+    m_bytesWritten += header.size();
+
+    // static section, written straight from the arrays
+    const std::streamsize componentBytes { static_cast<std::streamsize>(m_numGridPoints * sizeof(double)) };
+    std::vector<const AlignedVector*> components { grid };
+    components.insert(components.end(), staticComponents.begin(), staticComponents.end());
+
+    for (const AlignedVector* component : components)
+    {
+        if (component->size() != m_numGridPoints)
+        {
+            throw std::length_error("Field size does not match the grid of the run file!");
+        }
+        m_file.write(reinterpret_cast<const char*>(component->data()), componentBytes);
+        m_bytesWritten += m_numGridPoints * sizeof(double);
+    }
+};
+
+bool FrameWriter::resume(const std::string& path, const std::size_t& dim, const std::vector<std::size_t>& shape, const double& bound,
+                         const std::vector<std::string>& fieldNames, const std::vector<std::string>& staticFieldNames,
+                         const bool& compress, const std::size_t& iteration)
+{
+    close();
+
+    if ((dim != 2 && dim != 3) || shape.size() != dim) { return false; }
+
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) { return false; }
+
+    const std::vector<char> expected { header(dim, shape, bound, fieldNames, staticFieldNames, compress) };
+    std::vector<char> found(expected.size());
+    file.read(found.data(), static_cast<std::streamsize>(found.size()));
+    if (!file || found != expected) { return false; }
+
+    // skip the static section, then every record up to and including `iteration`
+    const std::size_t fileSize { static_cast<std::size_t>(std::filesystem::file_size(path)) };
+    std::size_t end { expected.size() + (dim + staticFieldNames.size() * (1 + dim)) * m_numGridPoints * sizeof(double) };
+    if (end > fileSize) { return false; }
+
+    while (end + s_recordHeaderSize <= fileSize)
+    {
+        std::uint64_t values[5];
+        file.seekg(static_cast<std::streamoff>(end));
+        file.read(reinterpret_cast<char*>(values), sizeof(values));
+        if (!file || values[0] > iteration || end + s_recordHeaderSize + values[2] > fileSize) { break; }
+        end += s_recordHeaderSize + static_cast<std::size_t>(values[2]);
+    }
+    file.close();
+
+    // whatever was written after the checkpoint is written again by the restarted run
+    std::filesystem::resize_file(path, end);
+    m_file.open(path, std::ios::out | std::ios::binary | std::ios::app);
+    if (!m_file.is_open())
+    {
+        throw std::ios_base::failure("Failed to open file for writing: " + path);
+    }
+
+    m_path = path;
+    m_bytesWritten = end;
+    return true;
+};
+
+void FrameWriter::writeFrame(const std::size_t& iteration, const double& time, const std::vector<const AlignedVector*>& components, const ParticleState& particles)
+{
+    if (!m_file.is_open())
+    {
+        throw std::ios_base::failure("Frame written before the run file was opened!");
+    }
+    if (components.size() != m_numFields * (1 + m_dim))
+    {
+        std::cerr << "Expected " << m_numFields << " fields but got " << components.size() << " components! Skipping frame " << iteration << "..." << std::endl;
+        return;
+    }
+
+    // payload first (right after the record header), component by component
+    std::vector<const std::vector<double>*> particleComponents { &particles.x, &particles.y, &particles.vx, &particles.vy };
+    if (m_dim == 3) { particleComponents = { &particles.x, &particles.y, &particles.z, &particles.vx, &particles.vy, &particles.vz }; }
+
+    const std::size_t numParticles { particles.size() };
+    const std::size_t rawSize { (components.size() * m_numGridPoints + particleComponents.size() * numParticles) * sizeof(double) + numParticles * sizeof(std::uint64_t) };
+    m_buffer.resize(s_recordHeaderSize + rawSize);
+
+    double* payload { reinterpret_cast<double*>(m_buffer.data() + s_recordHeaderSize) };
+    for (const AlignedVector* component : components)
+    {
+        if (component->size() != m_numGridPoints)
+        {
+            throw std::length_error("Field size does not match the grid of the run file!");
+        }
+
+        // the fields are already stored component by component
+        std::memcpy(payload, component->data(), m_numGridPoints * sizeof(double));
+        payload += m_numGridPoints;
+    }
+
+    for (const std::vector<double>* component : particleComponents)
+    {
+        if (component->size() != numParticles)
+        {
+            throw std::length_error("Particle state does not match the dimension of the run file!");
+        }
+        std::memcpy(payload, component->data(), numParticles * sizeof(double));
+        payload += numParticles;
+    }
+    if (particles.id.size() != numParticles)
+    {
+        throw std::length_error("Particle ids do not match the particle state!");
+    }
+    std::memcpy(payload, particles.id.data(), numParticles * sizeof(std::uint64_t));
+
+    char* data { m_buffer.data() };
+    std::size_t storedSize { rawSize };
+
+    if (m_compress)
+    {
+        uLongf compressedSize { compressBound(static_cast<uLong>(rawSize)) };
+        m_compressed.resize(s_recordHeaderSize + compressedSize);
+        const int status { compress2(reinterpret_cast<Bytef*>(m_compressed.data() + s_recordHeaderSize), &compressedSize,
+                                     reinterpret_cast<const Bytef*>(m_buffer.data() + s_recordHeaderSize), static_cast<uLong>(rawSize), Z_BEST_SPEED) };
+        if (status != Z_OK)
+        {
+            throw std::runtime_error("zlib failed to compress frame " + std::to_string(iteration));
+        }
+
+        data = m_compressed.data();
+        storedSize = compressedSize;
+    }
+
+    // fill in the record header in whichever buffer is written out
+    const std::uint64_t values[5] { static_cast<std::uint64_t>(iteration), 0, static_cast<std::uint64_t>(storedSize), static_cast<std::uint64_t>(rawSize), static_cast<std::uint64_t>(numParticles) };
+    std::memcpy(data, values, sizeof(values));
+    std::memcpy(data + sizeof(std::uint64_t), &time, sizeof(double));
+
+    m_file.write(data, static_cast<std::streamsize>(s_recordHeaderSize + storedSize));
+    m_bytesWritten += s_recordHeaderSize + storedSize;
+};
+
+void FrameWriter::flush()
+{
+    if (m_file.is_open())
+    {
+        m_file.flush();
+    }
+};
+
+void FrameWriter::close()
+{
+    if (m_file.is_open())
+    {
+        m_file.close();
+    }
+};
+
+char* formatNumber(char* first, const double& value, const int& precision)
+{
+    char* const last { first + s_maxNumberChars };
+    const std::to_chars_result result { precision > 0 ? std::to_chars(first, last, value, std::chars_format::general, precision)
+                                                      : std::to_chars(first, last, value) };
+    return result.ptr;
+};
+
+TextFrameWriter::TextFrameWriter(const std::string& delimiter, const int& precision, const std::size_t& threads)
+    : m_delimiter {delimiter}
+    , m_precision {std::clamp(precision, 0, 17)} // more digits than 17 never change the double that is read back
+    , m_threads {std::max<std::size_t>(threads, 1)}
+{
+};
+
+std::size_t TextFrameWriter::write(const std::string& path, const std::vector<const AlignedVector*>& columns)
+{
+    const std::size_t numRows { columns.empty() ? 0 : columns.front()->size() };
+    const std::size_t numChunks { (numRows + s_chunkRows - 1) / s_chunkRows };
+    const std::size_t maxRowChars { columns.size() * (s_maxNumberChars + m_delimiter.size()) + 1 };
+
+    if (m_chunks.size() < numChunks) { m_chunks.resize(numChunks); }
+    m_lengths.assign(numChunks, 0);
+
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(static_cast<int>(m_threads)) if(m_threads > 1 && numChunks > 1)
+    for (std::size_t chunk = 0; chunk < numChunks; ++chunk)
+    {
+        const std::size_t begin { chunk * s_chunkRows };
+        const std::size_t end { std::min(begin + s_chunkRows, numRows) };
+
+        // only grows, a buffer is never cleared between frames
+        std::vector<char>& buffer { m_chunks[chunk] };
+        if (buffer.size() < (end - begin) * maxRowChars) { buffer.resize((end - begin) * maxRowChars); }
+
+        char* text { buffer.data() };
+        for (std::size_t row = begin; row < end; ++row)
+        {
+            bool first { true };
+            for (const AlignedVector* column : columns)
+            {
+                if (row >= column->size()) { continue; }
+                if (!first)
+                {
+                    text = std::copy(m_delimiter.begin(), m_delimiter.end(), text);
+                }
+                text = formatNumber(text, (*column)[row], m_precision);
+                first = false;
+            }
+            *text++ = '\n';
+        }
+        m_lengths[chunk] = static_cast<std::size_t>(text - buffer.data());
+    }
+
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    if (!file.is_open())
+    {
+        throw std::ios_base::failure("Failed to open file for writing: " + path);
+    }
+
+    std::size_t bytes { 0 };
+    for (std::size_t chunk = 0; chunk < numChunks; ++chunk)
+    {
+        file.write(m_chunks[chunk].data(), static_cast<std::streamsize>(m_lengths[chunk]));
+        bytes += m_lengths[chunk];
+    }
+    return bytes;
+};
+
+AsyncFrameWriter::~AsyncFrameWriter()
+{
+    stop();
+};
+
+void AsyncFrameWriter::start(Sink sink, const std::size_t& capacity)
+{
+    finish();
+
+    m_sink = std::move(sink);
+    m_capacity = std::max<std::size_t>(capacity, 1);
+    m_numBuffers = 0;
+    m_free.clear();
+    m_queue.clear();
+    m_stopping = false;
+    m_error = nullptr;
+    m_framesSubmitted = 0;
+    m_depthSum = 0;
+    m_maxDepth = 0;
+    m_stalls = 0;
+    m_stallTime = 0.;
+
+    m_worker = std::thread(&AsyncFrameWriter::work, this);
+};
+
+void AsyncFrameWriter::work()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_frameQueued.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+        if (m_queue.empty()) { return; } // stopping and fully drained
+
+        std::unique_ptr<Frame> frame { std::move(m_queue.front()) };
+        m_queue.pop_front();
+        m_busy = true;
+        const bool failed { m_error != nullptr };
+        lock.unlock();
+
+        // after a failure the remaining frames are dropped (the error is reported on the simulation thread)
+        if (!failed)
+        {
+            try
+            {
+                m_sink(*frame);
+            }
+            catch (...)
+            {
+                lock.lock();
+                m_error = std::current_exception();
+                lock.unlock();
+            }
+        }
+
+        lock.lock();
+        m_busy = false;
+        m_free.push_back(std::move(frame));
+        m_bufferFreed.notify_one();
+    }
+};
+
+void AsyncFrameWriter::submit(const std::size_t& iteration, const double& time, const std::vector<const AlignedVector*>& components, const ParticleState& particles)
+{
+    if (!isRunning())
+    {
+        throw std::logic_error("Frame submitted before the writer thread was started!");
+    }
+
+    std::unique_ptr<Frame> frame;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_error)
+        {
+            lock.unlock();
+            finish(); // rethrows the write error
+        }
+
+        // at most `capacity` frames wait in the queue, plus the one the sink is busy with
+        const auto bufferAvailable { [this] { return m_queue.size() < m_capacity && (!m_free.empty() || m_numBuffers <= m_capacity); } };
+        if (!bufferAvailable())
+        {
+            const auto start { std::chrono::steady_clock::now() };
+            m_bufferFreed.wait(lock, bufferAvailable);
+            const std::chrono::duration<double> stalled { std::chrono::steady_clock::now() - start };
+            m_stallTime += stalled.count();
+            ++m_stalls;
+        }
+
+        if (m_free.empty())
+        {
+            frame = std::make_unique<Frame>();
+            ++m_numBuffers;
+        }
+        else
+        {
+            frame = std::move(m_free.back());
+            m_free.pop_back();
+        }
+    }
+
+    // copy outside the lock, the writer thread only touches frames in the queue
+    frame->iteration = iteration;
+    frame->time = time;
+    frame->components.resize(components.size());
+    for (std::size_t i = 0; i < components.size(); ++i)
+    {
+        frame->components[i].assign(components[i]->begin(), components[i]->end());
+    }
+    frame->particles = particles;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::move(frame));
+        ++m_framesSubmitted;
+        m_depthSum += m_queue.size();
+        m_maxDepth = std::max(m_maxDepth, m_queue.size());
+    }
+    m_frameQueued.notify_one();
+};
+
+void AsyncFrameWriter::stop()
+{
+    if (!isRunning()) { return; }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_frameQueued.notify_one();
+    m_worker.join();
+};
+
+void AsyncFrameWriter::drain()
+{
+    if (!isRunning()) { return; }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_bufferFreed.wait(lock, [this] { return m_queue.empty() && !m_busy; });
+    if (m_error)
+    {
+        lock.unlock();
+        finish(); // rethrows the write error
+    }
+};
+
+void AsyncFrameWriter::finish()
+{
+    stop();
+
+    if (m_error)
+    {
+        std::exception_ptr error { m_error };
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+};
+
+void AsyncFrameWriter::report(std::ostream& out) const
+{
+    const double averageDepth { m_framesSubmitted > 0 ? static_cast<double>(m_depthSum) / static_cast<double>(m_framesSubmitted) : 0. };
+    out << "output: " << m_framesSubmitted << " frames, queue depth " << std::fixed << std::setprecision(2) << averageDepth << " average / "
+        << m_maxDepth << " max (capacity " << m_capacity << "), stalled " << m_stalls << " times for " << std::setprecision(3) << m_stallTime << " s"
+        << std::defaultfloat << std::endl;
+};
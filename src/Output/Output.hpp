@@ -0,0 +1,238 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Fields/Fields.hpp"
+
+/*
+Binary run file (one per run, `<output directory>/<output filename>.cemf`), all values little-endian
+
+Everything that does not change during a run (grid coordinates, fields of sources that do not move) is written
+once after the header, each frame record only holds the time-varying fields and the particle state.
+
+header (64 bytes + 8 bytes per field name):
+    char[8]     magic "CEMFRAME"
+    uint32      version
+    uint32      flags (bit 0: frame payloads are zlib compressed)
+    uint32      dim
+    uint32      number of frame fields
+    uint64      grid points along x (numPoints + 1 unless the output is decimated)
+    double      bound
+    uint32      number of static fields
+    uint32      grid points along y
+    uint32      grid points along z (0 unless dim is 3)
+    uint8[12]   reserved
+    char[8]     name of each frame field ("E", ... zero padded)
+    char[8]     name of each static field ("B", ...)
+
+static section (never compressed):
+    double      x[G], y[G] (, z[G]) grid coordinates (G = product of the grid points along each dimension, same ordering
+                as Geometry<dim>: the output stride/box only drop grid points, the last dimension still runs fastest)
+    payload     for each static field: magnitude[G], x[G], y[G] (, z[G])
+
+one record per frame:
+    uint64      iteration
+    double      time
+    uint64      payload bytes stored in the file
+    uint64      payload bytes when uncompressed
+    uint64      number of particles N
+    payload     for each frame field: magnitude[G], x[G], y[G] (, z[G])
+                then the particles: x[N], y[N] (, z[N]), vx[N], vy[N] (, vz[N])
+                and uint64 id[N] (the order of the particles can change from frame to frame, see SpatialSort.hpp)
+
+(the z parts only exist in 3D runs, a field has 1 + dim components)
+
+Uncompressed records all have the same size while N does not change, so a reader can memory-map frame k directly (see analysis/cemf.py)
+*/
+
+// particle positions and velocities as structure-of-arrays, as stored in a frame record
+struct ParticleState
+{
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> z; // 3D only
+    std::vector<double> vx;
+    std::vector<double> vy;
+    std::vector<double> vz; // 3D only
+    std::vector<std::uint64_t> id;
+
+    std::size_t size() const { return x.size(); }
+
+    void resize(std::size_t n, std::size_t dim = 2)
+    {
+        x.resize(n);
+        y.resize(n);
+        z.resize(dim == 3 ? n : 0);
+        vx.resize(n);
+        vy.resize(n);
+        vz.resize(dim == 3 ? n : 0);
+        id.resize(n);
+    }
+};
+
+class FrameWriter
+{
+private:
+    std::ofstream m_file;
+    std::string m_path;
+    bool m_compress { false };
+    std::size_t m_dim { 2 };
+    std::size_t m_numGridPoints { 0 };
+    std::size_t m_numFields { 0 };
+    std::size_t m_bytesWritten { 0 };
+
+    std::vector<char> m_buffer; // reused for every frame so that each frame is a single write
+    std::vector<char> m_compressed;
+
+    // header bytes of a run file with this layout (also sets the layout members)
+    std::vector<char> header(const std::size_t& dim, const std::vector<std::size_t>& shape, const double& bound,
+                             const std::vector<std::string>& fieldNames, const std::vector<std::string>& staticFieldNames, const bool& compress);
+
+public:
+    static constexpr std::uint32_t s_version { 1 };
+    static constexpr std::size_t s_recordHeaderSize { 5 * sizeof(std::uint64_t) };
+
+    FrameWriter() = default;
+    ~FrameWriter();
+
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+
+    // creates (truncates) the run file and writes the header, the grid and the static fields
+    // `shape` is the number of grid points along each dimension, `grid` the coordinates of every grid point (one array per dimension),
+    // and every field is given as its 1 + dim components (magnitude, x, y(, z)) one after the other
+    void open(const std::string& path, const std::size_t& dim, const std::vector<std::size_t>& shape, const double& bound,
+              const std::vector<const AlignedVector*>& grid,
+              const std::vector<std::string>& fieldNames,
+              const std::vector<std::string>& staticFieldNames, const std::vector<const AlignedVector*>& staticComponents,
+              const bool& compress);
+
+    // continues the run file at `path` after a restart: the header has to match the one `open` would write, the records after
+    // `iteration` are cut off and new frames are appended. Returns false (and leaves the file alone) when there is no matching run file.
+    bool resume(const std::string& path, const std::size_t& dim, const std::vector<std::size_t>& shape, const double& bound,
+                const std::vector<std::string>& fieldNames, const std::vector<std::string>& staticFieldNames,
+                const bool& compress, const std::size_t& iteration);
+
+    // appends one record, `components` must match the frame field names given to `open`
+    void writeFrame(const std::size_t& iteration, const double& time, const std::vector<const AlignedVector*>& components, const ParticleState& particles);
+
+    // hands the written records to the operating system
+    void flush();
+
+    void close();
+
+    // Getters
+    bool isOpen() const { return m_file.is_open(); }
+    const std::string& path() const { return m_path; }
+    std::size_t bytesWritten() const { return m_bytesWritten; }
+};
+
+// csv numbers: `precision` significant digits (std::chars_format::general) or, with 0, the shortest text that reads back as the
+// same double. Writes at most s_maxNumberChars characters from `first` and returns the end of the text
+inline constexpr std::size_t s_maxNumberChars { 32 };
+char* formatNumber(char* first, const double& value, const int& precision);
+
+// csv frames: one line per point with every column (grid coordinates, field components, ...) formatted with std::to_chars.
+// The rows are formatted in chunks into buffers that are kept from frame to frame (in parallel with `threads` > 1) and the file
+// is written from them in one pass, nothing goes through an ostream.
+class TextFrameWriter
+{
+private:
+    static constexpr std::size_t s_chunkRows { 16384 };
+
+    std::string m_delimiter;
+    int m_precision;
+    std::size_t m_threads;
+    std::vector<std::vector<char>> m_chunks;
+    std::vector<std::size_t> m_lengths; // text in each chunk of the last frame
+
+public:
+    explicit TextFrameWriter(const std::string& delimiter = ",", const int& precision = 0, const std::size_t& threads = 1);
+
+    // one line per row of the columns, a column that is shorter than the first one is left out of the rows it doesn't have
+    // (returns the bytes written)
+    std::size_t write(const std::string& path, const std::vector<const AlignedVector*>& columns);
+};
+
+// copy of the time-varying fields and the particles at one iteration, owned by the writer thread until it has been written
+struct Frame
+{
+    std::size_t iteration { 0 };
+    double time { 0. };
+    std::vector<AlignedVector> components; // every field as magnitude, x, y(, z)
+    ParticleState particles;
+};
+
+// Writes frames on a background thread so the integrator does not wait for the disk.
+// `submit` copies the fields into a recycled frame buffer and returns; it only blocks (back-pressure) when
+// `capacity` frames are already queued behind the one being written. `finish` drains the queue and joins the thread.
+class AsyncFrameWriter
+{
+public:
+    // does the actual writing (binary record, csv files, ...), only ever called from the writer thread
+    using Sink = std::function<void(const Frame&)>;
+
+private:
+    Sink m_sink;
+    std::size_t m_capacity { 0 };
+    std::size_t m_numBuffers { 0 }; // allocated on demand, at most capacity + 1
+
+    std::vector<std::unique_ptr<Frame>> m_free;
+    std::deque<std::unique_ptr<Frame>> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_frameQueued;
+    std::condition_variable m_bufferFreed;
+    std::thread m_worker;
+    bool m_stopping { false };
+    bool m_busy { false }; // the sink is writing a frame
+    std::exception_ptr m_error; // first exception thrown by the sink, rethrown on the simulation thread
+
+    // statistics
+    std::size_t m_framesSubmitted { 0 };
+    std::size_t m_depthSum { 0 }; // queue depth seen by each submit (including the new frame)
+    std::size_t m_maxDepth { 0 };
+    std::size_t m_stalls { 0 };
+    double m_stallTime { 0. }; // seconds the simulation spent waiting for a free buffer
+
+    void work();
+    void stop(); // drains and joins without rethrowing (used by the destructor)
+
+public:
+    AsyncFrameWriter() = default;
+    ~AsyncFrameWriter();
+
+    AsyncFrameWriter(const AsyncFrameWriter&) = delete;
+    AsyncFrameWriter& operator=(const AsyncFrameWriter&) = delete;
+
+    void start(Sink sink, const std::size_t& capacity);
+
+    void submit(const std::size_t& iteration, const double& time, const std::vector<const AlignedVector*>& components, const ParticleState& particles);
+
+    // blocks until every queued frame has been written (the thread keeps running) and rethrows a write error if there was one
+    void drain();
+
+    // writes everything still queued, joins the writer thread and rethrows a write error if there was one
+    void finish();
+
+    // queue depth and stall time summary
+    void report(std::ostream& out) const;
+
+    // Getters
+    bool isRunning() const { return m_worker.joinable(); }
+    std::size_t framesSubmitted() const { return m_framesSubmitted; }
+    double stallTime() const { return m_stallTime; }
+    std::size_t maxDepth() const { return m_maxDepth; }
+};
@@ -0,0 +1,306 @@
+#include "ParticleInput.hpp"
+
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../Utilities/Utilities.hpp"
+
+namespace
+{
+    constexpr char s_magic[8] { 'C', 'E', 'M', 'P', 'A', 'R', 'T', 'S' };
+    constexpr std::size_t s_headerSize { 32 };
+
+    // read-only mapping of a whole file (unmapped when it goes out of scope)
+    class MappedFile
+    {
+    private:
+        const char* m_data { nullptr };
+        std::size_t m_size { 0 };
+
+    public:
+        explicit MappedFile(const std::string& path)
+        {
+            const int fd { ::open(path.c_str(), O_RDONLY) };
+            if (fd < 0)
+            {
+                throw std::ios_base::failure("Failed to open file for reading: " + path);
+            }
+
+            struct stat status;
+            if (::fstat(fd, &status) != 0)
+            {
+                ::close(fd);
+                throw std::ios_base::failure("Failed to read the size of " + path);
+            }
+            m_size = static_cast<std::size_t>(status.st_size);
+
+            if (m_size > 0)
+            {
+                void* data { ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0) };
+                if (data == MAP_FAILED)
+                {
+                    ::close(fd);
+                    throw std::ios_base::failure("Failed to map " + path);
+                }
+                // read front to back once
+                ::madvise(data, m_size, MADV_SEQUENTIAL);
+                m_data = static_cast<const char*>(data);
+            }
+            ::close(fd); // the mapping stays valid
+        }
+
+        ~MappedFile()
+        {
+            if (m_data) { ::munmap(const_cast<char*>(m_data), m_size); }
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* data() const { return m_data; }
+        std::size_t size() const { return m_size; }
+    };
+
+    template <typename T>
+    T get(const char* in)
+    {
+        T value;
+        std::memcpy(&value, in, sizeof(T));
+        return value;
+    };
+
+    /*
+    Follows the nesting of the json file and hands the numbers of each particle entry to an Entry. Anything that isn't
+    in the particle array (the other keys of a config) or is nested deeper in an entry is skipped without being stored.
+    */
+    template <std::size_t N>
+    class ParticleSax
+    {
+    private:
+        const std::string& m_path;
+        const double& m_bound;
+        const double& m_chargeScale;
+        std::vector<ChargedParticle<N>>& m_particles;
+
+        std::size_t m_depth { 0 }; // objects and arrays the parser is in
+        std::size_t m_arrayDepth { 0 }; // depth of the particle array (0: not in it)
+        bool m_topLevelArray { false }; // the file is just the particle array
+        bool m_particlesKey { false }; // the next value belongs to the top-level "particles" key
+        unsigned m_key { 0 }; // key of the entry the next number belongs to
+        ParticleInput::Entry m_entry;
+
+        bool inEntry() const { return m_arrayDepth > 0 && m_depth == m_arrayDepth + 1; }
+
+        bool number(const double& value)
+        {
+            if (inEntry() && m_key != 0) { m_entry.set(m_key, value); }
+            m_particlesKey = false;
+            return true;
+        }
+
+    public:
+        ParticleSax(const std::string& path, const double& bound, const double& chargeScale, std::vector<ChargedParticle<N>>& particles)
+            : m_path {path}
+            , m_bound {bound}
+            , m_chargeScale {chargeScale}
+            , m_particles {particles}
+        {
+        }
+
+        bool null() { m_particlesKey = false; return true; }
+        bool boolean(bool) { m_particlesKey = false; return true; }
+        bool number_integer(std::int64_t value) { return number(static_cast<double>(value)); }
+        bool number_unsigned(std::uint64_t value) { return number(static_cast<double>(value)); }
+        bool number_float(double value, const std::string&) { return number(value); }
+        bool string(std::string&) { m_particlesKey = false; return true; }
+        bool binary(std::vector<std::uint8_t>&) { m_particlesKey = false; return true; }
+
+        bool start_object(std::size_t)
+        {
+            ++m_depth;
+            m_particlesKey = false;
+            if (inEntry()) { m_entry = ParticleInput::Entry {}; }
+            return true;
+        }
+
+        bool end_object()
+        {
+            if (inEntry()) { ParticleInput::append<N>(m_entry, m_bound, m_chargeScale, m_particles); }
+            --m_depth;
+            return true;
+        }
+
+        bool start_array(std::size_t)
+        {
+            ++m_depth;
+            if (m_depth == 1) { m_topLevelArray = true; }
+            if ((m_topLevelArray && m_depth == 1) || (m_particlesKey && m_depth == 2)) { m_arrayDepth = m_depth; }
+            m_particlesKey = false;
+            return true;
+        }
+
+        bool end_array()
+        {
+            if (m_depth == m_arrayDepth) { m_arrayDepth = 0; }
+            --m_depth;
+            return true;
+        }
+
+        bool key(std::string& name)
+        {
+            if (inEntry()) { m_key = ParticleInput::Entry::key(name); }
+            m_particlesKey = !m_topLevelArray && m_depth == 1 && name == "particles";
+            return true;
+        }
+
+        bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& error)
+        {
+            throw std::ios_base::failure("Failed to parse " + m_path + " at byte " + std::to_string(position) + ": " + error.what());
+        }
+    };
+};
+
+namespace ParticleInput
+{
+    unsigned Entry::key(std::string_view name)
+    {
+        if (name == "charge") { return charge; }
+        if (name == "mass") { return mass; }
+        if (name == "x") { return x; }
+        if (name == "y") { return y; }
+        if (name == "z") { return z; }
+        if (name == "vx") { return vx; }
+        if (name == "vy") { return vy; }
+        if (name == "vz") { return vz; }
+        return 0;
+    };
+
+    void Entry::set(const unsigned& key, const double& value)
+    {
+        // the keys are single bits, their position is the index of the value
+        values[std::countr_zero(key)] = value;
+        seen |= key;
+    };
+
+    template <std::size_t N>
+    void append(const Entry& entry, const double& bound, const double& chargeScale, std::vector<ChargedParticle<N>>& particles)
+    {
+        const double* values { entry.values };
+        if (!entry.has(Entry::charge | Entry::x | Entry::y))
+        {
+            std::cerr << "Particle without a charge, x or y! Ignoring..." << std::endl;
+            return;
+        }
+
+        Point<N> position;
+        position[0] = values[2];
+        position[1] = values[3];
+        if constexpr (N == 3) { position[2] = values[4]; }
+        if (!Utilities::checkPointWithinBounds(position, bound))
+        {
+            std::cerr << "Particle out of bounds! Ignoring..." << '\n' << "x\t" << position[0] << '\n' << "y\t" << position[1];
+            if constexpr (N == 3) { std::cerr << '\n' << "z\t" << position[2]; }
+            std::cerr << std::endl;
+            return;
+        }
+
+        Point3D velocity {0.0, 0.0, 0.0};
+        if (entry.has(Entry::vx | Entry::vy | Entry::vz)) { velocity = Point3D{values[5], values[6], values[7]}; }
+
+        particles.emplace_back(ChargedParticle<N>{chargeScale * values[0], std::abs(values[1]), position, velocity});
+    };
+
+    template <std::size_t N>
+    void readFile(const std::string& path, const double& bound, const double& chargeScale, std::vector<ChargedParticle<N>>& particles)
+    {
+        if (std::filesystem::path(path).extension() == ".cemp") { readTable<N>(path, bound, chargeScale, particles); }
+        else { streamJson<N>(path, bound, chargeScale, particles); }
+    };
+
+    template <std::size_t N>
+    void readTable(const std::string& path, const double& bound, const double& chargeScale, std::vector<ChargedParticle<N>>& particles)
+    {
+        const MappedFile file { path };
+        if (file.size() < s_headerSize || std::memcmp(file.data(), s_magic, sizeof(s_magic)) != 0)
+        {
+            throw std::ios_base::failure(path + " is not a particle table");
+        }
+
+        const std::uint32_t version { get<std::uint32_t>(file.data() + 8) };
+        const std::size_t dim { get<std::uint32_t>(file.data() + 12) };
+        const std::size_t numParticles { static_cast<std::size_t>(get<std::uint64_t>(file.data() + 16)) };
+        if (version != 1)
+        {
+            throw std::ios_base::failure(path + " has the unsupported particle table version " + std::to_string(version));
+        }
+        if ((dim != 2 && dim != 3) || dim > N)
+        {
+            throw std::ios_base::failure(path + " holds " + std::to_string(dim) + "D particles, the run is " + std::to_string(N) + "D");
+        }
+        const std::size_t numColumns { 2 + dim + 3 };
+        if ((file.size() - s_headerSize) / (numColumns * sizeof(double)) < numParticles)
+        {
+            throw std::ios_base::failure(path + " is too short for its " + std::to_string(numParticles) + " particles");
+        }
+
+        // the columns in the order of the entry's values (a 2D table has no z column)
+        const std::size_t columnBytes { numParticles * sizeof(double) };
+        const char* columns[8];
+        const char* column { file.data() + s_headerSize };
+        for (std::size_t c = 0; c < 8; ++c)
+        {
+            if (c == 4 && dim == 2) { columns[c] = nullptr; continue; }
+            columns[c] = column;
+            column += columnBytes;
+        }
+
+        particles.reserve(particles.size() + numParticles);
+        Entry entry;
+        entry.seen = 0xff;
+        for (std::size_t i = 0; i < numParticles; ++i)
+        {
+            const std::size_t offset { i * sizeof(double) };
+            for (std::size_t c = 0; c < 8; ++c)
+            {
+                entry.values[c] = columns[c] ? get<double>(columns[c] + offset) : 0.;
+            }
+            append<N>(entry, bound, chargeScale, particles);
+        }
+    };
+
+    template <std::size_t N>
+    void streamJson(const std::string& path, const double& bound, const double& chargeScale, std::vector<ChargedParticle<N>>& particles)
+    {
+        const MappedFile file { path };
+
+        // every particle is an object, so their number is at most the number of braces (one memchr pass, far cheaper than the parse)
+        std::size_t numObjects { 0 };
+        const char* const end { file.data() + file.size() };
+        for (const char* next = file.data(); next && next < end; ++numObjects)
+        {
+            next = static_cast<const char*>(std::memchr(next, '{', static_cast<std::size_t>(end - next)));
+            if (!next) { break; }
+            ++next;
+        }
+        particles.reserve(particles.size() + numObjects);
+
+        ParticleSax<N> sax { path, bound, chargeScale, particles };
+        nlohmann::json::sax_parse(file.data(), file.data() + file.size(), &sax);
+    };
+
+    template void append<2>(const Entry&, const double&, const double&, std::vector<ChargedParticle2D>&);
+    template void append<3>(const Entry&, const double&, const double&, std::vector<ChargedParticle3D>&);
+    template void readFile<2>(const std::string&, const double&, const double&, std::vector<ChargedParticle2D>&);
+    template void readFile<3>(const std::string&, const double&, const double&, std::vector<ChargedParticle3D>&);
+    template void readTable<2>(const std::string&, const double&, const double&, std::vector<ChargedParticle2D>&);
+    template void readTable<3>(const std::string&, const double&, const double&, std::vector<ChargedParticle3D>&);
+    template void streamJson<2>(const std::string&, const double&, const double&, std::vector<ChargedParticle2D>&);
+    template void streamJson<3>(const std::string&, const double&, const double&, std::vector<ChargedParticle3D>&);
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../Points/Points.hpp"
+
+/*
+Particle table (`.cemp`, "particles file" in the config), all values little-endian
+
+Large initial conditions are read from it with one mmap and no parsing, straight into the particles of the run.
+
+header (32 bytes):
+    char[8]     magic "CEMPARTS"
+    uint32      version (1)
+    uint32      dim (2 or 3)
+    uint64      number of particles N
+    uint64      reserved (0)
+
+columns:
+    double      charge[N], mass[N]
+    double      x[N], y[N] (, z[N])
+    double      vx[N], vy[N], vz[N] (always 3 components)
+
+A 2D table can be read into a 3D run (z = 0), not the other way around.
+*/
+
+// Readers for the initial particles that skip the json DOM: the entries of a "particles file" go straight from the (memory-mapped)
+// file into the particles of the run, which are reserved for all of them up front
+namespace ParticleInput
+{
+    // the keys of one particle entry as they are read (json entry or table row)
+    struct Entry
+    {
+        enum Key : unsigned { charge = 1, mass = 2, x = 4, y = 8, z = 16, vx = 32, vy = 64, vz = 128 };
+
+        double values[8] { 0., 1., 0., 0., 0., 0., 0., 0. }; // in the order of the keys, the mass defaults to 1
+        unsigned seen { 0 };
+
+        // the key of a json entry (0: not a particle key)
+        static unsigned key(std::string_view name);
+        void set(const unsigned& key, const double& value);
+        bool has(const unsigned& keys) const { return (seen & keys) == keys; }
+    };
+
+    // appends the particle of `entry` (the charge multiplied by `chargeScale`, the velocity only if all three components are given),
+    // entries outside of the domain or without a charge, x or y are reported and left out
+    template <std::size_t N>
+    void append(const Entry& entry, const double& bound, const double& chargeScale, std::vector<ChargedParticle<N>>& particles);
+
+    // appends the particles of `path`: a particle table if it ends in ".cemp", otherwise a json file that is either an array of
+    // particle entries or an object with a "particles" array (e.g. another config). Throws if the file can't be read.
+    template <std::size_t N>
+    void readFile(const std::string& path, const double& bound, const double& chargeScale, std::vector<ChargedParticle<N>>& particles);
+
+    template <std::size_t N>
+    void readTable(const std::string& path, const double& bound, const double& chargeScale, std::vector<ChargedParticle<N>>& particles);
+
+    // SAX parse, only the particle entries are kept (a few doubles at a time instead of a json object per particle)
+    template <std::size_t N>
+    void streamJson(const std::string& path, const double& bound, const double& chargeScale, std::vector<ChargedParticle<N>>& particles);
+};
@@ -0,0 +1,273 @@
+#include "ParticleMesh.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+ParticleMesh::ParticleMesh(const double& bound, const std::size_t& numPoints, const bool& periodic, const Utilities::Assignment& assignment, const bool& enabled)
+    : m_bound {bound}
+    , m_numPoints {numPoints}
+    , m_periodic {periodic}
+    , m_assignment {assignment}
+    , m_enabled {enabled}
+    , m_spacing { 2 * bound / static_cast<double>(numPoints) }
+    , m_meshSize { periodic ? numPoints : numPoints + 1 }
+    , m_fftSize { periodic ? numPoints : FFT::nextFastSize(2 * (numPoints + 1)) }
+    , m_greensFunction {}
+    , m_workspace {}
+    , m_rho {}
+    , m_potential {}
+    , m_Ex {}
+    , m_Ey {}
+{
+    if (!m_enabled) { return; }
+
+    const std::size_t numNodes { m_meshSize * m_meshSize };
+    m_rho.assign(numNodes, 0.);
+    m_potential.assign(numNodes, 0.);
+    m_Ex.assign(numNodes, 0.);
+    m_Ey.assign(numNodes, 0.);
+    m_workspace.assign(m_fftSize * m_fftSize, FFT::Complex{0., 0.});
+
+    initializeGreensFunction();
+};
+
+void ParticleMesh::initializeGreensFunction()
+{
+    // the self term uses the average of 1/r over one cell instead of the singularity
+    const double selfTerm { 4 * std::log(1 + std::sqrt(2.)) / m_spacing };
+    const std::size_t n { m_fftSize };
+
+    m_greensFunction.assign(n * n, FFT::Complex{0., 0.});
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        for (std::size_t j = 0; j < n; ++j)
+        {
+            // node offsets are wrapped to (-n/2, n/2], i.e. the minimum image when periodic
+            // (when isolated the padding guarantees that every offset between two real nodes is represented exactly once)
+            const double di { static_cast<double>(i <= n/2 ? i : n - i) };
+            const double dj { static_cast<double>(j <= n/2 ? j : n - j) };
+            const double r { m_spacing * std::sqrt(di*di + dj*dj) };
+
+            m_greensFunction[i*n + j] = (i == 0 && j == 0) ? selfTerm : 1. / r;
+        }
+    }
+
+    FFT::transform2D(m_greensFunction, n, n, false);
+};
+
+std::size_t assignmentStencil(const Utilities::Assignment& assignment, const double& u, long& first, double (&weights)[3])
+{
+    switch (assignment)
+    {
+        case Utilities::Assignment::NGP:
+        {
+            first = std::lround(u);
+            weights[0] = 1.;
+            return 1;
+        }
+        case Utilities::Assignment::CIC:
+        {
+            const double lower { std::floor(u) };
+            const double f { u - lower };
+            first = static_cast<long>(lower);
+            weights[0] = 1 - f;
+            weights[1] = f;
+            return 2;
+        }
+        case Utilities::Assignment::TSC:
+        {
+            const long center { std::lround(u) };
+            const double d { u - static_cast<double>(center) };
+            first = center - 1;
+            weights[0] = 0.5 * (0.5 - d) * (0.5 - d);
+            weights[1] = 0.75 - d * d;
+            weights[2] = 0.5 * (0.5 + d) * (0.5 + d);
+            return 3;
+        }
+    }
+
+    return 0;
+};
+
+std::size_t ParticleMesh::assignmentWeights(double coordinate, std::size_t (&nodes)[3], double (&weights)[3]) const
+{
+    long first { 0 };
+    const std::size_t count { assignmentStencil(m_assignment, (coordinate + m_bound) / m_spacing, first, weights) };
+
+    const long size { static_cast<long>(m_meshSize) };
+    for (std::size_t k = 0; k < count; ++k)
+    {
+        long idx { first + static_cast<long>(k) };
+        // periodic: wrap around, isolated: anything past the edge of the grid is piled onto the edge node
+        idx = m_periodic ? ((idx % size) + size) % size : std::clamp(idx, 0L, size - 1);
+        nodes[k] = static_cast<std::size_t>(idx);
+    }
+
+    return count;
+};
+
+void ParticleMesh::deposit(const std::vector<ChargedParticle2D>& particles)
+{
+    const std::size_t M { m_meshSize };
+
+    // private copy of the mesh per thread (no atomics in the hot loop), summed in thread order so that a run reproduces itself
+    std::vector<std::vector<double>> meshes(static_cast<std::size_t>(omp_get_max_threads()));
+
+    #pragma omp parallel
+    {
+        const std::size_t threads { static_cast<std::size_t>(omp_get_num_threads()) };
+        std::vector<double>& rho { meshes[static_cast<std::size_t>(omp_get_thread_num())] };
+        rho.assign(m_rho.size(), 0.);
+
+        #pragma omp for schedule(static)
+        for (std::size_t p = 0; p < particles.size(); ++p)
+        {
+            std::size_t nodesX[3], nodesY[3];
+            double weightsX[3], weightsY[3];
+            const std::size_t count { assignmentWeights(particles[p].position.x(), nodesX, weightsX) };
+            assignmentWeights(particles[p].position.y(), nodesY, weightsY);
+
+            for (std::size_t a = 0; a < count; ++a)
+            {
+                for (std::size_t b = 0; b < count; ++b)
+                {
+                    rho[nodesX[a] * M + nodesY[b]] += particles[p].charge * weightsX[a] * weightsY[b];
+                }
+            }
+        }
+
+        // (implicit barrier above) each thread sums whole mesh rows, always adding the thread meshes in the same order
+        #pragma omp for schedule(static)
+        for (std::size_t i = 0; i < M; ++i)
+        {
+            for (std::size_t j = 0; j < M; ++j)
+            {
+                double sum { 0. };
+                for (std::size_t t = 0; t < threads; ++t) { sum += meshes[t][i*M + j]; }
+                m_rho[i*M + j] = sum;
+            }
+        }
+    }
+};
+
+void ParticleMesh::solvePotential()
+{
+    const std::size_t n { m_fftSize };
+    std::fill(m_workspace.begin(), m_workspace.end(), FFT::Complex{0., 0.});
+    for (std::size_t i = 0; i < m_meshSize; ++i)
+    {
+        for (std::size_t j = 0; j < m_meshSize; ++j) { m_workspace[i*n + j] = m_rho[i*m_meshSize + j]; }
+    }
+
+    FFT::transform2D(m_workspace, n, n, false);
+    for (std::size_t idx = 0; idx < m_workspace.size(); ++idx) { m_workspace[idx] *= m_greensFunction[idx]; }
+    FFT::transform2D(m_workspace, n, n, true);
+
+    for (std::size_t i = 0; i < m_meshSize; ++i)
+    {
+        for (std::size_t j = 0; j < m_meshSize; ++j) { m_potential[i*m_meshSize + j] = m_workspace[i*n + j].real(); }
+    }
+};
+
+void ParticleMesh::calculateGradient()
+{
+    const std::size_t M { m_meshSize };
+
+    // neighbours along one dimension and the distance between them (central differences, one-sided on an isolated edge)
+    auto neighbours = [&](std::size_t i, std::size_t& lower, std::size_t& upper, double& distance)
+    {
+        if (m_periodic)
+        {
+            lower = (i + M - 1) % M;
+            upper = (i + 1) % M;
+            distance = 2 * m_spacing;
+        }
+        else
+        {
+            lower = (i == 0) ? 0 : i - 1;
+            upper = (i == M - 1) ? M - 1 : i + 1;
+            distance = static_cast<double>(upper - lower) * m_spacing;
+        }
+    };
+
+    #pragma omp parallel for
+    for (std::size_t i = 0; i < M; ++i)
+    {
+        std::size_t il, iu;
+        double dx;
+        neighbours(i, il, iu, dx);
+
+        for (std::size_t j = 0; j < M; ++j)
+        {
+            std::size_t jl, ju;
+            double dy;
+            neighbours(j, jl, ju, dy);
+
+            m_Ex[i*M + j] = -(m_potential[iu*M + j] - m_potential[il*M + j]) / dx;
+            m_Ey[i*M + j] = -(m_potential[i*M + ju] - m_potential[i*M + jl]) / dy;
+        }
+    }
+};
+
+void ParticleMesh::solve(const std::vector<ChargedParticle2D>& particles)
+{
+    if (!m_enabled) { return; }
+
+    deposit(particles);
+    solvePotential();
+    calculateGradient();
+};
+
+void ParticleMesh::fillField(FieldStore2D& field) const
+{
+    field.resize((m_numPoints + 1) * (m_numPoints + 1));
+    if (!m_enabled) { return; }
+
+    #pragma omp parallel for
+    for (std::size_t i = 0; i < m_numPoints + 1; ++i)
+    {
+        for (std::size_t j = 0; j < m_numPoints + 1; ++j)
+        {
+            // when periodic the last grid point is the first mesh node again
+            const std::size_t node { (i % m_meshSize) * m_meshSize + (j % m_meshSize) };
+            const double magnitude { std::sqrt(m_Ex[node]*m_Ex[node] + m_Ey[node]*m_Ey[node]) };
+
+            const std::size_t idx { i * (m_numPoints + 1) + j };
+            field.magnitude[idx] = magnitude;
+            field.x[idx] = magnitude > 0. ? m_Ex[node] / magnitude : 0.;
+            field.y[idx] = magnitude > 0. ? m_Ey[node] / magnitude : 0.;
+        }
+    }
+};
+
+std::vector<Point2D> ParticleMesh::calculateAcceleration(const std::vector<ChargedParticle2D>& particles) const
+{
+    std::vector<Point2D> acceleration(particles.size(), Point2D{ 0.0, 0.0 });
+    if (!m_enabled) { return acceleration; }
+
+    #pragma omp parallel for
+    for (std::size_t p = 0; p < particles.size(); ++p)
+    {
+        std::size_t nodesX[3], nodesY[3];
+        double weightsX[3], weightsY[3];
+        const std::size_t count { assignmentWeights(particles[p].position.x(), nodesX, weightsX) };
+        assignmentWeights(particles[p].position.y(), nodesY, weightsY);
+
+        double Ex { 0. };
+        double Ey { 0. };
+        for (std::size_t a = 0; a < count; ++a)
+        {
+            for (std::size_t b = 0; b < count; ++b)
+            {
+                const std::size_t node { nodesX[a] * m_meshSize + nodesY[b] };
+                Ex += weightsX[a] * weightsY[b] * m_Ex[node];
+                Ey += weightsX[a] * weightsY[b] * m_Ey[node];
+            }
+        }
+
+        const double qm { particles[p].charge / particles[p].mass };
+        acceleration[p] = Point2D { qm * Ex, qm * Ey };
+    }
+
+    return acceleration;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+
+#include "../FFT/FFT.hpp"
+#include "../Fields/Fields.hpp"
+#include "../Points/Points.hpp"
+#include "../Utilities/Utilities.hpp"
+
+// Particle-mesh electric field solver on the Geometry grid
+// 1. deposit the particle charges onto the grid nodes (NGP/CIC/TSC)
+// 2. get the potential by FFT convolution with the 1/r Green's function
+//    (periodic: circular convolution with the minimum image kernel, isolated: zero-padded linear convolution)
+// 3. E = -grad(potential) by central differences
+// 4. interpolate E back to the particles with the same weights used for the deposit (no self-force)
+// Cost per solve is O(G log G + N) instead of O(G N)
+
+// assignment stencil along one dimension: `u` is the position in units of the mesh spacing (node k sits at u = k),
+// fills the weights of the (up to 3) consecutive nodes starting at `first` and returns how many there are
+std::size_t assignmentStencil(const Utilities::Assignment& assignment, const double& u, long& first, double (&weights)[3]);
+
+class ParticleMesh
+{
+private:
+    double m_bound;
+    std::size_t m_numPoints; // the grid has numPoints+1 nodes per dimension (see Geometry)
+    bool m_periodic;
+    Utilities::Assignment m_assignment;
+    bool m_enabled; // nothing is allocated (or solved) for the other force solvers
+
+    double m_spacing;
+    std::size_t m_meshSize; // nodes per dimension (the last grid node is the same as the first one if periodic)
+    std::size_t m_fftSize; // FFT size per dimension (zero-padded if isolated)
+
+    std::vector<FFT::Complex> m_greensFunction; // already transformed
+    std::vector<FFT::Complex> m_workspace;
+    std::vector<double> m_rho; // deposited charge per node
+    std::vector<double> m_potential;
+    std::vector<double> m_Ex;
+    std::vector<double> m_Ey;
+
+    void initializeGreensFunction();
+
+    // nodes (up to 3 per dimension) and weights that a particle at `coordinate` is spread over
+    std::size_t assignmentWeights(double coordinate, std::size_t (&nodes)[3], double (&weights)[3]) const;
+
+    void deposit(const std::vector<ChargedParticle2D>& particles);
+    void solvePotential();
+    void calculateGradient();
+
+public:
+    ParticleMesh(const double& bound, const std::size_t& numPoints, const bool& periodic, const Utilities::Assignment& assignment, const bool& enabled);
+
+    // deposit + Poisson solve + gradient for the current particle positions
+    void solve(const std::vector<ChargedParticle2D>& particles);
+
+    // copies the solved electric field onto every Geometry grid point (same ordering as Geometry<2>::grid)
+    void fillField(FieldStore2D& field) const;
+
+    // E interpolated back to each particle, times charge/mass
+    std::vector<Point2D> calculateAcceleration(const std::vector<ChargedParticle2D>& particles) const;
+
+    // Getters
+    const std::vector<double>& potential() const { return m_potential; }
+    std::size_t meshSize() const { return m_meshSize; }
+    bool enabled() const { return m_enabled; }
+};
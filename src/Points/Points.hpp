@@ -1,199 +1,160 @@
 #pragma once
 
+#include <array>
 #include <cmath>
-
-class Point2D
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// N-dimensional point/vector, the dimension is a template parameter so that every loop over the components
+// is unrolled at compile time and 2D and 3D code share one implementation (no runtime dimension checks)
+template <std::size_t N, typename T = double>
+class Point
 {
+    static_assert(N == 2 || N == 3, "Currently only implemented for 2D and 3D points.");
+
 private:
-    double m_x;
-    double m_y;
+    std::array<T, N> m_coords;
 
 public:
-    Point2D(double x, double y) : m_x{x}, m_y{y} {};
+    constexpr Point() : m_coords{} {}
+
+    // one coordinate per dimension: Point<2> {x, y}, Point<3> {x, y, z}
+    template <typename... Coords>
+        requires (sizeof...(Coords) == N && (std::is_constructible_v<T, Coords> && ...))
+    constexpr Point(Coords... coords) : m_coords{ static_cast<T>(coords)... } {}
+
+    static constexpr std::size_t dim { N };
 
     // Getters
-    double x() const { return m_x; }
-    double y() const { return m_y; }
+    constexpr T x() const { return m_coords[0]; }
+    constexpr T y() const { return m_coords[1]; }
+    constexpr T z() const requires (N == 3) { return m_coords[2]; }
+    constexpr T operator[](std::size_t d) const { return m_coords[d]; }
 
     // Setters
-    void setX(double x) { m_x = x; }
-    void setY(double y) { m_y = y; }
+    constexpr void setX(T x) { m_coords[0] = x; }
+    constexpr void setY(T y) { m_coords[1] = y; }
+    constexpr void setZ(T z) requires (N == 3) { m_coords[2] = z; }
+    constexpr T& operator[](std::size_t d) { return m_coords[d]; }
 
     // Methods
-    double distanceTo(const Point2D& other) const
+    constexpr T dot(const Point& other) const
     {
-        return std::sqrt(
-              (m_x - other.x()) * (m_x - other.x())
-            + (m_y - other.y()) * (m_y - other.y())
-        );
-    }
-    
-    Point2D operator-(const Point2D& other) const
-    {
-        return Point2D(m_x - other.x(), m_y - other.y());
-    }
-    
-    Point2D operator-(const double& value) const
-    {
-        return Point2D(m_x - value, m_y - value);
+        T sum {};
+        for (std::size_t d = 0; d < N; ++d) { sum += m_coords[d] * other.m_coords[d]; }
+        return sum;
     }
 
-    Point2D operator+(const Point2D& other) const
-    {
-        return Point2D(m_x + other.x(), m_y + other.y());
-    }
-
-    Point2D operator*(const double scalar)
-    {
-        return Point2D(scalar * m_x, scalar * m_y);
-    }
+    constexpr T magnitudeSquared() const { return dot(*this); }
 
-    Point2D operator/(const double scalar)
-    {
-        return Point2D(m_x / scalar, m_y / scalar);
-    }
+    T magnitude() const { return std::sqrt(magnitudeSquared()); }
 
-    bool operator==(const Point2D& other) const
-    {
-        return m_x == other.x() && m_y == other.y();
-    }
+    T distanceTo(const Point& other) const { return (*this - other).magnitude(); }
 
-    void operator+=(const Point2D& other)
-    {
-        m_x += other.x();
-        m_y += other.y();
-        // return Point2D(m_x + other.x(), m_y + other.y());
-    }
-    
-    void operator-=(const Point2D& other)
-    {
-        m_x -= other.x();
-        m_y -= other.y();
-        // return Point2D(m_x + other.x(), m_y + other.y());
-    }
-
-    void normalize()
-    {
-        double magnitude { this->magnitude() };
-        m_x /= magnitude;
-        m_y /= magnitude;
-    }
-
-    double magnitude() { return std::sqrt(m_x*m_x + m_y*m_y);}
-};
-
-// overload scalar multiplication, but to make it work in `scalar * Point2D` direction we define it outside the Point2D class
-Point2D operator*(const double scalar, const Point2D& point);
-
-class Point3D
-{
-private:
-    double m_x;
-    double m_y;
-    double m_z;
-
-public:
-    Point3D(double x, double y, double z) : m_x{x}, m_y{y}, m_z{z} {};
-
-    // Getters
-    double x() const { return m_x; }
-    double y() const { return m_y; }
-    double z() const { return m_z; }
-
-    // Setters
-    void setX(double x) { m_x = x; }
-    void setY(double y) { m_y = y; }
-    void setZ(double z) { m_z = z; }
-
-    // Methods
-    double distanceTo(const Point3D& other) const
-    {
-        return std::sqrt(
-              (m_x - other.x()) * (m_x - other.x())
-            + (m_y - other.y()) * (m_y - other.y())
-            + (m_z - other.z()) * (m_z - other.z())
-        );
-    }
-
-    Point3D cross(const Point3D& other) const
+    constexpr Point cross(const Point& other) const requires (N == 3)
     {
         return {
-            m_y * other.z() - m_z * other.y(),
-            m_z * other.x() - m_x * other.z(),
-            m_x * other.y() - m_y * other.x()
+            m_coords[1] * other.m_coords[2] - m_coords[2] * other.m_coords[1],
+            m_coords[2] * other.m_coords[0] - m_coords[0] * other.m_coords[2],
+            m_coords[0] * other.m_coords[1] - m_coords[1] * other.m_coords[0]
         };
-    };
+    }
 
-    Point3D operator-(const Point3D& other) const
+    constexpr Point operator-(const Point& other) const
     {
-        return Point3D(m_x - other.x(), m_y - other.y(), m_z - other.z());
+        Point result { *this };
+        result -= other;
+        return result;
     }
 
-    Point3D operator-(const double& value) const
+    constexpr Point operator-(const T& value) const
     {
-        return Point3D(m_x - value, m_y - value, m_z - value);
+        Point result { *this };
+        for (std::size_t d = 0; d < N; ++d) { result.m_coords[d] -= value; }
+        return result;
     }
 
-    Point3D operator+(const Point3D& other) const
+    constexpr Point operator+(const Point& other) const
     {
-        return Point3D(m_x + other.x(), m_y + other.y(), m_z + other.z());
+        Point result { *this };
+        result += other;
+        return result;
     }
 
-
-    Point3D operator*(const double scalar)
+    constexpr Point operator*(const T& scalar) const
     {
-        return Point3D(scalar * m_x, scalar * m_y, scalar * m_z);
+        Point result { *this };
+        result *= scalar;
+        return result;
     }
 
-    Point3D operator/(const double scalar)
+    constexpr Point operator/(const T& scalar) const
     {
-        return Point3D(m_x / scalar, m_y / scalar, m_z / scalar);
+        Point result { *this };
+        for (std::size_t d = 0; d < N; ++d) { result.m_coords[d] /= scalar; }
+        return result;
     }
 
-    bool operator==(const Point3D& other) const
+    constexpr bool operator==(const Point& other) const { return m_coords == other.m_coords; }
+
+    constexpr Point& operator+=(const Point& other)
     {
-        return m_x == other.x() && m_y == other.y() && m_z == other.z();
+        for (std::size_t d = 0; d < N; ++d) { m_coords[d] += other.m_coords[d]; }
+        return *this;
     }
 
-    void operator+=(const Point3D& other)
+    constexpr Point& operator-=(const Point& other)
     {
-        m_x += other.x();
-        m_y += other.y();
-        m_z += other.z();
+        for (std::size_t d = 0; d < N; ++d) { m_coords[d] -= other.m_coords[d]; }
+        return *this;
     }
 
-    void operator-=(const Point3D& other)
+    constexpr Point& operator*=(const T& scalar)
     {
-        m_x -= other.x();
-        m_y -= other.y();
-        m_z -= other.z();
+        for (std::size_t d = 0; d < N; ++d) { m_coords[d] *= scalar; }
+        return *this;
     }
 
     void normalize()
     {
-        double magnitude { this->magnitude() };
-        m_x /= magnitude;
-        m_y /= magnitude;
-        m_z /= magnitude;
+        const T magnitude { this->magnitude() };
+        for (std::size_t d = 0; d < N; ++d) { m_coords[d] /= magnitude; }
     }
-
-    double magnitude() { return std::sqrt(m_x*m_x + m_y*m_y + m_z*m_z);}
 };
 
-// overload scalar multiplication, but to make it commutative we define it outside the Point2D class
-Point3D operator*(const double scalar, const Point3D& point);
+// overload scalar multiplication, but to make it work in `scalar * Point` direction we define it outside the Point class
+// (type_identity so that the scalar does not take part in the deduction, `2 * point` works for a double point)
+template <std::size_t N, typename T>
+constexpr Point<N, T> operator*(const std::type_identity_t<T>& scalar, const Point<N, T>& point)
+{
+    return point * scalar;
+}
+
+using Point2D = Point<2>;
+using Point3D = Point<3>;
 
 // Structs below
 
-// this struct allows the user to place a charged particle in the domain and holds the charge and 2D position of the particle
-struct ChargedParticle2D
+// this struct holds the magnitude and unit vector of a field
+template <std::size_t N, typename T = double>
+struct Field
 {
-    const double charge; // C
-    const double mass; // kg
-    Point2D position; // m
-    Point3D velocity; // m/s
+    T magnitude; // V/m or T
+    Point<N, T> direction; // unit vector
+};
+
+// this struct allows the user to place a charged particle in the domain and holds the charge and position of the particle
+template <std::size_t N, typename T = double>
+struct ChargedParticle
+{
+    T charge; // C (not const, so particle vectors can be compacted and merged particles updated in place, see Population)
+    T mass; // kg
+    Point<N, T> position; // m
+    Point<3, T> velocity; // m/s (always 3 components, in 2D vz is carried along)
+    std::uint64_t id { 0 }; // stays with the particle when the store is reordered (input index, then in order of injection)
 
-    bool operator==(const ChargedParticle2D& other) const
+    constexpr bool operator==(const ChargedParticle& other) const
     {
         return charge == other.charge &&
                 mass == other.mass &&
@@ -202,6 +163,11 @@ struct ChargedParticle2D
     }
 };
 
+using Field2D = Field<2>;
+using Field3D = Field<3>;
+using ChargedParticle2D = ChargedParticle<2>;
+using ChargedParticle3D = ChargedParticle<3>;
+
 // this struct allows the user to place an infinite wire in the domain and holds the current, 2D position of the wire, and the direction of the wire
 struct InfiniteWire2D
 {
@@ -210,26 +176,7 @@ struct InfiniteWire2D
     Point3D direction; // unit vector
 };
 
-// this struct holds the magnitude and unit vector of a 2D field
-struct Field2D
-{
-    double magnitude; // V/m or T
-    Point2D direction; // unit vector
-};
-
-// this struct allows the user to place a charged particle in the domain and holds the charge and 3D position of the particle
-struct ChargedParticle3D
-{
-    const double charge; // C
-    const double mass; // kg
-    Point3D position; // m
-    Point3D velocity; // m/s
-
-    bool operator==(const ChargedParticle3D& other) const
-    {
-        return charge == other.charge &&
-                mass == other.mass &&
-                position == other.position &&
-                velocity == other.velocity;
-    }
-};
+// compile-time checks of the arithmetic
+static_assert(Point2D {1., 2.} + Point2D {3., 4.} == Point2D {4., 6.});
+static_assert((2. * Point3D {1., 2., 3.}).dot(Point3D {1., 0., 0.}) == 2.);
+static_assert(Point3D {1., 0., 0.}.cross(Point3D {0., 1., 0.}) == Point3D {0., 0., 1.});
@@ -0,0 +1,294 @@
+#include "Population.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+
+#include "../Generators/Generators.hpp"
+
+namespace
+{
+    // particles injected by a source up to step `iteration` (floor(rate * steps) over the steps after `start`)
+    std::size_t injectedUntil(const Utilities::Source& source, const std::size_t& iteration)
+    {
+        if (iteration <= source.start) { return 0; }
+
+        const std::size_t last { source.stop > 0 ? std::min(iteration, std::max(source.stop, source.start)) : iteration };
+        return static_cast<std::size_t>(std::floor(source.rate * static_cast<double>(last - source.start)));
+    };
+
+    // particles injected by a source in step `iteration`
+    std::size_t injectedInStep(const Utilities::Source& source, const std::size_t& iteration)
+    {
+        return iteration == 0 ? 0 : injectedUntil(source, iteration) - injectedUntil(source, iteration - 1);
+    };
+
+    // position inside the domain (the merged center of mass of a pair across a periodic wall can land outside of it)
+    double wrap(const double& x, const double& bound)
+    {
+        return std::abs(x) >= bound ? x - Utilities::sign<double>(x) * 2 * bound : x;
+    };
+};
+
+Population::Population(const Utilities::Config& config, const std::uint64_t& firstId)
+    : m_config {config}
+    , m_firstId {firstId}
+{
+};
+
+template <std::size_t N>
+void Population::absorb(const std::vector<ChargedParticle<N>>& particles)
+{
+    if (!m_config.absorbing) { return; }
+
+    // the steps leave a particle that hit a wall exactly on it
+    for (std::size_t i = 0; i < particles.size(); ++i)
+    {
+        for (std::size_t d = 0; d < N; ++d)
+        {
+            if (std::abs(particles[i].position[d]) >= m_config.bound)
+            {
+                m_taken[i] = 1;
+                m_removed.push_back(i);
+                ++m_absorbed;
+                break;
+            }
+        }
+    }
+};
+
+template <std::size_t N>
+void Population::findCollisions(const std::vector<ChargedParticle<N>>& particles)
+{
+    const std::size_t numParticles { particles.size() };
+    const double radius { m_config.collisionRadius };
+    const double radius2 { radius * radius };
+
+    // cells at least a radius wide, so a partner is always in one of the neighbouring cells
+    // (and no more cells than particles, a tiny radius only makes the cells sparse)
+    std::size_t cellsPerSide { std::max<std::size_t>(static_cast<std::size_t>(2 * m_config.bound / radius), 1) };
+    const std::size_t maxCellsPerSide { std::max<std::size_t>(static_cast<std::size_t>(std::pow(static_cast<double>(numParticles), 1. / static_cast<double>(N))), 1) };
+    cellsPerSide = std::min(cellsPerSide, maxCellsPerSide);
+    const double cellSize { 2 * m_config.bound / static_cast<double>(cellsPerSide) };
+
+    std::size_t numCells { 1 };
+    for (std::size_t d = 0; d < N; ++d) { numCells *= cellsPerSide; }
+
+    const auto cellCoordinate = [&](const double& x)
+    {
+        return std::min(static_cast<std::size_t>(std::max((x + m_config.bound) / cellSize, 0.)), cellsPerSide - 1);
+    };
+
+    // counting sort of the particles by cell (in index order within a cell)
+    m_cellOf.resize(numParticles);
+    m_cellStart.assign(numCells + 1, 0);
+    for (std::size_t i = 0; i < numParticles; ++i)
+    {
+        std::size_t cell { 0 };
+        for (std::size_t d = 0; d < N; ++d) { cell = cell * cellsPerSide + cellCoordinate(particles[i].position[d]); }
+        m_cellOf[i] = cell;
+        ++m_cellStart[cell + 1];
+    }
+    for (std::size_t c = 0; c < numCells; ++c) { m_cellStart[c + 1] += m_cellStart[c]; }
+    m_cellParticles.resize(numParticles);
+    {
+        std::vector<std::size_t> next(m_cellStart.begin(), m_cellStart.end() - 1);
+        for (std::size_t i = 0; i < numParticles; ++i) { m_cellParticles[next[m_cellOf[i]]++] = i; }
+    }
+
+    // the neighbouring cells along one dimension (wrapped if periodic, each cell once when there are fewer than three)
+    const auto neighbours = [&](const std::size_t& coordinate, std::array<std::size_t, 3>& cells)
+    {
+        std::size_t count { 0 };
+        for (int offset = -1; offset <= 1; ++offset)
+        {
+            const long long side { static_cast<long long>(cellsPerSide) };
+            long long cell { static_cast<long long>(coordinate) + offset };
+            if (m_config.periodic) { cell = (cell + side) % side; }
+            else if (cell < 0 || cell >= side) { continue; }
+
+            if (std::find(cells.begin(), cells.begin() + count, static_cast<std::size_t>(cell)) == cells.begin() + count)
+            {
+                cells[count++] = static_cast<std::size_t>(cell);
+            }
+        }
+        return count;
+    };
+
+    // matched in index order: each particle takes the closest free opposite charge within the radius (ties: the lower index)
+    for (std::size_t i = 0; i < numParticles; ++i)
+    {
+        if (m_taken[i] || particles[i].charge == 0.) { continue; }
+
+        // the up to 3^N cells around the particle's cell
+        std::array<std::size_t, 27> around {};
+        std::size_t numAround { 1 };
+        for (std::size_t d = 0; d < N; ++d)
+        {
+            std::size_t divisor { 1 };
+            for (std::size_t e = d + 1; e < N; ++e) { divisor *= cellsPerSide; }
+
+            std::array<std::size_t, 3> cells {};
+            const std::size_t count { neighbours(m_cellOf[i] / divisor % cellsPerSide, cells) };
+            // expanded in place from the back, so every entry is read before it is overwritten
+            for (std::size_t a = numAround; a-- > 0;)
+            {
+                const std::size_t base { around[a] * cellsPerSide };
+                for (std::size_t c = 0; c < count; ++c) { around[a * count + c] = base + cells[c]; }
+            }
+            numAround *= count;
+        }
+
+        std::size_t partner { numParticles };
+        double closest { radius2 };
+        for (std::size_t a = 0; a < numAround; ++a)
+        {
+            for (std::size_t k = m_cellStart[around[a]]; k < m_cellStart[around[a] + 1]; ++k)
+            {
+                const std::size_t j { m_cellParticles[k] };
+                if (j == i || m_taken[j] || particles[i].charge * particles[j].charge >= 0.) { continue; }
+
+                const double r2 { Utilities::r_prime(particles[i].position, particles[j].position, m_config.periodic, m_config.bound).magnitudeSquared() };
+                if (r2 < closest || (r2 == closest && j < partner))
+                {
+                    closest = r2;
+                    partner = j;
+                }
+            }
+        }
+
+        if (partner < numParticles)
+        {
+            m_taken[i] = 1;
+            m_taken[partner] = 1;
+            m_pairs.emplace_back(std::min(i, partner), std::max(i, partner));
+        }
+    }
+};
+
+template <std::size_t N>
+void Population::collide(std::vector<ChargedParticle<N>>& particles, std::vector<std::uint8_t>& levels)
+{
+    if (m_config.collisions == Utilities::Collisions::none) { return; }
+
+    findCollisions(particles);
+
+    for (const auto& [i, j] : m_pairs)
+    {
+        if (m_config.collisions == Utilities::Collisions::annihilate)
+        {
+            m_removed.push_back(i);
+            m_removed.push_back(j);
+            m_collided += 2;
+            continue;
+        }
+
+        // i becomes the merged particle (and keeps its id): center of mass and total momentum
+        ChargedParticle<N>& first { particles[i] };
+        const ChargedParticle<N>& second { particles[j] };
+        const double mass { first.mass + second.mass };
+        const double share { second.mass / mass };
+
+        const Point<N> separation { Utilities::r_prime(second.position, first.position, m_config.periodic, m_config.bound) };
+        Point<N> position { first.position + share * separation };
+        if (m_config.periodic)
+        {
+            for (std::size_t d = 0; d < N; ++d) { position[d] = wrap(position[d], m_config.bound); }
+        }
+
+        first.velocity = (first.mass * first.velocity + second.mass * second.velocity) * (1. / mass);
+        first.position = position;
+        first.charge += second.charge;
+        first.mass = mass;
+
+        // the smaller of the two steps
+        if (levels.size() == particles.size()) { levels[i] = std::max(levels[i], levels[j]); }
+
+        m_removed.push_back(j);
+        ++m_collided;
+    }
+};
+
+template <std::size_t N>
+void Population::compact(std::vector<ChargedParticle<N>>& particles, std::vector<Point<N>>& acceleration, std::vector<std::uint8_t>& levels)
+{
+    const bool hasLevels { levels.size() == particles.size() };
+
+    std::sort(m_removed.begin(), m_removed.end(), std::greater<std::size_t>());
+    for (const std::size_t& i : m_removed)
+    {
+        const std::size_t last { particles.size() - 1 };
+        if (i != last)
+        {
+            particles[i] = particles[last];
+            acceleration[i] = acceleration[last];
+            if (hasLevels) { levels[i] = levels[last]; }
+        }
+        particles.pop_back();
+        acceleration.pop_back();
+        if (hasLevels) { levels.pop_back(); }
+    }
+};
+
+template <std::size_t N>
+void Population::inject(const std::size_t& iteration, std::vector<ChargedParticle<N>>& particles, std::vector<Point<N>>& acceleration, std::vector<std::uint8_t>& levels)
+{
+    const bool hasLevels { levels.size() == particles.size() };
+
+    // ids in order of injection: everything the sources injected before this step, then source by source
+    std::uint64_t id { m_firstId };
+    for (const Utilities::Source& source : m_config.sources) { id += injectedUntil(source, iteration > 0 ? iteration - 1 : 0); }
+
+    for (std::size_t s = 0; s < m_config.sources.size(); ++s)
+    {
+        const Utilities::Source& source { m_config.sources[s] };
+        const std::size_t count { injectedInStep(source, iteration) };
+        if (count == 0) { continue; }
+
+        const double lower[3] { source.box.xMin, source.box.yMin, source.box.zMin };
+        const double upper[3] { source.box.xMax, source.box.yMax, source.box.zMax };
+        const double thermalSpeed { std::sqrt(std::max(source.temperature, 0.) / source.mass) };
+
+        // a stream apart from the generators' (which use the particle index and generator number)
+        Philox random { m_config.seed, iteration, 0x40000000u | static_cast<std::uint32_t>(s) };
+        for (std::size_t k = 0; k < count; ++k)
+        {
+            Point<N> position;
+            for (std::size_t d = 0; d < N; ++d) { position[d] = lower[d] + (upper[d] - lower[d]) * random.uniform(); }
+
+            Point3D velocity { source.drift };
+            if (thermalSpeed > 0.)
+            {
+                for (std::size_t d = 0; d < N; ++d) { velocity[d] += thermalSpeed * random.normal(); }
+            }
+
+            particles.emplace_back(ChargedParticle<N>{source.charge, source.mass, position, velocity, id++});
+            acceleration.emplace_back();
+            // a new particle starts on the smallest step, like every particle of a new run
+            if (hasLevels) { levels.push_back(static_cast<std::uint8_t>(m_config.timestepLevels)); }
+        }
+        m_injected += count;
+    }
+};
+
+template <std::size_t N>
+bool Population::update(const std::size_t& iteration, std::vector<ChargedParticle<N>>& particles, std::vector<Point<N>>& acceleration,
+                        std::vector<std::uint8_t>& levels)
+{
+    m_injected = 0;
+    m_absorbed = 0;
+    m_collided = 0;
+    m_removed.clear();
+    m_pairs.clear();
+    m_taken.assign(particles.size(), 0);
+
+    absorb(particles);
+    collide(particles, levels);
+    compact(particles, acceleration, levels);
+    inject(iteration, particles, acceleration, levels);
+    return m_injected + removed() > 0;
+};
+
+template bool Population::update<2>(const std::size_t&, std::vector<ChargedParticle2D>&, std::vector<Point2D>&, std::vector<std::uint8_t>&);
+template bool Population::update<3>(const std::size_t&, std::vector<ChargedParticle3D>&, std::vector<Point3D>&, std::vector<std::uint8_t>&);
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "../Points/Points.hpp"
+#include "../Utilities/Utilities.hpp"
+
+/*
+Particles that enter and leave a run, applied after every step (DynamicPhysics::evolve):
+
+"absorbing": true                   non-periodic walls remove the particles that reach them (instead of reflecting them)
+"collisions": "annihilate"/"merge"  a particle and the closest opposite charge within the "collision radius" are removed ("annihilate")
+                                    or become one particle with the summed charge and mass at their center of mass, with their total
+                                    momentum ("merge", an ion and an electron recombine into a neutral particle that keeps drifting)
+"sources": [...]                    inject "rate" particles per step (fractions add up over the steps) uniformly in their "box"
+                                    with Maxwellian velocities of "temperature" plus "drift" (same keys as the generators)
+
+The collision partners are found on a cell list (cells at least a collision radius wide), the particles are matched in index order,
+so the same state always gives the same pairs. Removed particles are compacted by swapping the last particle into their slot (O(1)
+each), the accelerations and time-step levels are swapped along with them. After a step that changed the population the
+accelerations of every particle are solved again (the survivors' still hold the pull of the removed charges, which would throw the
+momentum off balance in the next velocity update), so sources that inject every step cost a second force solve per step.
+Source s draws step n's particles from its own Philox stream (seed, n), so a restarted run injects the same particles (with the same
+ids, numbered on from the input particles in the order of injection, a merged particle keeps the id of the lower index).
+*/
+
+// Applies the absorbing walls, the collisions and the sources to the particles of a run, keeping the per-particle
+// integrator state (accelerations, time-step levels) in the same order as the particles.
+class Population
+{
+private:
+    const Utilities::Config& m_config;
+    const std::uint64_t m_firstId; // of the first injected particle
+
+    // scratch of the last update
+    std::vector<std::uint8_t> m_taken; // absorbed or already in a collision
+    std::vector<std::size_t> m_removed;
+    std::vector<std::pair<std::size_t, std::size_t>> m_pairs; // colliding (i, j), i < j
+    std::vector<std::size_t> m_cellStart; // cell list: the particles of cell c are m_cellParticles[m_cellStart[c] .. m_cellStart[c+1])
+    std::vector<std::size_t> m_cellParticles;
+    std::vector<std::size_t> m_cellOf;
+
+    // of the last update
+    std::size_t m_injected { 0 };
+    std::size_t m_absorbed { 0 };
+    std::size_t m_collided { 0 }; // particles removed by collisions (a merge removes one, an annihilation two)
+
+    template <std::size_t N>
+    void absorb(const std::vector<ChargedParticle<N>>& particles);
+    template <std::size_t N>
+    void findCollisions(const std::vector<ChargedParticle<N>>& particles);
+    template <std::size_t N>
+    void collide(std::vector<ChargedParticle<N>>& particles, std::vector<std::uint8_t>& levels);
+    // swap-removes m_removed (sorted from the back so that the particle swapped in is never one still to be removed)
+    template <std::size_t N>
+    void compact(std::vector<ChargedParticle<N>>& particles, std::vector<Point<N>>& acceleration, std::vector<std::uint8_t>& levels);
+    template <std::size_t N>
+    void inject(const std::size_t& iteration, std::vector<ChargedParticle<N>>& particles, std::vector<Point<N>>& acceleration, std::vector<std::uint8_t>& levels);
+
+public:
+    // the injected particles' ids start at `firstId` (the number of input particles)
+    Population(const Utilities::Config& config, const std::uint64_t& firstId);
+
+    Population(const Population&) = delete;
+    Population& operator=(const Population&) = delete;
+
+    bool enabled() const { return !m_config.sources.empty() || m_config.absorbing || m_config.collisions != Utilities::Collisions::none; }
+
+    // applies the rules after step `iteration` and returns whether any particle was injected or removed, the caller then has to solve
+    // the accelerations again (merged and injected particles hold a placeholder). `levels` is only kept in step when it has one per particle
+    template <std::size_t N>
+    bool update(const std::size_t& iteration, std::vector<ChargedParticle<N>>& particles, std::vector<Point<N>>& acceleration,
+                std::vector<std::uint8_t>& levels);
+
+    // Getters (of the last update)
+    std::size_t injected() const { return m_injected; }
+    std::size_t removed() const { return m_absorbed + m_collided; }
+};
@@ -0,0 +1,149 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    const char* s_phaseNames[] { "setup", "force", "push", "field", "write", "diagnostics", "checkpoint", "population", "sort" };
+    const char* s_counterNames[] { "particle steps", "force evaluations", "pair interactions", "grid points", "injected particles", "removed particles" };
+
+    // nearest rank percentile of sorted samples
+    double percentile(const std::vector<double>& sorted, const double& p)
+    {
+        if (sorted.empty()) { return 0.; }
+        const std::size_t rank { static_cast<std::size_t>(std::ceil(p / 100. * static_cast<double>(sorted.size()))) };
+        return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+    };
+
+    double rate(const double& amount, const double& seconds)
+    {
+        return seconds > 0. ? amount / seconds : 0.;
+    };
+};
+
+Profiler::Profiler(const Utilities::Config& config)
+    : m_config {config}
+    , m_start {std::chrono::steady_clock::now()}
+    , m_stepsStart {m_start}
+    , m_lastProgress {m_start}
+{
+    // the particles were read (or generated) with the config, before the run existed
+    m_totals[static_cast<std::size_t>(Phase::setup)] = config.loadSeconds;
+};
+
+void Profiler::add(const Phase& phase, const double& seconds)
+{
+    const std::size_t p { static_cast<std::size_t>(phase) };
+    m_totals[p] += seconds;
+    m_step[p] += seconds;
+    m_inStep[p] = true;
+};
+
+void Profiler::endSetup()
+{
+    const std::size_t p { static_cast<std::size_t>(Phase::setup) };
+    m_totals[p] += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+};
+
+void Profiler::startSteps()
+{
+    m_stepsStart = std::chrono::steady_clock::now();
+    m_lastProgress = m_stepsStart;
+
+    // the first frame and diagnostics row (before the first step) are samples of their own
+    for (std::size_t p = 0; p < s_numPhases; ++p)
+    {
+        if (m_inStep[p]) { m_samples[p].push_back(m_step[p]); }
+        m_step[p] = 0.;
+        m_inStep[p] = false;
+    }
+};
+
+void Profiler::endStep()
+{
+    for (std::size_t p = 0; p < s_numPhases; ++p)
+    {
+        if (m_inStep[p]) { m_samples[p].push_back(m_step[p]); }
+        m_step[p] = 0.;
+        m_inStep[p] = false;
+    }
+    ++m_steps;
+};
+
+bool Profiler::progressDue(const std::size_t& iteration)
+{
+    const auto now { std::chrono::steady_clock::now() };
+    if (iteration + 1 < m_config.numSteps && std::chrono::duration<double>(now - m_lastProgress).count() < m_config.progressSeconds) { return false; }
+
+    m_lastProgress = now;
+    return true;
+};
+
+void Profiler::progress(std::ostream& out, const std::size_t& iteration) const
+{
+    const double elapsed { std::chrono::duration<double>(std::chrono::steady_clock::now() - m_stepsStart).count() };
+    const double stepsPerSecond { rate(static_cast<double>(m_steps), elapsed) };
+    const std::size_t lastIteration { m_config.numSteps > 0 ? m_config.numSteps - 1 : 0 };
+    const double remaining { stepsPerSecond > 0. ? static_cast<double>(lastIteration - std::min(iteration, lastIteration)) / stepsPerSecond : 0. };
+
+    out << "Current iteration: " << iteration << " of " << lastIteration << " (" << std::fixed << std::setprecision(1)
+        << 100. * static_cast<double>(iteration) / static_cast<double>(std::max<std::size_t>(lastIteration, 1)) << "%), "
+        << std::setprecision(2) << stepsPerSecond << " steps/s, eta " << std::setprecision(1) << remaining << " s" << std::defaultfloat;
+};
+
+void Profiler::write(const std::size_t& numParticles, const std::vector<std::pair<std::string, std::size_t>>& bytesWritten) const
+{
+    const auto now { std::chrono::steady_clock::now() };
+    const double wall { std::chrono::duration<double>(now - m_start).count() + m_config.loadSeconds };
+    const double stepSeconds { std::chrono::duration<double>(now - m_stepsStart).count() };
+
+    nlohmann::json _j;
+    _j["seconds"] = wall;
+    _j["steps"] = m_steps;
+    _j["particles"] = numParticles;
+    _j["threads"] = omp_get_max_threads();
+
+    _j["phases"] = nlohmann::json::object();
+    for (std::size_t p = 0; p < s_numPhases; ++p)
+    {
+        std::vector<double> sorted { m_samples[p] };
+        std::sort(sorted.begin(), sorted.end());
+
+        nlohmann::json phase;
+        phase["seconds"] = m_totals[p];
+        phase["fraction"] = rate(m_totals[p], wall);
+        if (p != static_cast<std::size_t>(Phase::setup))
+        {
+            phase["steps"] = sorted.size();
+            phase["p50"] = percentile(sorted, 50.);
+            phase["p90"] = percentile(sorted, 90.);
+            phase["p99"] = percentile(sorted, 99.);
+            phase["max"] = sorted.empty() ? 0. : sorted.back();
+        }
+        _j["phases"][s_phaseNames[p]] = phase;
+    }
+
+    std::size_t totalBytes { 0 };
+    _j["counters"] = nlohmann::json::object();
+    for (std::size_t c = 0; c < s_numCounters; ++c) { _j["counters"][s_counterNames[c]] = m_counters[c]; }
+    _j["counters"]["bytes written"] = nlohmann::json::object();
+    for (const auto& [output, bytes] : bytesWritten)
+    {
+        _j["counters"]["bytes written"][output] = bytes;
+        totalBytes += bytes;
+    }
+
+    _j["throughput"] = nlohmann::json::object();
+    _j["throughput"]["particle steps/s"] = rate(static_cast<double>(counter(Counter::particleSteps)), stepSeconds);
+    _j["throughput"]["pair interactions/s"] = rate(static_cast<double>(counter(Counter::pairInteractions)), total(Phase::force));
+    _j["throughput"]["grid points/s"] = rate(static_cast<double>(counter(Counter::gridPoints)), total(Phase::field));
+    _j["throughput"]["bytes/s"] = rate(static_cast<double>(totalBytes), wall);
+
+    std::filesystem::create_directories(std::filesystem::path(path()).parent_path());
+    std::ofstream file(path());
+    if (!file.is_open())
+    {
+        throw std::ios_base::failure("Failed to open file for writing: " + path());
+    }
+    file << _j.dump(4) << '\n';
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../Utilities/Utilities.hpp"
+
+/*
+Run profile (`<output directory>/<output filename>_profile.json`, "profile": false turns it off), written at the end of a run:
+
+    seconds         wall time from the construction of the run to the end
+    phases          per phase: total seconds, share of the wall time, steps it ran in and the p50/p90/p99/max of its time per step
+    counters        particle steps, force evaluations (accelerations of single particles), pair interactions (direct: every pair,
+                    barnes-hut: accepted nodes and leaf pairs, ewald/pppm: real space pairs within the cutoff, particle-mesh: none),
+                    grid points of the field evaluations, particles injected and removed (see Population.hpp) and bytes written
+                    (frames, checkpoints, diagnostics)
+    throughput      particle steps/s (wall time of the steps), pair interactions/s (force time), grid points/s (field time) and written bytes/s
+*/
+
+// Scoped wall-clock timers and counters for the phases of a run. A timer is two steady_clock reads and the counters are
+// plain additions on the step thread, so the profile is always on; the per-step times are kept for the percentiles.
+class Profiler
+{
+public:
+    enum class Phase : std::size_t
+    {
+        setup, // reading the particles and building the world (grid, wire field, initial accelerations)
+        force, // accelerations from the force solver
+        push, // position and velocity updates
+        field, // grid electric field for the frames and diagnostics
+        write, // handing frames to the writer thread (and waiting for it)
+        diagnostics,
+        checkpoint, // copying the state for the checkpoint writer
+        population, // absorbing walls, collisions and sources (see Population.hpp)
+        sort, // reordering the particles along the space-filling curve (see SpatialSort.hpp)
+        count,
+    };
+
+    enum class Counter : std::size_t
+    {
+        particleSteps,
+        forceEvaluations,
+        pairInteractions,
+        gridPoints,
+        injectedParticles,
+        removedParticles,
+        count,
+    };
+
+    // adds the time from its construction to its destruction to a phase of the current step
+    class Scope
+    {
+    private:
+        Profiler& m_profiler;
+        Phase m_phase;
+        std::chrono::steady_clock::time_point m_start;
+
+    public:
+        Scope(Profiler& profiler, const Phase& phase) : m_profiler {profiler}, m_phase {phase}, m_start {std::chrono::steady_clock::now()} {}
+        ~Scope() { m_profiler.add(m_phase, std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count()); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+private:
+    static constexpr std::size_t s_numPhases { static_cast<std::size_t>(Phase::count) };
+    static constexpr std::size_t s_numCounters { static_cast<std::size_t>(Counter::count) };
+
+    const Utilities::Config& m_config;
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::time_point m_stepsStart; // first step (the run loop)
+    std::chrono::steady_clock::time_point m_lastProgress;
+
+    std::array<double, s_numPhases> m_totals {};
+    std::array<double, s_numPhases> m_step {}; // time of the current step
+    std::array<bool, s_numPhases> m_inStep {};
+    std::array<std::vector<double>, s_numPhases> m_samples; // time per step, for the percentiles
+    std::array<std::size_t, s_numCounters> m_counters {};
+    std::size_t m_steps { 0 };
+
+public:
+    explicit Profiler(const Utilities::Config& config);
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    void add(const Phase& phase, const double& seconds);
+    void count(const Counter& counter, const std::size_t& amount) { m_counters[static_cast<std::size_t>(counter)] += amount; }
+
+    // the world is built (grid, wire field, initial accelerations), the setup phase ends
+    void endSetup();
+    // the steps begin (after the first frame)
+    void startSteps();
+    // closes the current step (its phase times become samples of the percentiles)
+    void endStep();
+
+    // rate-limited console progress: true at most every "progress seconds" of wall time (and for the last step)
+    bool progressDue(const std::size_t& iteration);
+    // "iteration i of n (p%), x steps/s, eta t s"
+    void progress(std::ostream& out, const std::size_t& iteration) const;
+
+    // the json profile, `bytesWritten` holds the bytes of each output ("frames", "checkpoints", ...)
+    void write(const std::size_t& numParticles, const std::vector<std::pair<std::string, std::size_t>>& bytesWritten) const;
+
+    // Getters
+    std::string path() const { return m_config.outputDirectory + "/" + m_config.outputFilename + "_profile.json"; }
+    double total(const Phase& phase) const { return m_totals[static_cast<std::size_t>(phase)]; }
+    std::size_t counter(const Counter& counter) const { return m_counters[static_cast<std::size_t>(counter)]; }
+};
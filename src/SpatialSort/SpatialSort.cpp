@@ -0,0 +1,171 @@
+#include "SpatialSort.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+    constexpr unsigned s_maxBits { 21 }; // 3 * 21 bits fit a 64 bit key
+
+    // Skilling's transform of the cell coordinates into the transposed Hilbert index (J. Skilling, "Programming the Hilbert curve",
+    // AIP Conf. Proc. 707, 381 (2004)), the index is then read off bit plane by bit plane like a Morton key
+    template <std::size_t N>
+    void hilbertTranspose(std::uint32_t (&X)[N], const unsigned& bits)
+    {
+        const std::uint32_t M { std::uint32_t {1} << (bits - 1) };
+
+        // inverse undo
+        for (std::uint32_t Q = M; Q > 1; Q >>= 1)
+        {
+            const std::uint32_t P { Q - 1 };
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                if (X[i] & Q) { X[0] ^= P; }
+                else
+                {
+                    const std::uint32_t t { (X[0] ^ X[i]) & P };
+                    X[0] ^= t;
+                    X[i] ^= t;
+                }
+            }
+        }
+
+        // Gray encode
+        for (std::size_t i = 1; i < N; ++i) { X[i] ^= X[i - 1]; }
+        std::uint32_t t { 0 };
+        for (std::uint32_t Q = M; Q > 1; Q >>= 1)
+        {
+            if (X[N - 1] & Q) { t ^= Q - 1; }
+        }
+        for (std::size_t i = 0; i < N; ++i) { X[i] ^= t; }
+    };
+};
+
+SpatialSort::SpatialSort(const double& bound, const std::size_t& numPoints, const Utilities::SortCurve& curve)
+    : m_bound {bound}
+    , m_curve {curve}
+    , m_bits { std::clamp(static_cast<unsigned>(std::ceil(std::log2(static_cast<double>(std::max<std::size_t>(numPoints, 2))))), 1u, s_maxBits) }
+{
+};
+
+template <std::size_t N>
+std::uint64_t SpatialSort::key(const Point<N>& position) const
+{
+    const std::uint32_t cells { std::uint32_t {1} << m_bits };
+    const double scale { static_cast<double>(cells) / (2 * m_bound) };
+
+    std::uint32_t X[N];
+    for (std::size_t d = 0; d < N; ++d)
+    {
+        // particles on (or, between the steps, beyond) a wall belong to its cell
+        const double cell { std::floor((position[d] + m_bound) * scale) };
+        X[d] = static_cast<std::uint32_t>(std::clamp(cell, 0., static_cast<double>(cells - 1)));
+    }
+
+    if (m_curve == Utilities::SortCurve::hilbert) { hilbertTranspose<N>(X, m_bits); }
+
+    // interleaved from the highest bit plane down, the first dimension most significant
+    std::uint64_t key { 0 };
+    for (unsigned bit = m_bits; bit-- > 0;)
+    {
+        for (std::size_t d = 0; d < N; ++d) { key = (key << 1) | ((X[d] >> bit) & 1u); }
+    }
+    return key;
+};
+
+void SpatialSort::radixSort(const unsigned& keyBits)
+{
+    constexpr std::size_t buckets { std::size_t {1} << s_digitBits };
+    const std::size_t n { m_keys.size() };
+
+    m_order.resize(n);
+    std::iota(m_order.begin(), m_order.end(), std::size_t {0});
+    m_keyScratch.resize(n);
+    m_orderScratch.resize(n);
+    m_counts.resize(static_cast<std::size_t>(std::max(omp_get_max_threads(), 1)) * buckets);
+
+    for (unsigned shift = 0; shift < keyBits; shift += s_digitBits)
+    {
+        bool skip { false };
+
+        #pragma omp parallel if(n >= s_parallelMin)
+        {
+            // each thread owns a fixed range, so the order doesn't depend on the scheduling
+            const std::size_t numThreads { static_cast<std::size_t>(omp_get_num_threads()) };
+            const std::size_t thread { static_cast<std::size_t>(omp_get_thread_num()) };
+            const std::size_t begin { n * thread / numThreads };
+            const std::size_t end { n * (thread + 1) / numThreads };
+            std::size_t* counts { m_counts.data() + thread * buckets };
+
+            std::fill(counts, counts + buckets, std::size_t {0});
+            for (std::size_t i = begin; i < end; ++i) { ++counts[(m_keys[i] >> shift) & (buckets - 1)]; }
+
+            #pragma omp barrier
+            #pragma omp single
+            {
+                // a digit's slots go to the threads in order, which keeps the sort stable
+                std::size_t offset { 0 };
+                for (std::size_t digit = 0; digit < buckets; ++digit)
+                {
+                    std::size_t total { 0 };
+                    for (std::size_t t = 0; t < numThreads; ++t)
+                    {
+                        std::size_t& count { m_counts[t * buckets + digit] };
+                        const std::size_t threadCount { count };
+                        count = offset;
+                        offset += threadCount;
+                        total += threadCount;
+                    }
+                    // every key has this digit, the pass would leave the order as it is
+                    skip = skip || total == n;
+                }
+            }
+
+            if (!skip)
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    const std::size_t slot { counts[(m_keys[i] >> shift) & (buckets - 1)]++ };
+                    m_keyScratch[slot] = m_keys[i];
+                    m_orderScratch[slot] = m_order[i];
+                }
+            }
+        }
+
+        if (!skip)
+        {
+            m_keys.swap(m_keyScratch);
+            m_order.swap(m_orderScratch);
+        }
+    }
+};
+
+template <std::size_t N>
+bool SpatialSort::sort(std::vector<ChargedParticle<N>>& particles, std::vector<Point<N>>& acceleration, std::vector<std::uint8_t>& levels)
+{
+    const std::size_t n { particles.size() };
+
+    m_keys.resize(n);
+    #pragma omp parallel for schedule(static) if(n >= s_parallelMin)
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        m_keys[i] = key<N>(particles[i].position);
+    }
+
+    radixSort(static_cast<unsigned>(N) * m_bits);
+
+    bool moved { false };
+    for (std::size_t k = 0; k < n && !moved; ++k) { moved = m_order[k] != k; }
+    if (!moved) { return false; }
+
+    permute(particles);
+    permute(acceleration);
+    permute(levels);
+    return true;
+};
+
+template std::uint64_t SpatialSort::key<2>(const Point2D&) const;
+template std::uint64_t SpatialSort::key<3>(const Point3D&) const;
+template bool SpatialSort::sort<2>(std::vector<ChargedParticle2D>&, std::vector<Point2D>&, std::vector<std::uint8_t>&);
+template bool SpatialSort::sort<3>(std::vector<ChargedParticle3D>&, std::vector<Point3D>&, std::vector<std::uint8_t>&);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../Points/Points.hpp"
+#include "../Utilities/Utilities.hpp"
+
+/*
+Reordering of the particle store along a space-filling curve ("sort interval": every that many steps, "sort curve": "hilbert"/"morton"):
+
+every particle gets the curve index of the grid cell it is in (2^b cells per side, b = ceil(log2(grid points)), at most 21) and the
+particles are stably sorted by it with a parallel LSD radix sort (8 bit digits, per-thread histograms, a digit all keys share is
+skipped). Particles that are close in space are then close in memory, so the force solvers' tree walks, mesh assignments and cell
+lists touch neighbouring cache lines instead of jumping through the whole store. The accelerations and time-step levels are
+permuted along with the particles, the particles carry their `id` (frames and checkpoints keep it) to follow one through a run.
+
+The order only depends on the positions and the previous order (the sort is stable and the threads own fixed ranges), so a run
+sorts the same way for any number of threads and after a restart.
+*/
+
+// Sorts particles by the space-filling curve index of their grid cell, keeping the permutation for the per-particle arrays.
+class SpatialSort
+{
+private:
+    double m_bound;
+    Utilities::SortCurve m_curve;
+    unsigned m_bits; // per dimension
+
+    std::vector<std::uint64_t> m_keys;
+    std::vector<std::uint64_t> m_keyScratch;
+    std::vector<std::size_t> m_order; // m_order[k]: index of the particle that goes to k
+    std::vector<std::size_t> m_orderScratch;
+    std::vector<std::size_t> m_counts; // digit histogram of each thread
+
+    // stable sort of m_order by m_keys (the lowest `keyBits` bits)
+    void radixSort(const unsigned& keyBits);
+
+public:
+    static constexpr unsigned s_digitBits { 8 };
+    static constexpr std::size_t s_parallelMin { 1 << 14 }; // smaller stores are sorted by one thread
+
+    SpatialSort(const double& bound, const std::size_t& numPoints, const Utilities::SortCurve& curve);
+
+    SpatialSort(const SpatialSort&) = delete;
+    SpatialSort& operator=(const SpatialSort&) = delete;
+
+    // curve index of the cell of `position` (N * bits() bits)
+    template <std::size_t N>
+    std::uint64_t key(const Point<N>& position) const;
+
+    // sorts `particles` and permutes `acceleration` and `levels` the same way (unless they don't have one entry per particle),
+    // returns whether any particle moved
+    template <std::size_t N>
+    bool sort(std::vector<ChargedParticle<N>>& particles, std::vector<Point<N>>& acceleration, std::vector<std::uint8_t>& levels);
+
+    // values[k] = values[order()[k]], for other arrays in the order of the last sort
+    template <typename T>
+    void permute(std::vector<T>& values) const;
+
+    // Getters
+    unsigned bits() const { return m_bits; }
+    const std::vector<std::size_t>& order() const { return m_order; }
+};
+
+template <typename T>
+void SpatialSort::permute(std::vector<T>& values) const
+{
+    if (values.size() != m_order.size()) { return; }
+
+    std::vector<T> sorted(values.size());
+    const std::size_t* order { m_order.data() };
+    #pragma omp parallel for schedule(static) if(values.size() >= s_parallelMin)
+    for (std::size_t k = 0; k < values.size(); ++k)
+    {
+        sorted[k] = values[order[k]];
+    }
+    values.swap(sorted);
+};
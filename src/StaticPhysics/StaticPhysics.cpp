@@ -1,103 +1,468 @@
 #include "StaticPhysics.hpp"
 
-StaticPhysics::StaticPhysics(const std::size_t& dim, const double& bound, const std::size_t& numPoints): m_geometry{dim, bound, numPoints} {};
+StaticPhysics<2>::StaticPhysics(const Utilities::Config& config, SharedGrid<2> shared)
+    : m_config{config}
+    , m_geometry{shared.geometry ? std::move(shared.geometry) : std::make_shared<const Geometry<2>>(config.bound, config.numPoints)}
+    , m_B_shared{std::move(shared.B_field)}
+    , m_particle_mesh{config.bound, config.numPoints, config.periodic, config.assignment, config.forceSolver == Utilities::ForceSolver::particleMesh}
+    , m_multigrid{config}
+    , m_text_writer{",", config.textPrecision, config.textThreads}
+{};
 
-void StaticPhysics::calculateElectricField(std::vector<ChargedParticle2D>& particles, const bool& initialize)
+void StaticPhysics<2>::calculateElectricField(std::vector<ChargedParticle2D>& particles)
 {
+    // the conductors and walls have a field without any particles as well
+    if (m_config.forceSolver == Utilities::ForceSolver::multigrid)
+    {
+        m_multigrid.solve(particles);
+        m_multigrid.fillField(m_E_field);
+        return;
+    }
+
     if (particles.empty()) { return; };
 
-    if (initialize)
+    if (m_config.forceSolver == Utilities::ForceSolver::particleMesh)
+    {
+        m_particle_mesh.solve(particles);
+        m_particle_mesh.fillField(m_E_field);
+        return;
+    }
+
+    // stage the particles as structure-of-arrays so the kernel can stream them
+    m_sourceX.resize(particles.size());
+    m_sourceY.resize(particles.size());
+    m_sourceCharge.resize(particles.size());
+    for (std::size_t i = 0; i < particles.size(); ++i)
     {
-        // initialize the electric field at each point in the domain/grid
-        m_E_field.reserve(m_geometry.grid2D().size() * particles.size());
+        m_sourceX[i] = particles[i].position.x();
+        m_sourceY[i] = particles[i].position.y();
+        m_sourceCharge[i] = particles[i].charge;
     }
-    // else
-    // {
-    //     m_E_field.clear();
-    // }
 
     // accumulate the electric field at each point in the domain/grid coming from each charged particle
-    // #pragma omp parallel for
-    for (std::size_t idx = 0; idx < m_geometry.grid2D().size(); ++idx)
+    FieldKernels::pointChargeField(m_geometry->gridX(), m_geometry->gridY(), m_sourceX.data(), m_sourceY.data(), m_sourceCharge.data(), particles.size(), m_config.periodic, m_config.bound, m_E_field);
+};
+
+void StaticPhysics<2>::clearElectricField()
+{
+    // emptied first, resize only zeroes the new entries
+    m_E_field = {};
+    m_E_field.resize(m_geometry->numGridPoints());
+};
+
+std::vector<Point2D> StaticPhysics<2>::calculateMeshAcceleration(const std::vector<ChargedParticle2D>& particles)
+{
+    m_particle_mesh.solve(particles);
+
+    return m_particle_mesh.calculateAcceleration(particles);
+};
+
+void StaticPhysics<2>::updateMeshElectricField()
+{
+    if (m_config.forceSolver == Utilities::ForceSolver::multigrid) { m_multigrid.fillField(m_E_field); }
+    else { m_particle_mesh.fillField(m_E_field); }
+};
+
+std::vector<Point2D> StaticPhysics<2>::calculateMultigridAcceleration(const std::vector<ChargedParticle2D>& particles)
+{
+    m_multigrid.solve(particles);
+
+    return m_multigrid.calculateAcceleration(particles);
+};
+
+void StaticPhysics<2>::calculateInfiniteWireMagneticField(std::vector<InfiniteWire2D>& wires)
+{
+    if (m_B_shared) { return; };
+
+    calculateInfiniteWireMagneticField(*m_geometry, wires, m_B_field);
+};
+
+void StaticPhysics<2>::calculateInfiniteWireMagneticField(const Geometry<2>& geometry, const std::vector<InfiniteWire2D>& wires, FieldStore2D& B_field)
+{
+    if (wires.empty()) { return; };
+
+    std::vector<double> wireX, wireY, current, directionX, directionY, directionZ;
+    for (const InfiniteWire2D& wire : wires)
+    {
+        wireX.push_back(wire.position.x());
+        wireY.push_back(wire.position.y());
+        current.push_back(wire.current);
+        directionX.push_back(wire.direction.x());
+        directionY.push_back(wire.direction.y());
+        directionZ.push_back(wire.direction.z());
+    }
+
+    // accumulate the magnetic field at each point in the domain/grid coming from each wire
+    FieldKernels::infiniteWireField(geometry.gridX(), geometry.gridY(), wireX.data(), wireY.data(), current.data(), directionX.data(), directionY.data(), directionZ.data(), wires.size(), B_field);
+};
+
+namespace
+{
+    // values[points[k]] for every k
+    void gather(const AlignedVector& values, const std::vector<std::size_t>& points, AlignedVector& gathered)
     {
-        if (initialize)
+        gathered.resize(points.size());
+        for (std::size_t k = 0; k < points.size(); ++k) { gathered[k] = values[points[k]]; }
+    };
+
+    // nodes of the axis that are written: every `stride`-th one inside [min, max]
+    std::vector<std::size_t> selectAxis(const AlignedVector& axis, const std::size_t& stride, const double& min, const double& max)
+    {
+        std::vector<std::size_t> nodes;
+        for (std::size_t i = 0; i < axis.size(); i += std::max<std::size_t>(stride, 1))
         {
-            m_E_field.emplace_back(Field2D {0., Point2D {0., 0.}});
+            if (axis[i] >= min && axis[i] <= max) { nodes.push_back(i); }
         }
-        else
+        return nodes;
+    };
+
+    std::vector<const AlignedVector*> frameComponents(const Frame& frame)
+    {
+        std::vector<const AlignedVector*> components;
+        for (const AlignedVector& component : frame.components) { components.push_back(&component); }
+        return components;
+    };
+
+    // csv columns: `leading`, `components`, then `trailing`
+    std::vector<const AlignedVector*> textColumns(const std::vector<const AlignedVector*>& leading, const std::vector<const AlignedVector*>& components, const std::vector<const AlignedVector*>& trailing)
+    {
+        std::vector<const AlignedVector*> columns { leading };
+        columns.insert(columns.end(), components.begin(), components.end());
+        columns.insert(columns.end(), trailing.begin(), trailing.end());
+        return columns;
+    };
+
+    std::string outputPath(const Utilities::Config& config, const std::string& filename, const std::string& ext)
+    {
+        return config.outputDirectory + "/" + filename + "." + ext;
+    };
+};
+
+void StaticPhysics<2>::writeFields(const std::string& filename, const std::string ext, const std::string delimiter)
+{
+    TextFrameWriter writer { delimiter, m_config.textPrecision, m_config.textThreads };
+    writer.write(outputPath(m_config, filename, ext), textColumns({&m_geometry->gridX(), &m_geometry->gridY()}, m_E_field.components(), B_field().components()));
+};
+
+void StaticPhysics<2>::selectOutputPoints()
+{
+    const std::size_t numPoints { m_geometry->numPoints() + 1 };
+    const Utilities::Box& box { m_config.outputBox };
+
+    // x only depends on the first index and y on the second, so the kept points form a (smaller) grid again
+    const std::vector<std::size_t> rows { selectAxis(m_geometry->axis(), m_config.outputStride, box.xMin, box.xMax) };
+    const std::vector<std::size_t> columns { selectAxis(m_geometry->axis(), m_config.outputStride, box.yMin, box.yMax) };
+
+    m_output_points.clear();
+    if (rows.empty() || columns.empty())
+    {
+        std::cerr << "No grid points in the output box! Writing the whole grid..." << std::endl;
+    }
+    else if (rows.size() < numPoints || columns.size() < numPoints)
+    {
+        m_output_points.reserve(rows.size() * columns.size());
+        for (const std::size_t& i : rows)
+        {
+            for (const std::size_t& j : columns) { m_output_points.push_back(i * numPoints + j); }
+        }
+    }
+
+    m_output_nx = m_output_points.empty() ? numPoints : rows.size();
+    m_output_ny = m_output_points.empty() ? numPoints : columns.size();
+};
+
+const FieldStore2D& StaticPhysics<2>::outputField(const FieldStore2D& field, FieldStore2D& gathered) const
+{
+    if (m_output_points.empty() || field.empty()) { return field; }
+
+    gather(field.magnitude, m_output_points, gathered.magnitude);
+    gather(field.x, m_output_points, gathered.x);
+    gather(field.y, m_output_points, gathered.y);
+    return gathered;
+};
+
+void StaticPhysics<2>::writeFrame(const std::size_t& iteration, const std::vector<ChargedParticle2D>& particles)
+{
+    if (!m_async_writer.isRunning())
+    {
+        selectOutputPoints();
+        const FieldStore2D& B_field { outputField(this->B_field(), m_B_output) };
+
+        if (m_config.outputFormat == Utilities::OutputFormat::csv)
         {
-            m_E_field[idx].magnitude = 0.;
-            m_E_field[idx].direction.setX(0.);
-            m_E_field[idx].direction.setY(0.);
+            // gathered once here, the writer thread only reads the columns
+            gather(m_geometry->gridX(), m_output_points, m_output_grid[0]);
+            gather(m_geometry->gridY(), m_output_points, m_output_grid[1]);
+            m_grid_columns = m_output_points.empty() ? std::vector<const AlignedVector*> {&m_geometry->gridX(), &m_geometry->gridY()}
+                                                     : std::vector<const AlignedVector*> {&m_output_grid[0], &m_output_grid[1]};
+            m_B_columns = B_field.components();
+
+            m_async_writer.start([this](const Frame& frame)
+            {
+                m_text_bytes += m_text_writer.write(outputPath(m_config, m_config.outputFilename + "_" + std::to_string(frame.iteration), "txt"), textColumns(m_grid_columns, frameComponents(frame), m_B_columns));
+            }, m_config.outputQueue);
         }
-        
-        
-        for (ChargedParticle2D& particle : particles)
+        else
         {
-            const Point2D point { m_geometry.grid2D()[idx] };
-            Point2D r_prime { Utilities::r_prime(point, particle.position) };
-            
-            double r { r_prime.magnitude() };
-            int sign { particle.charge < 0 ? -1 : 1 }; // negative charge means the electric field points towards the charge
-
-            m_E_field[idx].magnitude += particle.charge / (r*r);
-            m_E_field[idx].direction.setX( m_E_field[idx].direction.x() + sign * r_prime.x() / r );
-            m_E_field[idx].direction.setY( m_E_field[idx].direction.y() + sign * r_prime.y() / r );
-        };
-
-        // normalize the unit vector
-        m_E_field[idx].direction.normalize();
+            std::vector<std::string> names;
+            if (!m_E_field.empty()) { names.push_back("E"); }
+            std::vector<std::string> staticNames;
+            std::vector<const AlignedVector*> staticComponents;
+            if (!B_field.empty()) { staticNames.push_back("B"); staticComponents = B_field.components(); }
+
+            AlignedVector gridX;
+            AlignedVector gridY;
+            gather(m_geometry->gridX(), m_output_points, gridX);
+            gather(m_geometry->gridY(), m_output_points, gridY);
+
+            // opened here so that a bad output path fails right away instead of on the writer thread
+            const std::string path { outputPath(m_config, m_config.outputFilename, "cemf") };
+            if (!m_resume || !m_frame_writer.resume(path, 2, {m_output_nx, m_output_ny}, m_geometry->bound(), names, staticNames, m_config.compression, m_resume_iteration))
+            {
+                if (m_resume) { std::cerr << "No matching run file to continue at " << path << "! Starting a new one..." << std::endl; }
+                m_frame_writer.open(path, 2, {m_output_nx, m_output_ny}, m_geometry->bound(),
+                                    {m_output_points.empty() ? &m_geometry->gridX() : &gridX, m_output_points.empty() ? &m_geometry->gridY() : &gridY},
+                                    names, staticNames, staticComponents, m_config.compression);
+            }
+            m_async_writer.start([this](const Frame& frame)
+            {
+                m_frame_writer.writeFrame(frame.iteration, frame.time, frameComponents(frame), frame.particles);
+            }, m_config.outputQueue);
+        }
+    }
+
+    // only the electric field changes from frame to frame
+    std::vector<const AlignedVector*> components;
+    if (!m_E_field.empty()) { components = outputField(m_E_field, m_E_output).components(); }
+
+    m_particle_state.resize(particles.size());
+    for (std::size_t i = 0; i < particles.size(); ++i)
+    {
+        m_particle_state.x[i] = particles[i].position.x();
+        m_particle_state.y[i] = particles[i].position.y();
+        m_particle_state.vx[i] = particles[i].velocity.x();
+        m_particle_state.vy[i] = particles[i].velocity.y();
+        m_particle_state.id[i] = particles[i].id;
+    }
+
+    m_async_writer.submit(iteration, static_cast<double>(iteration) * m_config.dt, components, m_particle_state);
+};
+
+void StaticPhysics<2>::resumeOutput(const std::size_t& iteration)
+{
+    m_resume = true;
+    m_resume_iteration = iteration;
+};
+
+void StaticPhysics<2>::flushOutput()
+{
+    if (!m_async_writer.isRunning()) { return; }
+
+    // the writer thread is idle once drained, so the run file can be flushed from here
+    m_async_writer.drain();
+    m_frame_writer.flush();
+};
+
+void StaticPhysics<2>::closeOutput()
+{
+    if (!m_async_writer.isRunning()) { return; }
+
+    m_async_writer.finish();
+    m_frame_writer.close();
+    if (m_config.verbose) { m_async_writer.report(std::cout); }
+};
+
+void StaticPhysics<2>::run(std::vector<ChargedParticle2D>& particles, std::vector<InfiniteWire2D>& wires)
+{
+    if (m_config.verbose) { std::cout << "Run starting!" << std::endl; }
+
+    calculateElectricField(particles);
+    calculateInfiniteWireMagneticField(wires);
+    if (m_config.outputFormat == Utilities::OutputFormat::csv)
+    {
+        writeFields(m_config.outputFilename);
+    }
+    else
+    {
+        writeFrame(0, particles);
+        closeOutput();
+    }
+
+    if (m_config.verbose) { std::cout << "Run complete!" << std::endl; }
+};
+
+StaticPhysics<3>::StaticPhysics(const Utilities::Config& config, SharedGrid<3> shared)
+    : m_config{config}
+    , m_geometry{shared.geometry ? std::move(shared.geometry) : std::make_shared<const Geometry<3>>(config.bound, config.numPoints)}
+    , m_text_writer{",", config.textPrecision, config.textThreads}
+{
+    selectOutputPoints();
+};
+
+void StaticPhysics<3>::selectOutputPoints()
+{
+    const Utilities::Box& box { m_config.outputBox };
+    const std::array<std::vector<std::size_t>, 3> nodes
+    {
+        selectAxis(m_geometry->axis(), m_config.outputStride, box.xMin, box.xMax),
+        selectAxis(m_geometry->axis(), m_config.outputStride, box.yMin, box.yMax),
+        selectAxis(m_geometry->axis(), m_config.outputStride, box.zMin, box.zMax),
     };
+
+    const bool empty { nodes[0].empty() || nodes[1].empty() || nodes[2].empty() };
+    if (empty)
+    {
+        std::cerr << "No grid points in the output box! Writing the whole grid..." << std::endl;
+    }
+
+    for (std::size_t d = 0; d < 3; ++d)
+    {
+        if (empty) { m_output_axes[d] = m_geometry->axis(); }
+        else { gather(m_geometry->axis(), nodes[d], m_output_axes[d]); }
+    }
 };
 
-void StaticPhysics::calculateInfiniteWireMagneticField(std::vector<InfiniteWire2D>& wires)
+AlignedVector StaticPhysics<3>::outputCoordinates(std::size_t d) const
 {
-    if (wires.empty()) { return; };
+    const std::size_t numY { m_output_axes[1].size() };
+    const std::size_t numZ { m_output_axes[2].size() };
 
-    // initialize the magnetic field at each point in the domain/grid
-    m_B_field.reserve(m_geometry.grid2D().size());
+    // idx = (i * numY + j) * numZ + k
+    AlignedVector coordinates(m_output_axes[0].size() * numY * numZ);
+    for (std::size_t idx = 0; idx < coordinates.size(); ++idx)
+    {
+        const std::size_t node { d == 0 ? idx / (numY * numZ) : (d == 1 ? (idx / numZ) % numY : idx % numZ) };
+        coordinates[idx] = m_output_axes[d][node];
+    }
+    return coordinates;
+};
 
-    // accumulate the magnetic field at each point in the domain/grid coming from each wire
-    // #pragma omp parallel for
-    for (std::size_t idx = 0; idx < m_geometry.grid2D().size(); ++idx)
+void StaticPhysics<3>::calculateElectricField(std::vector<ChargedParticle3D>& particles)
+{
+    if (particles.empty()) { return; };
+
+    // stage the particles as structure-of-arrays so the kernel can stream them
+    m_sourceX.resize(particles.size());
+    m_sourceY.resize(particles.size());
+    m_sourceZ.resize(particles.size());
+    m_sourceCharge.resize(particles.size());
+    for (std::size_t i = 0; i < particles.size(); ++i)
+    {
+        m_sourceX[i] = particles[i].position.x();
+        m_sourceY[i] = particles[i].position.y();
+        m_sourceZ[i] = particles[i].position.z();
+        m_sourceCharge[i] = particles[i].charge;
+    }
+
+    FieldKernels::pointChargeField3D(m_output_axes[0], m_output_axes[1], m_output_axes[2], m_sourceX.data(), m_sourceY.data(), m_sourceZ.data(), m_sourceCharge.data(), particles.size(), m_config.periodic, m_config.bound, m_E_field);
+};
+
+void StaticPhysics<3>::clearElectricField()
+{
+    m_E_field = {};
+    m_E_field.resize(m_output_axes[0].size() * m_output_axes[1].size() * m_output_axes[2].size());
+};
+
+void StaticPhysics<3>::writeFields(const std::string& filename, const std::string ext, const std::string delimiter)
+{
+    const std::array<AlignedVector, 3> coordinates { outputCoordinates(0), outputCoordinates(1), outputCoordinates(2) };
+    TextFrameWriter writer { delimiter, m_config.textPrecision, m_config.textThreads };
+    writer.write(outputPath(m_config, filename, ext), textColumns({&coordinates[0], &coordinates[1], &coordinates[2]}, m_E_field.components(), {}));
+};
+
+void StaticPhysics<3>::writeFrame(const std::size_t& iteration, const std::vector<ChargedParticle3D>& particles)
+{
+    if (!m_async_writer.isRunning())
     {
-        m_B_field.emplace_back(Field2D {0., Point2D {0., 0.}});
-        
-        for (InfiniteWire2D wire : wires)
+        if (m_config.outputFormat == Utilities::OutputFormat::csv)
+        {
+            // built once here, the writer thread only reads them
+            for (std::size_t d = 0; d < 3; ++d) { m_output_coordinates[d] = outputCoordinates(d); }
+            m_async_writer.start([this](const Frame& frame)
+            {
+                m_text_bytes += m_text_writer.write(outputPath(m_config, m_config.outputFilename + "_" + std::to_string(frame.iteration), "txt"),
+                                                    textColumns({&m_output_coordinates[0], &m_output_coordinates[1], &m_output_coordinates[2]}, frameComponents(frame), {}));
+            }, m_config.outputQueue);
+        }
+        else
         {
-        const Point2D point { m_geometry.grid2D()[idx] };
-            double r { wire.position.distanceTo(point) };
+            std::vector<std::string> names;
+            if (!m_E_field.empty()) { names.push_back("E"); }
 
-            Point2D r_prime_2D { (point - wire.position) };
-            Point3D components { wire.direction.cross(Point3D {r_prime_2D.x()/r_prime_2D.magnitude(), r_prime_2D.y()/r_prime_2D.magnitude(), 0.}) };
+            // the grid is written once, one coordinate array at a time is enough
+            const std::array<AlignedVector, 3> coordinates { outputCoordinates(0), outputCoordinates(1), outputCoordinates(2) };
 
-            m_B_field[idx].magnitude += wire.current / (2 * Constants::pi * r) * components.magnitude();
-            m_B_field[idx].direction.setX( m_B_field[idx].direction.x() + components.x() / r );
-            m_B_field[idx].direction.setY( m_B_field[idx].direction.y() + components.y() / r );
-        };
-        // normalize the unit vector
-        m_B_field[idx].direction.normalize();
+            // opened here so that a bad output path fails right away instead of on the writer thread
+            const std::string path { outputPath(m_config, m_config.outputFilename, "cemf") };
+            const std::vector<std::size_t> shape { m_output_axes[0].size(), m_output_axes[1].size(), m_output_axes[2].size() };
+            if (!m_resume || !m_frame_writer.resume(path, 3, shape, m_geometry->bound(), names, {}, m_config.compression, m_resume_iteration))
+            {
+                if (m_resume) { std::cerr << "No matching run file to continue at " << path << "! Starting a new one..." << std::endl; }
+                m_frame_writer.open(path, 3, shape, m_geometry->bound(), {&coordinates[0], &coordinates[1], &coordinates[2]}, names, {}, {}, m_config.compression);
+            }
+            m_async_writer.start([this](const Frame& frame)
+            {
+                m_frame_writer.writeFrame(frame.iteration, frame.time, frameComponents(frame), frame.particles);
+            }, m_config.outputQueue);
+        }
+    }
 
-    };
+    std::vector<const AlignedVector*> components;
+    if (!m_E_field.empty()) { components = m_E_field.components(); }
+
+    m_particle_state.resize(particles.size(), 3);
+    for (std::size_t i = 0; i < particles.size(); ++i)
+    {
+        m_particle_state.x[i] = particles[i].position.x();
+        m_particle_state.y[i] = particles[i].position.y();
+        m_particle_state.z[i] = particles[i].position.z();
+        m_particle_state.vx[i] = particles[i].velocity.x();
+        m_particle_state.vy[i] = particles[i].velocity.y();
+        m_particle_state.vz[i] = particles[i].velocity.z();
+        m_particle_state.id[i] = particles[i].id;
+    }
+
+    m_async_writer.submit(iteration, static_cast<double>(iteration) * m_config.dt, components, m_particle_state);
+};
+
+void StaticPhysics<3>::resumeOutput(const std::size_t& iteration)
+{
+    m_resume = true;
+    m_resume_iteration = iteration;
 };
 
-void StaticPhysics::writeFields(const std::string& filename, const std::string ext, const std::string delimiter)
+void StaticPhysics<3>::flushOutput()
 {
-    // first, write the grid points to file
-    m_geometry.writeGrid(filename, ext, delimiter);
+    if (!m_async_writer.isRunning()) { return; }
 
-    Utilities::appendToEndOfLine(filename, ext, delimiter, m_E_field);
-    Utilities::appendToEndOfLine(filename, ext, delimiter, m_B_field);
+    // the writer thread is idle once drained, so the run file can be flushed from here
+    m_async_writer.drain();
+    m_frame_writer.flush();
+};
+
+void StaticPhysics<3>::closeOutput()
+{
+    if (!m_async_writer.isRunning()) { return; }
 
+    m_async_writer.finish();
+    m_frame_writer.close();
+    if (m_config.verbose) { m_async_writer.report(std::cout); }
 };
 
-void StaticPhysics::run(std::vector<ChargedParticle2D>& particles, std::vector<InfiniteWire2D>& wires)
+void StaticPhysics<3>::run(std::vector<ChargedParticle3D>& particles)
 {
-    std::cout << "Run starting!" << std::endl;
+    if (m_config.verbose) { std::cout << "Run starting!" << std::endl; }
 
-    calculateElectricField(particles, true);
-    calculateInfiniteWireMagneticField(wires);
-    writeFields(Utilities::outputFilename);
+    calculateElectricField(particles);
+    if (m_config.outputFormat == Utilities::OutputFormat::csv)
+    {
+        writeFields(m_config.outputFilename);
+    }
+    else
+    {
+        writeFrame(0, particles);
+        closeOutput();
+    }
 
-    std::cout << "Run complete!" << std::endl;
+    if (m_config.verbose) { std::cout << "Run complete!" << std::endl; }
 };
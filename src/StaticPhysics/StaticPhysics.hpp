@@ -1,44 +1,172 @@
 #pragma once
 
+#include <memory>
+
 #include "../Geometry/Geometry.hpp"
 #include "../Utilities/Utilities.hpp"
 #include "../Constants/Constants.hpp"
+#include "../ParticleMesh/ParticleMesh.hpp"
+#include "../Multigrid/Multigrid.hpp"
+#include "../Output/Output.hpp"
 
 // Idea(?): Make an electrostatics class that has this stuff and then electrodynamics class and then the `Physics` class will instantiate whichever one is needed
 
-class StaticPhysics
+// The read-only part of a run that does not depend on the particles: runs on the same grid (and wires) share it instead of
+// building it again (Ensemble). Anything left empty is built by StaticPhysics itself.
+template <std::size_t N>
+struct SharedGrid
+{
+    std::shared_ptr<const Geometry<N>> geometry;
+    std::shared_ptr<const FieldStore2D> B_field; // 2D: magnetic field of the wires on the geometry's grid
+};
+
+// The 2D and 3D physics are specializations (StaticPhysics<2>, StaticPhysics<3>) with the same interface towards DynamicPhysics<N>:
+// calculateElectricField, writeFrame, closeOutput and geometry.
+// Every setting is read from the run's Config (kept by reference), nothing is global, so several runs can exist at once.
+template <std::size_t N>
+class StaticPhysics;
+
+template <>
+class StaticPhysics<2>
 {
 private:
-    Geometry m_geometry;
+    const Utilities::Config& m_config;
+    std::shared_ptr<const Geometry<2>> m_geometry;
 
     // 2D Physics
-    std::vector<Field2D> m_E_field; // {magnitude V/m , unit vector components}
-    std::vector<Field2D> m_B_field; // {magnitude T , unit vector components}
+    FieldStore2D m_E_field; // {magnitude V/m , unit vector components}
+    FieldStore2D m_B_field; // {magnitude T , unit vector components}
+    std::shared_ptr<const FieldStore2D> m_B_shared; // magnetic field handed in by the SharedGrid (used instead of m_B_field)
 
-public:
-    // 2D Methods
+    // particle positions/charges staged as structure-of-arrays for the field kernel
+    std::vector<double> m_sourceX;
+    std::vector<double> m_sourceY;
+    std::vector<double> m_sourceCharge;
 
-    // Constructor for 2D
-    StaticPhysics(const std::size_t& dim, const double& bound, const std::size_t& numPoints);
+    ParticleMesh m_particle_mesh; // only built and used with the "particle-mesh" force solver
+    Multigrid m_multigrid; // only built and used with the "multigrid" force solver
+    FrameWriter m_frame_writer; // only used with the binary output format (opened on the first frame)
+    AsyncFrameWriter m_async_writer; // writes the frames in the background (must be destroyed before m_frame_writer)
+    ParticleState m_particle_state; // staging for the particle part of a frame
+    bool m_resume { false }; // the run file of a restarted run is continued instead of created
+    std::size_t m_text_bytes { 0 }; // csv frames written (by the writer thread, read once it is done)
+    std::size_t m_resume_iteration { 0 }; // iteration of the checkpoint the run restarted from
+
+    // The magnetic field of the (static) wires is written once when the output starts, frames only carry the electric field
+    FieldStore2D m_B_output; // magnetic field gathered at the output points
+
+    // csv frames: grid x, y, the electric field of the frame, then the magnetic field columns (set when the output starts)
+    TextFrameWriter m_text_writer;
+    std::vector<const AlignedVector*> m_grid_columns;
+    std::vector<const AlignedVector*> m_B_columns;
+
+    // grid points written to the frames (output stride/box), chosen when the output starts
+    std::vector<std::size_t> m_output_points; // indices into the grid, empty when every grid point is written
+    std::size_t m_output_nx { 0 };
+    std::size_t m_output_ny { 0 };
+    FieldStore2D m_E_output; // electric field gathered at the output points
+    std::array<AlignedVector, 2> m_output_grid; // coordinates of the output points (empty when every grid point is written)
+
+    void selectOutputPoints();
+    // the field at the output points (the field itself when nothing is dropped)
+    const FieldStore2D& outputField(const FieldStore2D& field, FieldStore2D& gathered) const;
+
+public:
+    StaticPhysics(const Utilities::Config& config, SharedGrid<2> shared = {});
     // accumulates the electric field at each point in the domain (grid) for each charged particle
-    void calculateElectricField(std::vector<ChargedParticle2D>& particles, const bool& initialize);
+    void calculateElectricField(std::vector<ChargedParticle2D>& particles);
+    // zero field on the grid (a run without particles at the moment, e.g. before its sources fill it, still writes a field)
+    void clearElectricField();
+    // (nothing to do when the magnetic field was shared)
     void calculateInfiniteWireMagneticField(std::vector<InfiniteWire2D>& wires);
+    static void calculateInfiniteWireMagneticField(const Geometry<2>& geometry, const std::vector<InfiniteWire2D>& wires, FieldStore2D& B_field);
+    // particle-mesh solve: returns the accelerations interpolated back to the particles
+    std::vector<Point2D> calculateMeshAcceleration(const std::vector<ChargedParticle2D>& particles);
+    // grid electric field of the last particle-mesh or multigrid solve (only needed for the frames that are written)
+    void updateMeshElectricField();
+    // multigrid solve (warm started from the last one): returns the accelerations interpolated back to the particles
+    std::vector<Point2D> calculateMultigridAcceleration(const std::vector<ChargedParticle2D>& particles);
 
     // writes the electric/magnetic field to a file along with the grid points
     void writeFields(const std::string& filename, const std::string ext="txt", const std::string delimiter=",");
+    // hands a copy of the current electric field and particle state to the writer thread as the next frame, in the configured output format
+    // (the first frame also starts the output and writes the grid and magnetic field), only the output stride/box of the grid is written
+    void writeFrame(const std::size_t& iteration, const std::vector<ChargedParticle2D>& particles);
+    // the output starts by continuing the run file, the frames after `iteration` are dropped (restart from a checkpoint)
+    void resumeOutput(const std::size_t& iteration);
+    // waits for the queued frames to be written and flushes the run file (before a checkpoint, so it matches the run file)
+    void flushOutput();
+    // waits for the queued frames to be written and finishes the run file
+    void closeOutput();
 
     void run(std::vector<ChargedParticle2D>& particles, std::vector<InfiniteWire2D>& wires);
 
     // Getters
-    const std::vector<Field2D>& E_field() const { return m_E_field; }
-    const std::vector<Field2D>& B_field() const { return m_B_field; }
+    const FieldStore2D& E_field() const { return m_E_field; }
+    // bytes of the frames written so far (run file or csv files), only up to date after flushOutput/closeOutput
+    std::size_t bytesWritten() const { return m_frame_writer.bytesWritten() + m_text_bytes; }
+    const FieldStore2D& B_field() const { return m_B_shared ? *m_B_shared : m_B_field; }
+    const Geometry<2>& geometry() const { return *m_geometry; }
+    Multigrid& multigrid() { return m_multigrid; }
+};
+
+// 3D: the electric field is only ever needed for the frames, so it is evaluated on the output grid (output stride/box)
+// straight from the axes of that grid. Nothing is stored per grid point except the four field components
+// (a 201^3 grid is 8M points, 260 MB for the field, so decimating the output also shrinks the field work and memory).
+template <>
+class StaticPhysics<3>
+{
+private:
+    const Utilities::Config& m_config;
+    std::shared_ptr<const Geometry<3>> m_geometry;
 
-    // 3D Methods
+    // axes of the grid points that are written, chosen in the constructor
+    std::array<AlignedVector, 3> m_output_axes;
+    FieldStore3D m_E_field; // {magnitude V/m , unit vector components} at the output grid points
 
-    // For 3D: just overload the constructor and add a 3D version of ChargedParticle (probably not a good idea)
-    StaticPhysics(std::size_t& dim, double& bound, std::size_t& numPoints, std::vector<ChargedParticle3D>& particles);
+    // particle positions/charges staged as structure-of-arrays for the field kernel
+    std::vector<double> m_sourceX;
+    std::vector<double> m_sourceY;
+    std::vector<double> m_sourceZ;
+    std::vector<double> m_sourceCharge;
 
-    // Getters
-    const Geometry& geometry() const { return m_geometry; }
+    FrameWriter m_frame_writer; // only used with the binary output format (opened on the first frame)
+    AsyncFrameWriter m_async_writer; // writes the frames in the background (must be destroyed before m_frame_writer)
+    ParticleState m_particle_state; // staging for the particle part of a frame
+    bool m_resume { false }; // the run file of a restarted run is continued instead of created
+    std::size_t m_text_bytes { 0 }; // csv frames written (by the writer thread, read once it is done)
+    std::size_t m_resume_iteration { 0 }; // iteration of the checkpoint the run restarted from
+    TextFrameWriter m_text_writer; // csv frames
+    std::array<AlignedVector, 3> m_output_coordinates; // csv frames: x, y, z columns of the output points
+
+    void selectOutputPoints();
+    // coordinate `d` of every output grid point (only built for the static section of the run file and the csv columns)
+    AlignedVector outputCoordinates(std::size_t d) const;
 
+public:
+    StaticPhysics(const Utilities::Config& config, SharedGrid<3> shared = {});
+    // accumulates the electric field at each output grid point for each charged particle
+    void calculateElectricField(std::vector<ChargedParticle3D>& particles);
+    // zero field on the output grid
+    void clearElectricField();
+
+    // writes the electric field to a file along with the output grid points
+    void writeFields(const std::string& filename, const std::string ext="txt", const std::string delimiter=",");
+    // same as the 2D version: the electric field and particle state are handed to the writer thread as the next frame
+    void writeFrame(const std::size_t& iteration, const std::vector<ChargedParticle3D>& particles);
+    // the output starts by continuing the run file, the frames after `iteration` are dropped (restart from a checkpoint)
+    void resumeOutput(const std::size_t& iteration);
+    // waits for the queued frames to be written and flushes the run file (before a checkpoint, so it matches the run file)
+    void flushOutput();
+    // waits for the queued frames to be written and finishes the run file
+    void closeOutput();
+
+    void run(std::vector<ChargedParticle3D>& particles);
+
+    // Getters
+    const FieldStore3D& E_field() const { return m_E_field; }
+    // bytes of the frames written so far (run file or csv files), only up to date after flushOutput/closeOutput
+    std::size_t bytesWritten() const { return m_frame_writer.bytesWritten() + m_text_bytes; }
+    const std::array<AlignedVector, 3>& outputAxes() const { return m_output_axes; }
+    const Geometry<3>& geometry() const { return *m_geometry; }
 };
@@ -0,0 +1,140 @@
+#include "ThreadPool.hpp"
+
+namespace
+{
+    // the pool (and worker index) of the calling thread, so that tasks submitted from a task stay on their worker
+    thread_local const ThreadPool* s_pool { nullptr };
+    thread_local std::size_t s_worker { 0 };
+};
+
+ThreadPool::ThreadPool(const std::size_t& numThreads, std::function<void(std::size_t)> onStart)
+{
+    const std::size_t count { std::max<std::size_t>(numThreads, 1) };
+    for (std::size_t worker = 0; worker < count; ++worker)
+    {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+
+    m_workers.reserve(count);
+    for (std::size_t worker = 0; worker < count; ++worker)
+    {
+        m_workers.emplace_back([this, worker, onStart] { work(worker, onStart); });
+    }
+};
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock { m_mutex };
+        m_stopping = true;
+    }
+    m_taskQueued.notify_all();
+
+    // the workers finish whatever is still queued before they leave
+    for (std::thread& worker : m_workers) { worker.join(); }
+};
+
+void ThreadPool::submit(Task task)
+{
+    const std::size_t target { s_pool == this ? s_worker : m_next.fetch_add(1) % m_queues.size() };
+
+    // counted before it is visible in a deque, so a worker can never finish it (and decrement) before it was counted
+    {
+        std::lock_guard<std::mutex> lock { m_mutex };
+        ++m_queued;
+        ++m_pending;
+    }
+    {
+        std::lock_guard<std::mutex> lock { m_queues[target]->mutex };
+        m_queues[target]->tasks.push_back(std::move(task));
+    }
+    m_taskQueued.notify_one();
+};
+
+bool ThreadPool::take(const std::size_t& worker, Task& task)
+{
+    {
+        Queue& own { *m_queues[worker] };
+        std::lock_guard<std::mutex> lock { own.mutex };
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (std::size_t offset = 1; offset < m_queues.size(); ++offset)
+    {
+        Queue& victim { *m_queues[(worker + offset) % m_queues.size()] };
+        std::lock_guard<std::mutex> lock { victim.mutex };
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+
+            std::lock_guard<std::mutex> statsLock { m_mutex };
+            ++m_steals;
+            return true;
+        }
+    }
+
+    return false;
+};
+
+void ThreadPool::work(const std::size_t& worker, const std::function<void(std::size_t)>& onStart)
+{
+    s_pool = this;
+    s_worker = worker;
+    if (onStart) { onStart(worker); }
+
+    while (true)
+    {
+        Task task;
+        if (take(worker, task))
+        {
+            {
+                std::lock_guard<std::mutex> lock { m_mutex };
+                --m_queued;
+            }
+
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock { m_mutex };
+                if (!m_error) { m_error = std::current_exception(); }
+            }
+
+            std::lock_guard<std::mutex> lock { m_mutex };
+            if (--m_pending == 0) { m_allDone.notify_all(); }
+            continue;
+        }
+
+        // nothing to take anywhere: sleep until a task is queued (another worker may still grab it first, then look again)
+        std::unique_lock<std::mutex> lock { m_mutex };
+        m_taskQueued.wait(lock, [this] { return m_stopping || m_queued > 0; });
+        if (m_stopping && m_queued == 0) { return; }
+    }
+};
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock { m_mutex };
+    m_allDone.wait(lock, [this] { return m_pending == 0; });
+
+    if (m_error)
+    {
+        std::exception_ptr error { m_error };
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+};
+
+std::size_t ThreadPool::steals()
+{
+    std::lock_guard<std::mutex> lock { m_mutex };
+    return m_steals;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool for coarse tasks (whole runs of an ensemble, see Ensemble).
+// Every worker has its own deque: it takes its newest task from the back and, when that runs dry, steals the oldest task
+// from the front of another worker's deque, so long and short tasks even out without a central queue.
+// (The kernels inside a task still use OpenMP, `onStart` lets each worker set its own OpenMP thread count.)
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> m_queues; // one per worker
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex; // guards everything below
+    std::condition_variable m_taskQueued; // a task was submitted or the pool stops
+    std::condition_variable m_allDone; // m_pending dropped to 0
+    std::size_t m_queued { 0 }; // tasks sitting in the deques
+    std::size_t m_pending { 0 }; // tasks submitted and not finished yet
+    std::size_t m_steals { 0 };
+    bool m_stopping { false };
+    std::exception_ptr m_error; // first exception thrown by a task, rethrown by wait()
+
+    std::atomic<std::size_t> m_next { 0 }; // deque the next task from outside the pool goes to (round robin)
+
+    // own deque first (back), then the other deques (front)
+    bool take(const std::size_t& worker, Task& task);
+    void work(const std::size_t& worker, const std::function<void(std::size_t)>& onStart);
+
+public:
+    // `onStart(worker)` runs on each worker thread before its first task
+    explicit ThreadPool(const std::size_t& numThreads, std::function<void(std::size_t)> onStart = {});
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // tasks submitted from a worker go to the back of its own deque
+    void submit(Task task);
+
+    // blocks until every submitted task has finished and rethrows the first exception a task threw
+    void wait();
+
+    // Getters
+    std::size_t size() const { return m_workers.size(); }
+    std::size_t steals();
+};
@@ -1,13 +1,75 @@
 #include "Utilities.hpp"
 
+#include <chrono>
+
+#include "../Generators/Generators.hpp"
+#include "../ParticleInput/ParticleInput.hpp"
+
 namespace Utilities
 {
-    void initMessage()
+    void initMessage(const Config& config)
     {
         std::cout << '\n' << "############################################" << '\n';
         std::cout << "#            Initialized values            #" << '\n';
         std::cout << "############################################" << "\n\n";
-        std::cout << "dim: " << Utilities::dim << '\n' << "bound: " << Utilities::bound << '\n' << "numPoints: " << Utilities::numPoints << std::endl;
+        std::cout << "dim: " << config.dim << '\n' << "bound: " << config.bound << '\n' << "numPoints: " << config.numPoints << std::endl;
+        if (config.outputInterval == 0) { std::cout << "output: no frames" << '\n'; }
+        else
+        {
+            std::cout << "output: " << config.outputDirectory << '/' << config.outputFilename << (config.outputFormat == OutputFormat::binary ? ".cemf" : "_*.txt") << " (queue " << config.outputQueue << " frames)" << '\n';
+            std::cout << "output every " << config.outputInterval << " steps, every " << config.outputStride << " grid points in x [" << config.outputBox.xMin << ", " << config.outputBox.xMax << "], y [" << config.outputBox.yMin << ", " << config.outputBox.yMax << "]";
+            if (config.dim == 3) { std::cout << ", z [" << config.outputBox.zMin << ", " << config.outputBox.zMax << "]"; }
+            std::cout << '\n';
+            if (config.outputFormat == OutputFormat::csv)
+            {
+                std::cout << "csv numbers: " << (config.textPrecision > 0 ? std::to_string(config.textPrecision) + " significant digits" : "shortest round trip") << ", formatted by " << config.textThreads << " thread(s)" << '\n';
+            }
+        }
+        std::cout << "field kernels: " << FieldKernels::isaName(FieldKernels::activeISA()) << '\n';
+        std::cout << "force solver: ";
+        switch (config.forceSolver)
+        {
+            case ForceSolver::direct: std::cout << "direct"; break;
+            case ForceSolver::tiled: std::cout << "tiled direct sum"; break;
+            case ForceSolver::barnesHut: std::cout << "barnes-hut (opening angle " << config.theta << ")"; break;
+            case ForceSolver::particleMesh: std::cout << "particle-mesh (" << (config.periodic ? "periodic" : "isolated") << ")"; break;
+            case ForceSolver::ewald: std::cout << "ewald (tolerance " << config.ewaldTolerance << ")"; break;
+            case ForceSolver::pppm: std::cout << "pppm (tolerance " << config.ewaldTolerance << ")"; break;
+            case ForceSolver::multigrid:
+            {
+                std::cout << "multigrid (";
+                if (config.periodic) { std::cout << "periodic"; }
+                else if (config.boundary == Boundary::neumann) { std::cout << "neumann walls"; }
+                else { std::cout << "walls at " << config.boundaryPotential << " V"; }
+                std::cout << ", " << config.conductors.size() << " conductor(s), tolerance " << config.multigridTolerance << ")";
+                break;
+            }
+        }
+        std::cout << std::endl;
+        std::cout << "integrator: " << (config.integrator == Integrator::boris ? "boris (Lorentz force of the wires at the particles)" : "velocity verlet") << '\n';
+        if (config.timestepLevels > 0) { std::cout << "block time-stepping: dt / 2^k for k up to " << config.timestepLevels << " (accuracy " << config.timestepAccuracy << ")" << '\n'; }
+        if (config.checkpointInterval > 0 || config.checkpointSeconds > 0.)
+        {
+            std::cout << "checkpoint: " << config.checkpointFile << " every ";
+            if (config.checkpointInterval > 0) { std::cout << config.checkpointInterval << " steps" << (config.checkpointSeconds > 0. ? " or " : ""); }
+            if (config.checkpointSeconds > 0.) { std::cout << config.checkpointSeconds << " s"; }
+            std::cout << '\n';
+        }
+        if (!config.particlesFile.empty()) { std::cout << "particles file: " << config.particlesFile << '\n'; }
+        if (config.numGenerated > 0) { std::cout << "generated particles: " << config.numGenerated << " (seed " << config.seed << ")" << '\n'; }
+        if (!config.restartFile.empty()) { std::cout << "restart from: " << config.restartFile << '\n'; }
+        if (!config.sources.empty() || config.absorbing || config.collisions != Collisions::none)
+        {
+            std::cout << "population: " << config.sources.size() << " source(s)" << (config.absorbing ? ", absorbing walls" : "");
+            if (config.collisions != Collisions::none)
+            {
+                std::cout << ", opposite charges closer than " << config.collisionRadius << (config.collisions == Collisions::merge ? " merge" : " annihilate");
+            }
+            std::cout << '\n';
+        }
+        if (!config.velocityClamp) { std::cout << "velocity clamp: off" << '\n'; }
+        if (config.sortInterval > 0) { std::cout << "particles sorted along the " << (config.sortCurve == SortCurve::morton ? "morton" : "hilbert") << " curve every " << config.sortInterval << " steps" << '\n'; }
+        if (config.diagnosticsInterval > 0) { std::cout << "diagnostics every " << config.diagnosticsInterval << " steps: " << config.outputDirectory << '/' << config.outputFilename << "_diagnostics.csv" << '\n'; }
         std::cout << '\n' << "############################################" << "\n\n";
 
         #ifdef _OPENMP
@@ -19,25 +81,6 @@ namespace Utilities
         std::cout << '\n' << "############################################" << "\n\n";
     };
 
-    Point2D r_prime(const Point2D& p1, const Point2D& p2)
-    {
-        // Minimum image convention
-        // https://www.researchgate.net/profile/Ulrich-Deiters/publication/235933545_Efficient_Coding_of_the_Minimum_Image_Convention/links/5955135d458515bbaa21e73e/Efficient-Coding-of-the-Minimum-Image-Convention.pdf
-
-        Point2D r_prime { p1 - p2 };
-        
-        if (periodic)
-        {
-            const double& dx { r_prime.x() };
-            const double& dy { r_prime.y() };
-            r_prime.setX( dx - static_cast<int>(dx / bound)*2*Utilities::bound );
-            r_prime.setY( dy - static_cast<int>(dy / bound)*2*Utilities::bound );
-        }
-
-        return r_prime;
-    }
-
-    
     template <typename FileStream>
     void checkFileOpen(const FileStream& file)
     {
@@ -46,68 +89,214 @@ namespace Utilities
         }
     };
 
-    void appendToEndOfLine(const std::string& filename, const std::string& ext, const std::string& delimiter, const std::vector<Field2D>& data)
+    nlohmann::json loadJsonFile(const std::string& filename)
     {
-        if (data.empty()) return;
-        
-        // Assumes that `data` is already in the format: {magnitude, unit vector component 1, unit vector component 2}
-        // assumes file path is /Users/max/ClassicalEM++/outputs/
-        std::string inputFilename = "/Users/max/ClassicalEM++/outputs/" + filename + "." + ext;
-        std::string tempFilename = "/Users/max/ClassicalEM++/outputs/temp." + ext;
+        nlohmann::json _j;
+
+        std::ifstream file(filename);
+        checkFileOpen<std::ifstream>(file);
 
-        std::ifstream inputFile(inputFilename, std::ios::in);
-        // ensure file is open (needs to caught in a try catch block)
-        checkFileOpen<std::ifstream>(inputFile);
+        file >> _j;
+        return _j;
+    };
 
-        // Create a temporary file to store modified content
-        std::ofstream tempFile(tempFilename, std::ios::out);
-        checkFileOpen<std::ofstream>(tempFile);
+    Config readJsonFile(const std::string& filename)
+    {
+        return parseConfig(loadJsonFile(filename));
+    };
 
-        // Read each line from the original file and append the data to the end of the line
-        std::string line;
-        std::size_t idx = 0; // To keep track of corresponding data index
+    Config parseConfig(const nlohmann::json& _j)
+    {
+        const auto start { std::chrono::steady_clock::now() };
+        Config config;
 
-        while (std::getline(inputFile, line))
+        // outputFilename = _j.value("output filename", std::filesystem::path(filename).replace_extension(".txt").string());
+        config.outputFilename = _j.value("output filename", "output");
+        config.outputDirectory = _j.value("output directory", "outputs");
+        config.outputFormat = (_j.value("output format", "binary") == "csv") ? OutputFormat::csv : OutputFormat::binary;
+        config.compression = _j.value("compression", false);
+        config.textPrecision = _j.value("text precision", 0);
+        config.textThreads = static_cast<std::size_t>(_j.value("text threads", 1));
+        config.outputQueue = static_cast<std::size_t>(_j.value("output queue", 4));
+        config.progressSeconds = _j.value("progress seconds", 1.);
+        config.profile = _j.value("profile", true);
+        config.dim = _j["dim"];
+        if (config.dim != 2 && config.dim != 3)
         {
-            if (idx < data.size()) // Ensure we have a corresponding data entry
-            {
-                // Format the current data entry as ",a,b,c"
-                const Field2D& datum = data[idx];
-                // Append formatted data to the line
-                line += delimiter + std::to_string(datum.magnitude) + delimiter + std::to_string(datum.direction.x()) + delimiter + std::to_string(datum.direction.y());
-                ++idx; // Move to the next data entry
-            }
-
-            // Write the modified line to the temp file
-            tempFile << line << '\n';
+            std::cerr << "Only 2D and 3D domains are implemented! Using a 2D domain..." << std::endl;
+            config.dim = 2;
         }
+        config.bound = _j["bound"];
+        config.periodic = _j.value("periodic", false);
+        config.numPoints = _j["numPoints"];
+        config.numSteps = static_cast<std::size_t>(_j.value("numSteps", 1));
+        config.dt = _j.value("dt", 0.01);
 
-        // Close the files
-        inputFile.close();
-        tempFile.close();
-
-        // Replace the original file with the modified temporary file
-        std::filesystem::remove(inputFilename.c_str());  // Delete the original file
-        std::filesystem::rename(tempFilename.c_str(), inputFilename.c_str());  // Rename temp file to original filename
-    };
+        config.outputInterval = static_cast<std::size_t>(_j.value("output interval", 1)); // 0 writes no frames (e.g. when the diagnostics are enough)
+        config.diagnosticsInterval = static_cast<std::size_t>(_j.value("diagnostics interval", 0));
+        config.outputStride = std::max<std::size_t>(static_cast<std::size_t>(_j.value("output stride", 1)), 1);
+        /*
+        the written part of the grid, any side that is left out is the domain bound:
+        "output box": {"xmin": -1.0, "xmax": 1.0, "ymin": -2.0, "ymax": 2.0}
+        */
+        const nlohmann::json box = _j.value("output box", nlohmann::json::object());
+        config.outputBox = Box { box.value("xmin", -config.bound), box.value("xmax", config.bound), box.value("ymin", -config.bound), box.value("ymax", config.bound), box.value("zmin", -config.bound), box.value("zmax", config.bound) };
+        if (config.outputBox.xMin > config.outputBox.xMax || config.outputBox.yMin > config.outputBox.yMax || config.outputBox.zMin > config.outputBox.zMax)
+        {
+            std::cerr << "Empty output box! Writing the whole domain..." << std::endl;
+            config.outputBox = Box { -config.bound, config.bound, -config.bound, config.bound, -config.bound, config.bound };
+        }
 
-    void readJsonFile(const std::string& filename)
-    {
-        nlohmann::json _j;
+        const std::string forceSolverName { _j.value("force solver", "direct") };
+        if (forceSolverName == "tiled")
+        {
+            config.forceSolver = ForceSolver::tiled;
+        }
+        else if (forceSolverName == "barnes-hut")
+        {
+            config.forceSolver = ForceSolver::barnesHut;
+        }
+        else if (forceSolverName == "particle-mesh")
+        {
+            config.forceSolver = ForceSolver::particleMesh;
+        }
+        else if (forceSolverName == "multigrid")
+        {
+            config.forceSolver = ForceSolver::multigrid;
+        }
+        else if (forceSolverName == "ewald" || forceSolverName == "pppm")
+        {
+            config.forceSolver = (forceSolverName == "ewald") ? ForceSolver::ewald : ForceSolver::pppm;
+            if (!config.periodic)
+            {
+                std::cerr << "The " << forceSolverName << " force solver needs periodic boundaries! Using direct summation..." << std::endl;
+                config.forceSolver = ForceSolver::direct;
+            }
+        }
+        else
+        {
+            if (forceSolverName != "direct")
+            {
+                std::cerr << "Unknown force solver \"" << forceSolverName << "\"! Using direct summation..." << std::endl;
+            }
+            config.forceSolver = ForceSolver::direct;
+        }
+        if (config.dim == 3 && config.forceSolver != ForceSolver::direct && config.forceSolver != ForceSolver::tiled)
+        {
+            std::cerr << "The " << forceSolverName << " force solver is only implemented in 2D! Using direct summation..." << std::endl;
+            config.forceSolver = ForceSolver::direct;
+        }
+        const std::string integratorName { _j.value("integrator", "verlet") };
+        if (integratorName == "boris")
+        {
+            config.integrator = Integrator::boris;
+        }
+        else
+        {
+            if (integratorName != "verlet")
+            {
+                std::cerr << "Unknown integrator \"" << integratorName << "\"! Using velocity Verlet..." << std::endl;
+            }
+            config.integrator = Integrator::verlet;
+        }
+        config.timestepLevels = std::min<std::size_t>(static_cast<std::size_t>(_j.value("timestep levels", 0)), 30);
+        config.timestepAccuracy = _j.value("timestep accuracy", 0.02);
+        if (config.timestepLevels > 0 && config.integrator == Integrator::boris)
+        {
+            std::cerr << "Block time-stepping is only implemented for the Verlet integrator! Using one dt for every particle..." << std::endl;
+            config.timestepLevels = 0;
+        }
+        config.theta = _j.value("opening angle", 0.5);
+        config.ewaldTolerance = _j.value("ewald tolerance", 1e-5);
+        config.ewaldCutoff = _j.value("ewald cutoff", 0.);
+        config.pppmMesh = static_cast<std::size_t>(_j.value("pppm mesh", 0));
 
-        std::ifstream file("/Users/max/ClassicalEM++/" + filename);
-        checkFileOpen<std::ifstream>(file);
+        /*
+        walls and electrodes of the "multigrid" force solver (see Multigrid.hpp):
+        "boundary": "dirichlet"/"neumann", "boundary potential": 0.0,
+        "conductors": [{"potential": 1.0, "box": {"xmin": -0.5, "xmax": 0.5, "ymin": -1.0, "ymax": -0.9}}, {"potential": -1.0, "circle": {"x": 0.0, "y": 0.5, "radius": 0.1}}],
+        "multigrid tolerance": 1e-6, "multigrid cycles": 30
+        */
+        const std::string boundaryName { _j.value("boundary", "dirichlet") };
+        if (boundaryName == "neumann")
+        {
+            config.boundary = Boundary::neumann;
+        }
+        else
+        {
+            if (boundaryName != "dirichlet")
+            {
+                std::cerr << "Unknown boundary \"" << boundaryName << "\"! Using \"dirichlet\"..." << std::endl;
+            }
+            config.boundary = Boundary::dirichlet;
+        }
+        config.boundaryPotential = _j.value("boundary potential", 0.);
+        if (_j.contains("conductors"))
+        {
+            const nlohmann::json conductors = _j["conductors"].is_array() ? _j["conductors"] : nlohmann::json::array({_j["conductors"]});
+            for (const nlohmann::json& entry : conductors)
+            {
+                Conductor conductor { entry.value("potential", 0.), Box { -config.bound, config.bound, -config.bound, config.bound, -config.bound, config.bound }, 0., 0., 0. };
+                if (entry.contains("circle"))
+                {
+                    const nlohmann::json circle = entry["circle"];
+                    conductor.x = circle.value("x", 0.);
+                    conductor.y = circle.value("y", 0.);
+                    conductor.radius = circle.value("radius", 0.);
+                    if (conductor.radius <= 0.)
+                    {
+                        std::cerr << "A conductor circle needs a positive \"radius\"! Ignoring the conductor..." << std::endl;
+                        continue;
+                    }
+                }
+                else
+                {
+                    const nlohmann::json conductorBox = entry.value("box", nlohmann::json::object());
+                    conductor.box = Box { conductorBox.value("xmin", -config.bound), conductorBox.value("xmax", config.bound),
+                                          conductorBox.value("ymin", -config.bound), conductorBox.value("ymax", config.bound),
+                                          conductorBox.value("zmin", -config.bound), conductorBox.value("zmax", config.bound) };
+                }
+                config.conductors.push_back(conductor);
+            }
+        }
+        if (!config.conductors.empty() && config.forceSolver != ForceSolver::multigrid)
+        {
+            std::cerr << "Conductors are only held at their potential by the multigrid force solver! Ignoring the conductors..." << std::endl;
+            config.conductors.clear();
+        }
+        config.multigridTolerance = _j.value("multigrid tolerance", 1e-6);
+        config.multigridCycles = std::max<std::size_t>(static_cast<std::size_t>(_j.value("multigrid cycles", 30)), 1);
 
-        file >> _j;
+        // checkpoints of the integrator state, "restart": true continues from the checkpoint file (or "restart": "<path>" from another one)
+        config.checkpointInterval = static_cast<std::size_t>(_j.value("checkpoint interval", 0));
+        config.checkpointSeconds = _j.value("checkpoint seconds", 0.);
+        config.checkpointFile = _j.value("checkpoint file", config.outputDirectory + "/" + config.outputFilename + ".ckpt");
+        if (_j.contains("restart") && _j["restart"].is_string())
+        {
+            config.restartFile = _j["restart"];
+        }
+        else if (_j.value("restart", false))
+        {
+            config.restartFile = config.checkpointFile;
+        }
 
-        // outputFilename = _j.value("output filename", std::filesystem::path(filename).replace_extension(".txt").string());
-        outputFilename = _j.value("output filename", "output");
-        dim = _j["dim"];
-        bound = _j["bound"];
-        periodic = _j.value("periodic", false);
-        numPoints = _j["numPoints"];
-        numSteps = static_cast<std::size_t>(_j.value("numSteps", 1));
-        dt = _j.value("dt", 0.01);
+        const std::string assignmentName { _j.value("assignment", "CIC") };
+        if (assignmentName == "NGP")
+        {
+            config.assignment = Assignment::NGP;
+        }
+        else if (assignmentName == "TSC")
+        {
+            config.assignment = Assignment::TSC;
+        }
+        else
+        {
+            if (assignmentName != "CIC")
+            {
+                std::cerr << "Unknown assignment scheme \"" << assignmentName << "\"! Using CIC..." << std::endl;
+            }
+            config.assignment = Assignment::CIC;
+        }
 
         /*
         particles is setup like this in json file:
@@ -117,37 +306,58 @@ namespace Utilities
         ]
         */
 
+        // every charge is multiplied by the "charge scale" (so a sweep can vary the charges without repeating the particles)
+        const double chargeScale { _j.value("charge scale", 1.0) };
+
         // get particles from json file if "particles" key exists
-        if (_j.contains("particles"))
+        // 3D: same entries with "z" (default 0), every run takes the velocity if "vx", "vy" and "vz" are given
+        // each entry is read in one pass over its keys (see ParticleInput::Entry)
+        const auto readParticles = [&]<std::size_t N>(std::vector<ChargedParticle<N>>& particles)
         {
-            particles.reserve(_j["particles"].size());
-            for (const auto& particle : _j["particles"]) // use `auto` here because `nlohmann::json::object_t` might not be right and looks ugly in my opinion
+            if (_j.contains("particles"))
             {
-                if (!checkPointWithinBounds(particle["x"], particle["y"])) 
+                const nlohmann::json& entries { _j["particles"] };
+                particles.reserve(entries.size());
+                for (const auto& particle : entries) // use `auto` here because `nlohmann::json::object_t` might not be right and looks ugly in my opinion
                 {
-                    std::cerr << "Particle out of bounds! Ignoring..." << '\n' << "x\t" << particle["x"] << '\n' << "y\t" << particle["y"] << std::endl;
-                    continue;
+                    ParticleInput::Entry entry;
+                    for (const auto& [name, value] : particle.items())
+                    {
+                        const unsigned key { ParticleInput::Entry::key(name) };
+                        if (key != 0 && value.is_number()) { entry.set(key, value); }
+                    }
+                    ParticleInput::append<N>(entry, config.bound, chargeScale, particles);
                 };
+            }
 
-                Point3D velocity {0.0, 0.0, 0.0};
-                if (particle.contains("vx") && particle.contains("vy") && particle.contains("vz")) {
-                    velocity = Point3D{particle["vx"], particle["vy"], particle["vz"]};
-                }
+            // large initial conditions: "particles file": "<path>.cemp" (particle table) or a json file streamed without a DOM (see ParticleInput.hpp)
+            if (!config.particlesFile.empty())
+            {
+                ParticleInput::readFile<N>(config.particlesFile, config.bound, chargeScale, particles);
+            }
 
-                particles.emplace_back(ChargedParticle2D{particle["charge"], abs(particle.value("mass", 1.0)), Point2D{particle["x"], particle["y"]}, velocity});
-            };
-        }
+            // generated initial conditions (see Generators.hpp), reproducible for a "seed" whatever the number of threads
+            if (_j.contains("generate"))
+            {
+                config.numGenerated = Generators::generate<N>(_j["generate"], config.seed, config.bound, chargeScale, particles);
+            }
+        };
+
+        config.particlesFile = _j.value("particles file", "");
+        config.seed = _j.value("seed", std::uint64_t {0});
+        if (config.dim == 3) { readParticles(config.particles3D); }
+        else { readParticles(config.particles); }
 
         // get infinite wires from json file if "wires" key exists
         if (_j.contains("wires"))
         {
-            wires.reserve(_j["wires"].size());
+            config.wires.reserve(_j["wires"].size());
             for (const auto& wire : _j["wires"])
             {
                 Point3D direction_Point3D { Point3D{wire["direction"]["x"], wire["direction"]["y"], wire["direction"]["z"]} };
                 direction_Point3D.normalize();
 
-                wires.emplace_back(InfiniteWire2D
+                config.wires.emplace_back(InfiniteWire2D
                 {
                     wire["current"], 
                     Point2D{wire["x"], wire["y"]}, 
@@ -155,25 +365,94 @@ namespace Utilities
                 });
             };
         }
-    };
 
-    bool checkPointWithinBounds(const double& x, const double& y)
-    {
-        return abs(x) <= bound && abs(y) <= bound;
-    };
+        /*
+        particles can enter and leave during the run (see Population.hpp):
+        "sources": [{"rate": 0.5, "charge": -1, "mass": 1, "temperature": 0.01, "drift": {"vx": 1.0}, "box": {"xmin": -1.0, "xmax": -0.9}, "start": 0, "stop": 1000}],
+        "absorbing": true,
+        "collisions": "annihilate", "collision radius": 0.01
+        */
+        if (_j.contains("sources"))
+        {
+            const nlohmann::json sources = _j["sources"].is_array() ? _j["sources"] : nlohmann::json::array({_j["sources"]});
+            for (const nlohmann::json& entry : sources)
+            {
+                Source source;
+                source.rate = std::max(entry.value("rate", 0.), 0.);
+                source.charge = chargeScale * entry.value("charge", 1.);
+                source.mass = std::abs(entry.value("mass", 1.));
+                source.temperature = entry.value("temperature", 0.);
+                const nlohmann::json drift = entry.value("drift", nlohmann::json::object());
+                source.drift = Point3D { drift.value("vx", 0.), drift.value("vy", 0.), drift.value("vz", 0.) };
+                source.start = entry.value("start", std::size_t {0});
+                source.stop = entry.value("stop", std::size_t {0});
 
-    bool checkPointWithinBounds(Point2D& point)
-    {
-        return abs(point.x()) <= bound && abs(point.y()) <= bound;
+                // clipped to the domain like the generator boxes
+                const nlohmann::json sourceBox = entry.value("box", nlohmann::json::object());
+                source.box = Box { std::max(sourceBox.value("xmin", -config.bound), -config.bound), std::min(sourceBox.value("xmax", config.bound), config.bound),
+                                   std::max(sourceBox.value("ymin", -config.bound), -config.bound), std::min(sourceBox.value("ymax", config.bound), config.bound),
+                                   std::max(sourceBox.value("zmin", -config.bound), -config.bound), std::min(sourceBox.value("zmax", config.bound), config.bound) };
+                if (source.box.xMin > source.box.xMax || source.box.yMin > source.box.yMax || source.box.zMin > source.box.zMax)
+                {
+                    std::cerr << "Empty source box! Using the whole domain..." << std::endl;
+                    source.box = Box { -config.bound, config.bound, -config.bound, config.bound, -config.bound, config.bound };
+                }
+                config.sources.push_back(source);
+            }
+        }
+        config.absorbing = _j.value("absorbing", false);
+        if (config.absorbing && config.periodic)
+        {
+            std::cerr << "A periodic domain has no walls to absorb at! Ignoring \"absorbing\"..." << std::endl;
+            config.absorbing = false;
+        }
+        const std::string collisionsName { _j.value("collisions", "none") };
+        if (collisionsName == "annihilate")
+        {
+            config.collisions = Collisions::annihilate;
+        }
+        else if (collisionsName == "merge")
+        {
+            config.collisions = Collisions::merge;
+        }
+        else
+        {
+            if (collisionsName != "none")
+            {
+                std::cerr << "Unknown collisions \"" << collisionsName << "\"! Particles don't collide..." << std::endl;
+            }
+            config.collisions = Collisions::none;
+        }
+        config.collisionRadius = _j.value("collision radius", 0.);
+        if (config.collisions != Collisions::none && config.collisionRadius <= 0.)
+        {
+            std::cerr << "Collisions need a positive \"collision radius\"! Particles don't collide..." << std::endl;
+            config.collisions = Collisions::none;
+        }
+        config.velocityClamp = _j.value("velocity clamp", true);
+
+        // "sort interval": 20, "sort curve": "hilbert"/"morton" (see SpatialSort.hpp)
+        config.sortInterval = _j.value("sort interval", std::size_t {0});
+        const std::string sortCurveName { _j.value("sort curve", "hilbert") };
+        if (sortCurveName == "morton")
+        {
+            config.sortCurve = SortCurve::morton;
+        }
+        else
+        {
+            if (sortCurveName != "hilbert")
+            {
+                std::cerr << "Unknown sort curve \"" << sortCurveName << "\"! Using \"hilbert\"..." << std::endl;
+            }
+            config.sortCurve = SortCurve::hilbert;
+        }
+
+        config.loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return config;
     };
 
-    std::size_t findNearestGridPointIndex(const Point2D& point)
+    bool checkPointWithinBounds(const double& x, const double& y, const double& bound)
     {
-        double step_size { 2 * bound / (numPoints + 1) };
-        // since `bound` is positive, we have -(-bound) = +bound
-        std::size_t x_idx { static_cast<std::size_t>(std::round((point.x() + bound) / step_size)) };
-        std::size_t y_idx { static_cast<std::size_t>(std::round((point.y() + bound) / step_size)) };
-
-        return static_cast<std::size_t>( (numPoints+1) * x_idx + y_idx );
+        return std::abs(x) <= bound && std::abs(y) <= bound;
     };
 };
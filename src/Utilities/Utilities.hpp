@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -13,36 +14,231 @@
 
 namespace Utilities
 {
-    inline std::string outputFilename;
-    inline std::size_t dim;
-    inline double bound;
-    inline bool periodic;
-    inline std::size_t numPoints;
-    inline std::size_t numSteps;
-    inline double dt;
-    inline std::vector<ChargedParticle2D> particles;
-    inline std::vector<InfiniteWire2D> wires;
-
-    void initMessage();
+    // how the field frames are written
+    enum class OutputFormat
+    {
+        binary, // one .cemf run file with a record per frame (see Output.hpp)
+        csv, // one text file per frame
+    };
+
+    // backends for the particle-particle accelerations in DynamicPhysics
+    enum class ForceSolver
+    {
+        direct, // O(N^2) pair sum, the reference
+        barnesHut, // O(N log N) quadtree approximation
+        particleMesh, // O(G log G + N) FFT Poisson solve on the grid
+        ewald, // periodic: Ewald sum with every periodic image, O(N^1.5)
+        pppm, // periodic: Ewald sum with the reciprocal part on an FFT mesh, O(N log N)
+        tiled, // O(N^2) pair sum as a cache-blocked SIMD kernel, bitwise the same for any number of threads (2D and 3D)
+        multigrid, // O(G + N) geometric multigrid Poisson solve on the grid, with conductors and boundary potentials
+    };
+
+    // how DynamicPhysics advances the particles
+    enum class Integrator
+    {
+        verlet, // velocity Verlet with the Coulomb accelerations only
+        boris, // leapfrog Boris pusher: Coulomb accelerations plus the Lorentz force of the wires' magnetic field at each particle
+    };
+
+    // charge assignment/interpolation scheme for the particle-mesh solver
+    enum class Assignment
+    {
+        NGP, // nearest grid point
+        CIC, // cloud in cell
+        TSC, // triangular shaped cloud
+    };
+
+    // what happens to the opposite charges that come closer than the "collision radius" (see Population.hpp)
+    enum class Collisions
+    {
+        none,
+        annihilate, // both are removed
+        merge, // one particle with the summed charge and mass, momentum conserving
+    };
+
+    // domain walls of the "multigrid" force solver (a periodic domain has none)
+    enum class Boundary
+    {
+        dirichlet, // the walls are held at the "boundary potential" (a grounded box by default)
+        neumann, // no field through the walls
+    };
+
+    // space-filling curve the particles are reordered along (see SpatialSort.hpp)
+    enum class SortCurve
+    {
+        hilbert, // neighbouring cells are always next to each other on the curve
+        morton, // Z-order, cheaper keys with jumps between the quadrants
+    };
+
+    // axis-aligned part of the domain
+    struct Box
+    {
+        double xMin;
+        double xMax;
+        double yMin;
+        double yMax;
+        double zMin; // 3D only
+        double zMax;
+    };
+
+    // electrode held at a fixed potential by the "multigrid" force solver (see Multigrid.hpp)
+    struct Conductor
+    {
+        double potential;
+        Box box; // the grid points inside it, unless the conductor is a circle
+        double x; // center of a circle
+        double y;
+        double radius; // 0: a box
+    };
+
+    // injector of particles during the run (see Population.hpp)
+    struct Source
+    {
+        double rate { 0. }; // particles per step, the fractions add up over the steps
+        double charge { 1. };
+        double mass { 1. };
+        double temperature { 0. }; // Maxwellian velocities like the generators (k_B = 1)
+        Point3D drift { 0., 0., 0. };
+        Box box { -1., 1., -1., 1., -1., 1. }; // where the particles appear (within the domain)
+        std::size_t start { 0 }; // the steps after `start` up to `stop` inject (stop 0: until the end)
+        std::size_t stop { 0 };
+    };
+
+    // Everything a run is set up from (read from the json config). Each run reads its own Config (the physics classes keep a
+    // reference to it, it has to outlive them), so several runs can live in one process (see Ensemble)
+    struct Config
+    {
+        std::string outputFilename { "output" };
+        std::string outputDirectory { "outputs" };
+        OutputFormat outputFormat { OutputFormat::binary };
+        bool compression { false };
+        int textPrecision { 0 }; // csv: significant digits of the numbers (0: shortest text that reads back as the same double)
+        std::size_t textThreads { 1 }; // csv: threads formatting a frame (on top of the writer thread)
+        std::size_t outputQueue { 4 }; // frames that can wait for the writer thread before the simulation blocks
+        std::size_t outputInterval { 1 }; // steps between written frames (the grid field is only evaluated for those, 0: no frames)
+        std::size_t outputStride { 1 }; // every n-th grid point along each dimension is written
+        Box outputBox { -1., 1., -1., 1., -1., 1. }; // grid points outside of it are not written
+        bool verbose { true }; // progress and settings on std::cout (off for the runs of an ensemble)
+        double progressSeconds { 1. }; // wall time between progress lines
+        bool profile { true }; // `<output directory>/<output filename>_profile.json` at the end of the run (see Profiler.hpp)
+        std::size_t dim { 2 };
+        double bound { 1. };
+        bool periodic { false };
+        std::size_t numPoints { 100 };
+        std::size_t numSteps { 1 };
+        double dt { 0.01 };
+        ForceSolver forceSolver { ForceSolver::direct };
+        double theta { 0.5 }; // Barnes-Hut opening angle
+        Assignment assignment { Assignment::CIC };
+        Integrator integrator { Integrator::verlet }; // with "boris" the velocities are half a step behind the positions (leapfrog)
+        std::size_t timestepLevels { 0 }; // block time-stepping: particles step with dt / 2^k for k up to this (0: everyone takes dt)
+        double timestepAccuracy { 0.02 }; // eta of the step criterion dt_i = eta |a| / |da/dt|
+        double ewaldTolerance { 1e-5 }; // relative size of the neglected real/reciprocal space terms
+        double ewaldCutoff { 0. }; // real space cutoff (0: chosen from the number of particles)
+        std::size_t pppmMesh { 0 }; // PPPM mesh nodes per dimension (0: chosen from the tolerance)
+        Boundary boundary { Boundary::dirichlet };
+        double boundaryPotential { 0. };
+        std::vector<Conductor> conductors;
+        double multigridTolerance { 1e-6 }; // residual of a solve relative to the one of a zero potential
+        std::size_t multigridCycles { 30 }; // V-cycles per solve at most
+        std::size_t checkpointInterval { 0 }; // steps between checkpoints (0: off)
+        double checkpointSeconds { 0. }; // wall time between checkpoints (0: off)
+        std::string checkpointFile { "outputs/output.ckpt" };
+        std::string restartFile; // checkpoint the run continues from (empty: start from the particles)
+        std::size_t diagnosticsInterval { 0 }; // steps between rows of the diagnostics time series (0: off)
+        std::string particlesFile; // particle table or json file read in addition to the "particles" of the config
+        std::uint64_t seed { 0 }; // of the "generate" initial conditions
+        std::size_t numGenerated { 0 };
+        std::vector<Source> sources;
+        bool absorbing { false }; // non-periodic walls remove the particles that reach them instead of reflecting them
+        Collisions collisions { Collisions::none };
+        double collisionRadius { 0. };
+        bool velocityClamp { true }; // the velocity components are cut at bound / (8 dt)
+        std::size_t sortInterval { 0 }; // steps between reorderings of the particles along the curve (0: kept in input order)
+        SortCurve sortCurve { SortCurve::hilbert };
+        double loadSeconds { 0. }; // spent reading (or generating) the particles and wires
+        std::vector<ChargedParticle2D> particles;
+        std::vector<ChargedParticle3D> particles3D; // "particles" of a dim 3 run
+        std::vector<InfiniteWire2D> wires;
+
+        // the particles read for a run in N dimensions
+        template <std::size_t N>
+        std::vector<ChargedParticle<N>>& inputParticles()
+        {
+            if constexpr (N == 2) { return particles; }
+            else { return particles3D; }
+        }
+
+        template <std::size_t N>
+        const std::vector<ChargedParticle<N>>& inputParticles() const
+        {
+            if constexpr (N == 2) { return particles; }
+            else { return particles3D; }
+        }
+    };
+
+    void initMessage(const Config& config);
 
     template <typename FileStream>
     void checkFileOpen(const FileStream& file);
     
-    Point2D r_prime (const Point2D& p1, const Point2D& p2);
-
     template <typename T>
     int sign(T val)
     {
         return (T(0) < val) - (val < T(0));
     };
 
-    void appendToEndOfLine(const std::string& filename, const std::string& ext, const std::string& delimiter, const std::vector<Field2D>& data);
+    // separation p1 - p2 (minimum image if periodic)
+    template <std::size_t N>
+    Point<N> r_prime(const Point<N>& p1, const Point<N>& p2, const bool& periodic, const double& bound)
+    {
+        // Minimum image convention
+        // https://www.researchgate.net/profile/Ulrich-Deiters/publication/235933545_Efficient_Coding_of_the_Minimum_Image_Convention/links/5955135d458515bbaa21e73e/Efficient-Coding-of-the-Minimum-Image-Convention.pdf
+
+        Point<N> r_prime { p1 - p2 };
 
-    void readJsonFile(const std::string& filename);
+        if (periodic)
+        {
+            for (std::size_t d = 0; d < N; ++d)
+            {
+                const double dx { r_prime[d] };
+                r_prime[d] = dx - static_cast<int>(dx / bound)*2*bound;
+            }
+        }
 
-    bool checkPointWithinBounds(const double& x, const double& y);
+        return r_prime;
+    };
+
+    // the json file as it is (relative paths are resolved against the working directory, like the outputs)
+    nlohmann::json loadJsonFile(const std::string& filename);
+    // settings, particles and wires of a run from its json config
+    Config parseConfig(const nlohmann::json& _j);
+    Config readJsonFile(const std::string& filename);
 
-    bool checkPointWithinBounds(Point2D& point);
+    bool checkPointWithinBounds(const double& x, const double& y, const double& bound);
 
-    std::size_t findNearestGridPointIndex(const Point2D& point);
+    template <std::size_t N>
+    bool checkPointWithinBounds(const Point<N>& point, const double& bound)
+    {
+        for (std::size_t d = 0; d < N; ++d)
+        {
+            if (std::abs(point[d]) > bound) { return false; }
+        }
+        return true;
+    };
+
+    // index of the grid point closest to `point` (same ordering as Geometry<N>::grid)
+    template <std::size_t N>
+    std::size_t findNearestGridPointIndex(const Point<N>& point, const double& bound, const std::size_t& numPoints)
+    {
+        double step_size { 2 * bound / static_cast<double>(numPoints + 1) };
+        std::size_t idx { 0 };
+        for (std::size_t d = 0; d < N; ++d)
+        {
+            // since `bound` is positive, we have -(-bound) = +bound
+            idx = (numPoints+1) * idx + static_cast<std::size_t>(std::round((point[d] + bound) / step_size));
+        }
+
+        return idx;
+    };
 };